@@ -0,0 +1,91 @@
+/**
+ * Measures the throughput of format_double() compared to snprintf() with
+ * the conversions that are used to write numbers. The values are ratios
+ * similar to the ones of the curves written by clperf.
+ *
+ * Usage: format_bench
+ *
+ * @file format_bench.c
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "support.c"
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Formats all values with the given method.
+ *
+ * @param values
+ * @param n
+ * @param method 0 for "%lf", 1 for "%.17g" and 2 for format_double()
+ * @param bytes where the number of written characters is stored
+ * @return the time it took.
+ */
+static double run(const double *values, size_t n, int method, size_t *bytes)
+{
+	char buf[FORMAT_DOUBLE_MAX + 1];
+	double start = now();
+	size_t total = 0;
+	size_t i;
+
+	for (i=0;i<n;i++)
+	{
+		switch (method)
+		{
+			case	0: total += snprintf(buf,sizeof(buf),"%lf",values[i]); break;
+			case	1: total += snprintf(buf,sizeof(buf),"%.17g",values[i]); break;
+			default: total += format_double(buf,values[i]); break;
+		}
+	}
+	*bytes = total;
+	return now() - start;
+}
+
+int main(int argc, char **argv)
+{
+	static const char *names[] = {"snprintf %lf", "snprintf %.17g", "format_double"};
+	const size_t n = 2000000;
+	double *values;
+	size_t i;
+	int method;
+
+	if (!(values = (double*)malloc(sizeof(values[0]) * n)))
+		return EXIT_FAILURE;
+
+	srand(1);
+	for (i=0;i<n;i++)
+	{
+		uint32_t total = 1 + rand() % 1000000;
+		values[i] = (double)(rand() % total) / total;
+	}
+
+	printf("%zu values\n",n);
+	for (method=0;method<3;method++)
+	{
+		double best = 0;
+		size_t bytes;
+		int r;
+
+		for (r=0;r<5;r++)
+		{
+			double t = run(values,n,method,&bytes);
+			if (!r || t < best) best = t;
+		}
+
+		printf("%-14s %8.2f Mvalues/s %8.1f MB/s\n",names[method],n / best / 1e6,bytes / best / 1e6);
+	}
+
+	free(values);
+	return EXIT_SUCCESS;
+}
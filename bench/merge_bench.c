@@ -0,0 +1,80 @@
+/**
+ * Measures the throughput of the k-way merge of sorted runs for
+ * a growing number of runs k.
+ *
+ * Usage: merge_bench [ROWS]
+ *
+ * @file merge_bench.c
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "support.c"
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int count_cb(data_t *d, uint8_t *row, void *user_data)
+{
+	(*(uint32_t*)user_data)++;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	static const int ks[] = {2, 16, 128, 1024, 8192};
+	uint32_t rows = 4000000;
+	int sort_col = 1;
+	int i, j;
+
+	if (argc > 1)
+		rows = atoi(argv[1]);
+
+	printf("%" PRIu32 " rows\n",rows);
+	for (i=0;i<sizeof(ks)/sizeof(ks[0]);i++)
+	{
+		data_t *d;
+		uint32_t merged = 0;
+		double t;
+
+		if (data_create(&d))
+			return EXIT_FAILURE;
+		data_set_external_filename(d,"merge_bench.tmp");
+		d->ib_bytes = (rows + ks[i] - 1) / ks[i] * 12;
+
+		/* All runs are merged by a single tree, without intermediate passes */
+		data_set_max_fan_in(d,ks[i]);
+		data_set_progress(d,0);
+
+		data_set_number_of_columns(d,2);
+		data_set_column_datatype(d,0,INT32);
+		data_set_column_datatype(d,1,DOUBLE);
+
+		srand(1);
+		for (j=0;j<rows;j++)
+			data_insert_row_v(d,rand()&1,rand() / (double)RAND_MAX);
+
+		d->to_sort_columns = &sort_col;
+		d->num_to_sort_columns = 1;
+		if (data_sort_runs(d))
+			return EXIT_FAILURE;
+
+		t = now();
+		if (data_merge_runs(d,count_cb,&merged))
+			return EXIT_FAILURE;
+		t = now() - t;
+
+		printf("k=%-6d %8.2f Mrows/s\n",ks[i],merged / t / 1e6);
+		data_free(d);
+		remove("merge_bench.tmp");
+	}
+	return EXIT_SUCCESS;
+}
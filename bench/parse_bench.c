@@ -0,0 +1,182 @@
+/**
+ * Measures the throughput of the number parsers used when loading
+ * data frames. The built-in parser is compared to strtod()/strtol().
+ *
+ * Usage: parse_bench [FILE]
+ *
+ * Without a file, values similar to those written by R are generated.
+ *
+ * @file parse_bench.c
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "support.c"
+
+struct field
+{
+	const char *s;
+	const char *e;
+	int is_int;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Generates tab separated lines of a label and three scores.
+ */
+static char *generate(size_t *len, int lines)
+{
+	char *buf;
+	size_t pos = 0;
+	int i;
+
+	if (!(buf = malloc((size_t)lines * 80)))
+		return NULL;
+
+	srand(1);
+	for (i=0;i<lines;i++)
+	{
+		double a = rand() / (double)RAND_MAX;
+		double b = rand() / (double)RAND_MAX * 1e-3;
+		double c = (rand() - RAND_MAX / 2) / 1e4;
+		pos += sprintf(&buf[pos],"%d\t%.15g\t%.15g\t%.17g\n",rand()&1,a,b,c);
+	}
+	*len = pos;
+	return buf;
+}
+
+static struct field *split(const char *buf, size_t len, size_t *num_fields, size_t *num_bytes)
+{
+	struct field *fields = NULL;
+	size_t allocated = 0;
+	size_t n = 0;
+	const char *s = buf;
+	const char *end = buf + len;
+
+	*num_bytes = 0;
+	while (s < end)
+	{
+		const char *e = s;
+		const char *p;
+		int is_int = 1;
+
+		while (e < end && *e != '\t' && *e != '\n')
+			e++;
+
+		for (p=s;p<e;p++)
+			if (!isdigit((unsigned char)*p) && *p != '-')
+				is_int = 0;
+
+		if (e > s && *s != '"')
+		{
+			if (n == allocated)
+			{
+				allocated = allocated?allocated*2:1024;
+				if (!(fields = realloc(fields,sizeof(fields[0])*allocated)))
+					return NULL;
+			}
+			fields[n].s = s;
+			fields[n].e = e;
+			fields[n].is_int = is_int;
+			*num_bytes += e - s + 1;
+			n++;
+		}
+		s = e + 1;
+	}
+	*num_fields = n;
+	return fields;
+}
+
+static double run(struct field *fields, size_t n, int fast, double *checksum)
+{
+	double start = now();
+	double sum = 0;
+	size_t i;
+
+	for (i=0;i<n;i++)
+	{
+		if (fields[i].is_int)
+		{
+			int32_t v;
+
+			if (fast) data_parse_int32(&v,fields[i].s,fields[i].e);
+			else v = (int32_t)strtol(fields[i].s,NULL,10);
+			sum += v;
+		} else
+		{
+			if (fast) sum += data_parse_double(fields[i].s,fields[i].e);
+			else sum += strtod(fields[i].s,NULL);
+		}
+	}
+	*checksum = sum;
+	return now() - start;
+}
+
+int main(int argc, char **argv)
+{
+	char *buf;
+	size_t len;
+	size_t num_fields;
+	size_t num_bytes;
+	struct field *fields;
+	int fast;
+
+	if (argc > 1)
+	{
+		FILE *f;
+		if (!(f = fopen(argv[1],"r")))
+		{
+			fprintf(stderr,"Couldn't open \"%s\"\n",argv[1]);
+			return EXIT_FAILURE;
+		}
+		fseek(f,0,SEEK_END);
+		len = ftell(f);
+		fseek(f,0,SEEK_SET);
+		if (!(buf = malloc(len + 1)) || fread(buf,1,len,f) != len)
+		{
+			fprintf(stderr,"Couldn't read \"%s\"\n",argv[1]);
+			return EXIT_FAILURE;
+		}
+		buf[len] = '\n';
+		fclose(f);
+	} else
+	{
+		if (!(buf = generate(&len,1000000)))
+			return EXIT_FAILURE;
+	}
+
+	if (!(fields = split(buf,len,&num_fields,&num_bytes)))
+		return EXIT_FAILURE;
+
+	printf("%zu values, %zu bytes\n",num_fields,num_bytes);
+	for (fast=0;fast<2;fast++)
+	{
+		double checksum;
+		double best = 0;
+		int r;
+
+		for (r=0;r<5;r++)
+		{
+			double t = run(fields,num_fields,fast,&checksum);
+			if (!r || t < best) best = t;
+		}
+
+		printf("%-14s %8.1f MB/s %8.2f Mvalues/s (checksum %.17g)\n",
+				fast?"parse_double":"strtod/strtol",
+				num_bytes / best / 1e6, num_fields / best / 1e6, checksum);
+	}
+
+	free(fields);
+	free(buf);
+	return EXIT_SUCCESS;
+}
@@ -9,12 +9,17 @@
  */
 
 #include <ctype.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "support.h"
 #include "version.h"
 
@@ -51,6 +56,157 @@ static int getarg(int argc, char **argv, int *argpos, char *arg, const char **va
 	return 1;
 }
 
+/**
+ * Parses a size in bytes, which may carry a K, M or G suffix.
+ *
+ * @param out where to store the size.
+ * @param str
+ * @return 0 on success, else an error.
+ */
+static int parse_size(size_t *out, const char *str)
+{
+	char *end;
+	unsigned long long v = strtoull(str,&end,10);
+
+	if (end == str)
+		return -1;
+
+	switch (toupper((unsigned char)*end))
+	{
+		case	'G': v *= 1024;
+		/* fall through */
+		case	'M': v *= 1024;
+		/* fall through */
+		case	'K': v *= 1024; end++; break;
+		default: break;
+	}
+	if (*end || !v)
+		return -1;
+	*out = v;
+	return 0;
+}
+
+/**
+ * Determines the key that identifies the sorted rows of a frame within
+ * the cache and the name of the file in which they are kept. The key
+ * covers the identity of the input file, the loaded columns, the
+ * sort order and whether floating point columns are single precision.
+ *
+ * @param key where the allocated key is stored.
+ * @param name where the allocated file name is stored.
+ * @param dir the cache directory.
+ * @param path the absolute path of the input file.
+ * @param st the status of the input file.
+ * @param load_cols the input columns of the frame.
+ * @param num_load_cols
+ * @param sort_col
+ * @param float32
+ * @return 0 on success, else an error.
+ */
+static int clperf_cache_key(char **key, char **name, const char *dir, const char *path, const struct stat *st, const int *load_cols, int num_load_cols, int sort_col, int float32)
+{
+	char buf[512];
+	size_t len;
+	uint64_t h = UINT64_C(0xcbf29ce484222325);
+	char *k;
+	int i;
+
+	snprintf(buf,sizeof(buf),"size=%lld\nmtime=%lld.%09ld\ninode=%llu\nsort=%d\nfloat32=%d\ncolumns=",
+			(long long)st->st_size,(long long)st->st_mtim.tv_sec,(long)st->st_mtim.tv_nsec,
+			(unsigned long long)st->st_ino,sort_col,float32);
+	for (i=0;i<num_load_cols;i++)
+	{
+		len = strlen(buf);
+		snprintf(&buf[len],sizeof(buf) - len,i ? ",%d" : "%d",load_cols[i]);
+	}
+
+	len = strlen(path) + strlen(buf) + 16;
+	if (!(k = (char*)malloc(len)))
+		return -1;
+	snprintf(k,len,"path=%s\n%s\n",path,buf);
+
+	/* FNV-1a */
+	for (i=0;k[i];i++)
+		h = (h ^ (unsigned char)k[i]) * UINT64_C(0x100000001b3);
+
+	len = strlen(dir) + 32;
+	if (!(*name = (char*)malloc(len)))
+	{
+		free(k);
+		return -1;
+	}
+	snprintf(*name,len,"%s/%016" PRIx64 ".sorted",dir,h);
+	*key = k;
+	return 0;
+}
+
+/**
+ * Returns the memory that may be used by default, a quarter of the
+ * physical memory.
+ *
+ * @return the size in bytes.
+ */
+static size_t clperf_default_memory(void)
+{
+	long pages = sysconf(_SC_PHYS_PAGES);
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	return pages > 0 && page_size > 0 ? (size_t)pages * page_size / 4 : (size_t)1024 * 1024 * 1024;
+}
+
+/**
+ * Returns the memory that is used next to the budget and thus the least
+ * budget that is accepted: about 2 MB for the program itself and up to 2 MB
+ * for each thread for the part of a mapped input file that is parsed.
+ *
+ * @param threads
+ * @return the size in bytes.
+ */
+static size_t clperf_min_memory(int threads)
+{
+	return (size_t)(1 + threads) * 2 * 1024 * 1024;
+}
+
+/**
+ * Parses a prediction column argument, which is either a single column
+ * or a range of columns like 2-5, and appends the columns to the given
+ * array.
+ *
+ * @param pred_cols the array to which the columns are appended. It is
+ *  enlarged as needed.
+ * @param num_pred_cols the number of elements within the array.
+ * @param str
+ * @return 0 on success, else an error.
+ */
+static int parse_pred_cols(int **pred_cols, int *num_pred_cols, const char *str)
+{
+	char *end;
+	long first = strtol(str,&end,10);
+	long last = first;
+	long c;
+	int *cols;
+
+	if (end == str)
+		return -1;
+
+	if (*end == '-' && isdigit((unsigned char)*str))
+	{
+		const char *l = end + 1;
+		last = strtol(l,&end,10);
+		if (end == l || last < first)
+			return -1;
+	}
+	if (*end || last - first >= INT_MAX / 2 - *num_pred_cols)
+		return -1;
+
+	if (!(cols = (int*)realloc(*pred_cols,sizeof(cols[0]) * (*num_pred_cols + last - first + 1))))
+		return -1;
+	for (c=first;c<=last;c++)
+		cols[(*num_pred_cols)++] = c;
+	*pred_cols = cols;
+	return 0;
+}
+
 /**
  * Displays usage.
  *
@@ -59,17 +215,59 @@ static int getarg(int argc, char **argv, int *argpos, char *arg, const char **va
 static void usage(const char *cmd)
 {
 	printf(
-			"Usage: %s [OPTION] INPUT LABELCOL PREDCOL\n"
+			"Usage: %s [OPTION] INPUT LABELCOL PREDCOL...\n"
+			"   or: %s convert [OPTION] INPUT OUTPUT\n"
 			"Determines the performance of a classification result that\n"
-			"was stored in a tabular ASCII file.\n"
+			"was stored in a tabular ASCII file or in a binary frame file.\n"
+			"If INPUT is -, the standard input is read. Several prediction\n"
+			"columns, also ranges like 2-5, can be given and are evaluated\n"
+			"at once. The convert command converts a tabular ASCII file\n"
+			"to a binary frame file, which is read without any parsing.\n"
 			"Available options are:\n"
+			"--bootstrap B     determine 95%% confidence intervals of the area\n"
+			"                  under the ROC curve from B Poisson bootstrap\n"
+			"                  replicates, implies --output-format summary\n"
+			"--cache DIR       keep the sorted rows in directory DIR and reuse\n"
+			"                  them as long as the input file doesn't change\n"
+			"--columnar        store the data column by column\n"
+			"--compress        compress the rows that are spilled to external\n"
+			"                  files, which saves I/O on data that exceeds memory\n"
+			"--float32         store non-integer columns with single precision,\n"
+			"                  which halves their memory but rounds the values\n"
+			"--group-by COL    determine the measures for each distinct value\n"
+			"                  of column COL on its own, implies the summary\n"
+			"                  or, with --no-sampling, the tsv output format\n"
 			"--help            show this help\n"
+			"--memory SIZE     memory that may be used, with an optional K, M or\n"
+			"                  G suffix (default a quarter of the physical memory),\n"
+			"                  at least 2M plus 2M per thread\n"
+			"--max-distinct N  aggregate rows as long as there are at most\n"
+			"                  N distinct ones, rows that differ only in their\n"
+			"                  weights count as equal, 0 to disable (default\n"
+			"                  65536)\n"
+			"--negatives COL   the rows are counts: LABELCOL holds the number\n"
+			"                  of positives and COL the number of negatives\n"
 			"--output-format   how the output should look like. Supported\n"
-			"                  values: Rscript (default)\n"
+			"                  values: Rscript (default), summary, and tsv, csv,\n"
+			"                  jsonl and binary (little-endian float64 records),\n"
+			"                  which write the points of the curves and imply\n"
+			"                  --no-sampling\n"
 			"--no-sampling     disable sampling\n"
+			"--points MODE     the points written when sampling is disabled:\n"
+			"                  rows (one per row), thresholds (one per distinct\n"
+			"                  prediction, default) or corners (like thresholds,\n"
+			"                  without points that are collinear in ROC space)\n"
+			"--seed N          seed of the bootstrap (default 0)\n"
+			"--threads N       number of threads (default 1)\n"
 			"--verbose         verbose output during progress\n"
 			"--version         shows the version number\n"
-			"", cmd);
+			"--weight COL      each row counts as often as column COL says\n"
+			"Available options of convert are --columnar, --compress, --float32,\n"
+			"--memory, --threads, --verbose and:\n"
+			"--sort COL        sort the rows by column COL, descending if COL\n"
+			"                  is negative, so the curves of COL can be\n"
+			"                  determined without sorting\n"
+			"", cmd, cmd);
 }
 
 static int clperf_write_data_for_R(FILE *f, data_t *d, const char *var_prefix, const int breaks, int (*function_of_x)(double *, data_t *, double))
@@ -96,32 +294,391 @@ out:
 	return err;
 }
 
-static int clperf_stat_print_callback(uint32_t ps, uint32_t ns, uint32_t tps, uint32_t fps, void *userdata)
+/**
+ * Writes the R commands that plot a curve for each of the prediction
+ * columns.
+ *
+ * @param f
+ * @param main title of the plot
+ * @param var_prefix prefix of the variables, which is followed by the
+ *  1-based number of the prediction column if there are several.
+ * @param pred_cols
+ * @param num_pred_cols
+ * @param xlab
+ * @param ylab
+ * @param legend_pos where the legend is placed, if there are several
+ *  prediction columns.
+ */
+static void clperf_write_plot_for_R(FILE *f, const char *main, const char *var_prefix, const int *pred_cols, int num_pred_cols, const char *xlab, const char *ylab, const char *legend_pos)
+{
+	int j;
+
+	if (num_pred_cols == 1)
+	{
+		fprintf(f,"plot(main=\"%s\",%s.x,%s.y,xlab=\"%s\",ylab=\"%s\",xlim=c(0,1),ylim=c(0,1))\n",main,var_prefix,var_prefix,xlab,ylab);
+		return;
+	}
+
+	fprintf(f,"plot(main=\"%s\",%s1.x,%s1.y,xlab=\"%s\",ylab=\"%s\",xlim=c(0,1),ylim=c(0,1),col=1)\n",main,var_prefix,var_prefix,xlab,ylab);
+	for (j=1;j<num_pred_cols;j++)
+		fprintf(f,"points(%s%d.x,%s%d.y,col=%d)\n",var_prefix,j+1,var_prefix,j+1,j+1);
+	fprintf(f,"legend(\"%s\",legend=c(",legend_pos);
+	for (j=0;j<num_pred_cols;j++)
+		fprintf(f,"\"%d\"%s",pred_cols[j],(j == num_pred_cols - 1) ? "" : ",");
+	fprintf(f,"),col=1:%d,pch=1)\n",num_pred_cols);
+}
+
+/** Formats in which the points of the curves can be written */
+enum clperf_points_format
+{
+	FORMAT_TSV,
+	FORMAT_CSV,
+	FORMAT_JSONL,
+	FORMAT_BINARY
+};
+
+struct clperf_points_output
+{
+	struct fout out;
+	enum clperf_points_format format;
+
+	/** The prediction column that is prepended to each point, if any */
+	const int *pred_col;
+
+	/** The frame whose current group is prepended to each point, if any */
+	data_t *group_frame;
+};
+
+/**
+ * Writes a number of a text format, in JSON non-finite numbers are null.
+ */
+static int clperf_put_number(struct clperf_points_output *po, double v)
+{
+	if (po->format == FORMAT_JSONL && !isfinite(v))
+		return fout_puts(&po->out,"null");
+	return fout_put_double(&po->out,v);
+}
+
+/**
+ * Writes the header of the points, if the format has one.
+ *
+ * @param po
+ * @param with_col whether the points are prefixed by the prediction column.
+ * @param with_group whether the points are prefixed by the group.
+ * @return 0 on success, else an error.
+ */
+static int clperf_write_points_header(struct clperf_points_output *po, int with_col, int with_group)
+{
+	const char *sep;
+
+	switch (po->format)
+	{
+		case	FORMAT_TSV: sep = "\t"; break;
+		case	FORMAT_CSV: sep = ","; break;
+		default: return 0;
+	}
+
+	if (with_col)
+	{
+		fout_puts(&po->out,"column");
+		fout_puts(&po->out,sep);
+	}
+	if (with_group)
+	{
+		fout_puts(&po->out,"group");
+		fout_puts(&po->out,sep);
+	}
+	fout_puts(&po->out,"tpr");
+	fout_puts(&po->out,sep);
+	fout_puts(&po->out,"fpr");
+	fout_puts(&po->out,sep);
+	fout_puts(&po->out,"precision");
+	fout_puts(&po->out,sep);
+	return fout_puts(&po->out,"recall\n");
+}
+
+static int clperf_stat_write_callback(uint64_t ps, uint64_t ns, uint64_t tps, uint64_t fps, void *userdata)
+{
+	static const char *json_keys[] = {"{\"tpr\":", ",\"fpr\":", ",\"precision\":", ",\"recall\":"};
+	struct clperf_points_output *po = (struct clperf_points_output*)userdata;
+	double values[4];
+	double group = 0;
+	int i;
+
+	if (po->group_frame && data_get_stat_group(&group,po->group_frame))
+		return -1;
+
+	values[0] = (double)tps / ps; /* true positive rate */
+	values[1] = (double)fps / ns; /* false positive rate */
+	values[2] = (double)tps / (tps + fps); /* precision */
+	values[3] = (double)tps / ps; /* recall */
+
+	if (po->format == FORMAT_BINARY)
+	{
+		if (po->pred_col && fout_put_double_le(&po->out,*po->pred_col))
+			return -1;
+		if (po->group_frame && fout_put_double_le(&po->out,group))
+			return -1;
+		for (i=0;i<4;i++)
+		{
+			if (fout_put_double_le(&po->out,values[i]))
+				return -1;
+		}
+		return 0;
+	}
+
+	if (po->format == FORMAT_JSONL)
+	{
+		if (po->pred_col)
+		{
+			char col[32];
+			snprintf(col,sizeof(col),"{\"column\":%d,",*po->pred_col);
+			fout_puts(&po->out,col);
+		}
+		if (po->group_frame)
+		{
+			fout_puts(&po->out,po->pred_col ? "\"group\":" : "{\"group\":");
+			clperf_put_number(po,group);
+			fout_puts(&po->out,",");
+		}
+		for (i=0;i<4;i++)
+		{
+			fout_puts(&po->out,&json_keys[i][(po->pred_col || po->group_frame) && !i ? 1 : 0]);
+			clperf_put_number(po,values[i]);
+		}
+		return fout_puts(&po->out,"}\n");
+	}
+
+	if (po->pred_col)
+	{
+		char col[32];
+		snprintf(col,sizeof(col),"%d",*po->pred_col);
+		fout_puts(&po->out,col);
+		fout_puts(&po->out,po->format == FORMAT_CSV ? "," : "\t");
+	}
+	if (po->group_frame)
+	{
+		clperf_put_number(po,group);
+		fout_puts(&po->out,po->format == FORMAT_CSV ? "," : "\t");
+	}
+	for (i=0;i<4;i++)
+	{
+		clperf_put_number(po,values[i]);
+		fout_puts(&po->out,i == 3 ? "\n" : (po->format == FORMAT_CSV ? "," : "\t"));
+	}
+	return po->out.err;
+}
+
+static int clperf_stat_print_callback(uint64_t ps, uint64_t ns, uint64_t tps, uint64_t fps, void *userdata)
 {
+	const int *pred_col = (const int*)userdata;
 	double tpr = (double)tps / ps; /* true positive rate */
 	double fpr = (double)fps / ns; /* false positive rate */
 	double prec = (double)tps / (tps + fps); /* precision = true positives / (number of all positives = (true positives + false positives) */
 	double recall = (double)tps / ps; /* recall = number of true positives / (true positives + false negatives = all positive samples) */
 
+	if (pred_col)
+		fprintf(stdout,"%d ",*pred_col);
 	fprintf(stdout,"%lf %lf %lf %lf\n",tpr,fpr,prec,recall);
 	return 0;
 }
 
+/**
+ * Implements the convert command, which converts a tabular ASCII file
+ * to a binary frame file.
+ *
+ * @param cmd the name of the program
+ * @param argc the number of arguments following the command
+ * @param argv the arguments following the command
+ * @return the exit code.
+ */
+static int clperf_convert(const char *cmd, int argc, char **argv)
+{
+	int rc = EXIT_FAILURE;
+	int i;
+	data_t *d = NULL;
+	const char *input = NULL;
+	const char *output = NULL;
+	const char *threads = NULL;
+	const char *memory = NULL;
+	const char *sort = NULL;
+	size_t memory_budget = clperf_default_memory();
+	int num_threads = 1;
+	int sort_col = 0;
+	int columnar = 0;
+	int compress = 0;
+	int float32 = 0;
+	int verbose = 0;
+
+	for (i=0;i<argc;i++)
+	{
+		if (getarg(argc,argv,&i,"--threads",&threads)) continue;
+		if (getarg(argc,argv,&i,"--memory",&memory)) continue;
+		if (getarg(argc,argv,&i,"--sort",&sort)) continue;
+
+		if (!strcmp("--columnar",argv[i]))
+		{
+			columnar = 1;
+		} else if (!strcmp("--compress",argv[i]))
+		{
+			compress = 1;
+		} else if (!strcmp("--float32",argv[i]))
+		{
+			float32 = 1;
+		} else if (!strcmp("--verbose",argv[i]))
+		{
+			verbose = 1;
+		} else if (argv[i][0] == '-' && argv[i][1])
+		{
+			fprintf(stderr,"%s: Unknown option \"%s\"\n",cmd,argv[i]);
+			goto out;
+		} else
+		{
+			if (!input) input = argv[i];
+			else if (!output) output = argv[i];
+			else
+			{
+				fprintf(stderr,"%s: Too many arguments for convert\n",cmd);
+				goto out;
+			}
+		}
+	}
+
+	if (!input || !output)
+	{
+		fprintf(stderr,"%s: convert requires an input and an output file\n",cmd);
+		goto out;
+	}
+
+	if (threads && (num_threads = atoi(threads)) < 1)
+	{
+		fprintf(stderr,"%s: Invalid number of threads \"%s\"\n",cmd,threads);
+		goto out;
+	}
+
+	if (memory && parse_size(&memory_budget,memory))
+	{
+		fprintf(stderr,"%s: Invalid memory size \"%s\"\n",cmd,memory);
+		goto out;
+	}
+	if (memory && memory_budget < clperf_min_memory(num_threads))
+	{
+		fprintf(stderr,"%s: Memory size \"%s\" is below the fixed overhead of %zuM with %d threads\n",cmd,memory,clperf_min_memory(num_threads) >> 20,num_threads);
+		goto out;
+	}
+
+	if (sort)
+	{
+		char *end;
+		long col = strtol(sort,&end,10);
+
+		if (*end || !*sort || col < INT_MIN || col > INT_MAX)
+		{
+			fprintf(stderr,"%s: Invalid sort column \"%s\"\n",cmd,sort);
+			goto out;
+		}
+		sort_col = col;
+	}
+
+	if (data_create(&d))
+		goto out;
+	data_set_memory_budget(d,memory_budget);
+	data_set_number_of_threads(d,num_threads);
+	data_set_spill_compression(d,compress);
+	data_set_float32(d,float32);
+	if (columnar)
+		data_set_layout(d,LAYOUT_COLUMNS);
+
+	if (data_load_from_ascii(d,input))
+	{
+		fprintf(stderr,"Couldn't load \"%s\"\n",input);
+		goto out;
+	}
+
+	if (verbose)
+		fprintf(stderr,"Read data frame with %d lines and %d columns\n",data_get_number_of_rows(d),data_get_number_of_columns(d));
+
+	if (sort)
+	{
+		if (abs(sort_col) >= data_get_number_of_columns(d))
+		{
+			fprintf(stderr,"%s: Sort column %d is out of bounds\n",cmd,sort_col);
+			goto out;
+		}
+		if (data_sort_v(d,1,sort_col))
+		{
+			fprintf(stderr,"Couldn't sort \"%s\"\n",input);
+			goto out;
+		}
+	}
+
+	if (data_save_binary(d,output,NULL))
+	{
+		fprintf(stderr,"Couldn't write \"%s\"\n",output);
+		goto out;
+	}
+	rc = EXIT_SUCCESS;
+out:
+	data_free(d);
+	return rc;
+}
+
 int main(int argc, char **argv)
 {
 	int rc;
 	int i;
 	int err = -1;
-	data_t *d = NULL;
+	data_t **frames = NULL;
+	char (*frame_filenames)[32] = NULL;
+	int num_frames = 0;
 	int nrows;
 	int ncols;
+	int *load_cols = NULL;
+	int *sort_cols = NULL;
+	int *pred_cols = NULL;
+	data_t **load_frames = NULL;
+	int num_load_frames = 0;
+	int num_pred_cols = 0;
+	int presort;
+	struct stat st;
+	struct clperf_points_output points_output;
+	int points_output_initialized = 0;
+	int points_format = -1;
 
 	const char *filename = NULL;
 	const char *output_format = NULL;
+	const char *threads = NULL;
+	const char *max_distinct = NULL;
+	const char *memory = NULL;
+	const char *points = NULL;
+	const char *bootstrap = NULL;
+	const char *seed = NULL;
+	const char *weight = NULL;
+	const char *negatives = NULL;
+	const char *group_by = NULL;
+	const char *cache_dir = NULL;
+	char *input_path = NULL;
+	char **cache_keys = NULL;
+	char **cache_names = NULL;
+	int *cached = NULL;
+	int num_cached = 0;
+	int group_col = -1;
+	int frame_group_col = -1;
+	int presort_cols[2];
+	int weight_col = -1;
+	int negatives_col = -1;
+	int num_load_cols;
+	uint32_t bootstrap_replicates = 0;
+	uint64_t bootstrap_seed = 0;
+	enum data_stat_points_t stat_points = POINTS_THRESHOLDS;
+	size_t memory_budget;
 	int label_col = INT_MIN;
-	int pred_col = INT_MIN;
+	int num_threads = 1;
 	int verbose = 0;
 	int sampling = 1;
+	int columnar = 0;
+	int compress = 0;
+	int float32 = 0;
 
 	const char *cmd;
 
@@ -130,9 +687,22 @@ int main(int argc, char **argv)
 
 	rc = EXIT_FAILURE;
 
+	if (argc > 1 && !strcmp(argv[1],"convert"))
+		return clperf_convert(cmd,argc - 2,argv + 2);
+
 	for (i=1;i<argc;i++)
 	{
 		if (getarg(argc,argv,&i,"--output-format",&output_format)) continue;
+		if (getarg(argc,argv,&i,"--threads",&threads)) continue;
+		if (getarg(argc,argv,&i,"--max-distinct",&max_distinct)) continue;
+		if (getarg(argc,argv,&i,"--memory",&memory)) continue;
+		if (getarg(argc,argv,&i,"--points",&points)) continue;
+		if (getarg(argc,argv,&i,"--bootstrap",&bootstrap)) continue;
+		if (getarg(argc,argv,&i,"--seed",&seed)) continue;
+		if (getarg(argc,argv,&i,"--weight",&weight)) continue;
+		if (getarg(argc,argv,&i,"--negatives",&negatives)) continue;
+		if (getarg(argc,argv,&i,"--group-by",&group_by)) continue;
+		if (getarg(argc,argv,&i,"--cache",&cache_dir)) continue;
 
 		if (!strcmp("--help",argv[i]) || !strcmp("-h",argv[i]))
 		{
@@ -151,7 +721,16 @@ int main(int argc, char **argv)
 		} else if (!strcmp("--no-sampling",argv[i]))
 		{
 			sampling = 0;
-		} else if (argv[i][0] == '-' && !isdigit((unsigned char)argv[i][1]))
+		} else if (!strcmp("--columnar",argv[i]))
+		{
+			columnar = 1;
+		} else if (!strcmp("--compress",argv[i]))
+		{
+			compress = 1;
+		} else if (!strcmp("--float32",argv[i]))
+		{
+			float32 = 1;
+		} else if (argv[i][0] == '-' && argv[i][1] && !isdigit((unsigned char)argv[i][1]))
 		{
 			fprintf(stderr,"%s: Unknown option \"%s\"",filename,argv[i]);
 			goto out;
@@ -159,10 +738,9 @@ int main(int argc, char **argv)
 		{
 			if (!filename) filename = argv[i];
 			else if (label_col == INT_MIN) label_col = atoi((argv[i]));
-			else if (pred_col == INT_MIN) pred_col = atoi(argv[i]);
-			else
+			else if (parse_pred_cols(&pred_cols,&num_pred_cols,argv[i]))
 			{
-				fprintf(stderr,"%s: Too many arguments!\n",cmd);
+				fprintf(stderr,"%s: Invalid prediction column \"%s\"\n",cmd,argv[i]);
 				goto out;
 			}
 		}
@@ -174,10 +752,72 @@ int main(int argc, char **argv)
 		goto out;
 	}
 
+	if (bootstrap)
+	{
+		char *end;
+		unsigned long b = strtoul(bootstrap,&end,10);
+
+		if (*end || !*bootstrap || !b || b > UINT32_MAX)
+		{
+			fprintf(stderr,"%s: Invalid number of bootstrap replicates \"%s\"\n",cmd,bootstrap);
+			goto out;
+		}
+		bootstrap_replicates = b;
+
+		if (!output_format)
+			output_format = "summary";
+		else if (strcmp(output_format,"summary"))
+		{
+			fprintf(stderr,"%s: --bootstrap requires the summary output format\n",cmd);
+			goto out;
+		}
+	}
+
+	if (seed)
+	{
+		char *end;
+
+		bootstrap_seed = strtoull(seed,&end,10);
+		if (*end || !*seed)
+		{
+			fprintf(stderr,"%s: Invalid seed \"%s\"\n",cmd,seed);
+			goto out;
+		}
+	}
+
+	if (group_by)
+	{
+		if ((group_col = atoi(group_by)) < 0)
+		{
+			fprintf(stderr,"%s: Invalid group column \"%s\"\n",cmd,group_by);
+			goto out;
+		}
+		if (bootstrap)
+		{
+			fprintf(stderr,"%s: --group-by can't be combined with --bootstrap\n",cmd);
+			goto out;
+		}
+		if (!output_format)
+			output_format = sampling ? "summary" : "tsv";
+		else if (!strcmp(output_format,"Rscript"))
+		{
+			fprintf(stderr,"%s: --group-by requires another output format than Rscript\n",cmd);
+			goto out;
+		}
+	}
+
 	if (!output_format)
 		output_format = "Rscript";
 
-	if (strcmp(output_format,"Rscript"))
+	if (!strcmp(output_format,"tsv")) points_format = FORMAT_TSV;
+	else if (!strcmp(output_format,"csv")) points_format = FORMAT_CSV;
+	else if (!strcmp(output_format,"jsonl")) points_format = FORMAT_JSONL;
+	else if (!strcmp(output_format,"binary")) points_format = FORMAT_BINARY;
+
+	if (points_format >= 0)
+	{
+		sampling = 0;
+	} else if (strcmp(output_format,"Rscript") && strcmp(output_format,"summary"))
 	{
 		fprintf(stderr,"%s: Unknown output format \"%s\"\n",cmd,output_format);
 		goto out;
@@ -189,43 +829,271 @@ int main(int argc, char **argv)
 		goto out;
 	}
 
-	if (pred_col == INT_MIN)
+	if (!num_pred_cols)
 	{
 		fprintf(stderr,"%s: No prediction column specified\n",cmd);
 		goto out;
 	}
 
-	if ((err = data_create(&d)))
+	if (label_col < 0)
+	{
+		fprintf(stderr,"Specified label column out of bounds.\n");
+		goto out;
+	}
+
+	if (weight && negatives)
+	{
+		fprintf(stderr,"%s: --weight and --negatives can't be combined\n",cmd);
 		goto out;
+	}
 
-	if ((err = data_load_from_ascii(d,filename)))
+	if ((weight && (weight_col = atoi(weight)) < 0) || (negatives && (negatives_col = atoi(negatives)) < 0))
 	{
-		fprintf(stderr,"Couldn't load \"%s\"\n",filename);
+		fprintf(stderr,"%s: Invalid weight column \"%s\"\n",cmd,weight ? weight : negatives);
 		goto out;
 	}
 
-	nrows = data_get_number_of_rows(d);
-	ncols = data_get_number_of_columns(d);
+	if (threads && (num_threads = atoi(threads)) < 1)
+	{
+		fprintf(stderr,"%s: Invalid number of threads \"%s\"\n",cmd,threads);
+		goto out;
+	}
 
-	if (verbose)
-		fprintf(stderr,"Read data frame with %d lines and %d columns\n",nrows,ncols);
+	if (max_distinct && atoi(max_distinct) < 0)
+	{
+		fprintf(stderr,"%s: Invalid number of distinct rows \"%s\"\n",cmd,max_distinct);
+		goto out;
+	}
 
-	if (label_col < 0 || label_col >= ncols)
+	if (points)
 	{
-		fprintf(stderr,"Specified label column out of bounds.\n");
+		if (!strcmp(points,"rows")) stat_points = POINTS_ROWS;
+		else if (!strcmp(points,"thresholds")) stat_points = POINTS_THRESHOLDS;
+		else if (!strcmp(points,"corners")) stat_points = POINTS_CORNERS;
+		else
+		{
+			fprintf(stderr,"%s: Unknown points \"%s\"\n",cmd,points);
+			goto out;
+		}
+	}
+
+	if (memory)
+	{
+		if (parse_size(&memory_budget,memory))
+		{
+			fprintf(stderr,"%s: Invalid memory size \"%s\"\n",cmd,memory);
+			goto out;
+		}
+		if (memory_budget < clperf_min_memory(num_threads))
+		{
+			fprintf(stderr,"%s: Memory size \"%s\" is below the fixed overhead of %zuM with %d threads\n",cmd,memory,clperf_min_memory(num_threads) >> 20,num_threads);
+			goto out;
+		}
+	} else
+	{
+		memory_budget = clperf_default_memory();
+	}
+
+	/* Input that arrives through a pipe is sorted while it is read */
+	presort = !strcmp(filename,"-") || (!stat(filename,&st) && !S_ISREG(st.st_mode));
+
+	/* Each prediction column is loaded together with the label column
+	 * into a frame of its own, in which they are the columns 0 and 1.
+	 * The frames share the memory budget */
+	if (!(frames = (data_t**)calloc(num_pred_cols,sizeof(frames[0]))))
+		goto out;
+	if (!(frame_filenames = calloc(num_pred_cols,sizeof(frame_filenames[0]))))
+		goto out;
+	/* A weight or negatives column becomes column 2 of each frame,
+	 * the group column follows */
+	num_load_cols = weight_col >= 0 || negatives_col >= 0 ? 3 : 2;
+	if (group_col >= 0)
+		frame_group_col = num_load_cols++;
+	if (!(load_cols = (int*)malloc(sizeof(load_cols[0]) * num_load_cols * num_pred_cols)))
+		goto out;
+	if (!(sort_cols = (int*)malloc(sizeof(sort_cols[0]) * num_pred_cols)))
+		goto out;
+
+	for (i=0;i<num_pred_cols;i++)
+	{
+		data_t *d;
+
+		if ((err = data_create(&frames[i])))
+			goto out;
+		num_frames++;
+		d = frames[i];
+
+		if (num_pred_cols > 1)
+		{
+			snprintf(frame_filenames[i],sizeof(frame_filenames[i]),"out.%d",i);
+			data_set_external_filename(d,frame_filenames[i]);
+		}
+
+		data_set_memory_budget(d,memory_budget / num_pred_cols);
+
+		data_set_max_distinct_rows(d,0,max_distinct ? atoi(max_distinct) : 65536);
+
+		data_set_number_of_threads(d,num_threads);
+		data_set_spill_compression(d,compress);
+		data_set_float32(d,float32);
+		if (columnar)
+			data_set_layout(d,LAYOUT_COLUMNS);
+
+		load_cols[num_load_cols*i] = label_col;
+		load_cols[num_load_cols*i+1] = abs(pred_cols[i]);
+		sort_cols[i] = pred_cols[i] < 0 ? -1 : 1;
+
+		if (num_load_cols > 2 + (group_col >= 0))
+		{
+			load_cols[num_load_cols*i+2] = weight_col >= 0 ? weight_col : negatives_col;
+			data_set_weight_columns(d,weight_col >= 0 ? 2 : -1,negatives_col >= 0 ? 2 : -1);
+		}
+
+		if (group_col >= 0)
+		{
+			load_cols[num_load_cols*i+frame_group_col] = group_col;
+			data_set_group_column(d,frame_group_col);
+		}
+
+		/* Groups are sorted by the group column first */
+		presort_cols[0] = frame_group_col;
+		presort_cols[1] = sort_cols[i];
+		if (presort)
+			data_set_presort_columns(d,0,group_col >= 0 ? 2 : 1,&presort_cols[group_col >= 0 ? 0 : 1]);
+	}
+
+	/* Only regular files can be identified well enough to be cached */
+	if (cache_dir && !presort)
+	{
+		if (mkdir(cache_dir,0777) && errno != EEXIST)
+		{
+			fprintf(stderr,"%s: Couldn't create the cache directory \"%s\"\n",cmd,cache_dir);
+			goto out;
+		}
+		if (!(input_path = realpath(filename,NULL)))
+		{
+			fprintf(stderr,"%s: Couldn't resolve \"%s\"\n",cmd,filename);
+			goto out;
+		}
+		if (!(cache_keys = (char**)calloc(num_frames,sizeof(cache_keys[0]))))
+			goto out;
+		if (!(cache_names = (char**)calloc(num_frames,sizeof(cache_names[0]))))
+			goto out;
+		if (!(cached = (int*)calloc(num_frames,sizeof(cached[0]))))
+			goto out;
+
+		for (i=0;i<num_frames;i++)
+		{
+			if ((err = clperf_cache_key(&cache_keys[i],&cache_names[i],cache_dir,input_path,&st,&load_cols[num_load_cols*i],num_load_cols,sort_cols[i],float32)))
+				goto out;
+
+			/* A frame that can't be restored is loaded as usual */
+			if (!data_load_binary(frames[i],cache_names[i],cache_keys[i]))
+			{
+				cached[i] = 1;
+				num_cached++;
+			}
+		}
+		if (verbose)
+			fprintf(stderr,"Restored %d of %d frames from the cache\n",num_cached,num_frames);
+	}
+
+	/* The frames that weren't restored are loaded at once */
+	if (!(load_frames = (data_t**)malloc(sizeof(load_frames[0]) * num_frames)))
 		goto out;
+	for (i=0;i<num_frames;i++)
+	{
+		if (cached && cached[i])
+			continue;
+		memmove(&load_cols[num_load_cols*num_load_frames],&load_cols[num_load_cols*i],sizeof(load_cols[0]) * num_load_cols);
+		load_frames[num_load_frames++] = frames[i];
 	}
 
-	if (abs(pred_col) >= ncols)
+	/* Binary frame files need no parsing */
+	if (num_load_frames && !presort && data_is_binary_file(filename))
+		err = data_load_from_binary_split(load_frames,num_load_frames,filename,num_load_cols,load_cols);
+	else if (num_load_frames == 1)
+		err = data_load_from_ascii_projected(load_frames[0],filename,num_load_cols,load_cols);
+	else if (num_load_frames)
+		err = data_load_from_ascii_split(load_frames,num_load_frames,filename,num_load_cols,load_cols);
+	if (err)
 	{
-		fprintf(stderr,"Specified prediction column out of bounds.\n");
+		fprintf(stderr,"Couldn't load \"%s\"\n",filename);
 		goto out;
 	}
 
-	if (sampling)
+	/* Frames whose rows remain aggregated are cheap to evaluate and
+	 * aren't cached, the others are left sorted so they can be */
+	for (i=0;cached && i<num_frames;i++)
+	{
+		if (cached[i])
+			continue;
+		if (data_has_aggregated_rows(frames[i]))
+			cached[i] = -1;
+		else
+			data_set_keep_sorted(frames[i],1);
+	}
+
+	nrows = data_get_number_of_rows(frames[0]);
+	ncols = data_get_number_of_input_columns(frames[0]);
+
+	if (verbose)
+		fprintf(stderr,"Read data frame with %d lines and %d columns\n",nrows,ncols);
+
+	/* The threads are divided among the frames that are processed at once */
+	for (i=0;i<num_frames;i++)
+	{
+		data_set_number_of_threads(frames[i],num_threads / num_frames);
+		data_set_bootstrap(frames[i],bootstrap_replicates,bootstrap_seed);
+	}
+
+	if (!strcmp("summary",output_format))
+	{
+		if ((err = data_stat_hist_frames(frames,num_frames,num_threads,0,0,1,sort_cols)))
+		{
+			fprintf(stderr,"Couldn't determine stat\n");
+			goto out;
+		}
+
+		fprintf(stdout,"column%s\tpositives\tnegatives\tauc_roc\taverage_precision\tauc_pr\tks\tmax_f1%s\n",
+				group_col >= 0 ? "\tgroup" : "",bootstrap_replicates ? "\tauc_roc_lower\tauc_roc_upper" : "");
+		for (i=0;i<num_frames && group_col >= 0;i++)
+		{
+			struct data_group_summary gs;
+			uint32_t g;
+
+			for (g=0;!data_get_group_summary(&gs,frames[i],g);g++)
+			{
+				fprintf(stdout,"%d\t%.17g\t%" PRIu64 "\t%" PRIu64 "\t%.12g\t%.12g\t%.12g\t%.12g\t%.12g\n",
+						pred_cols[i],gs.value,gs.summary.positives,gs.summary.negatives,gs.summary.auc_roc,
+						gs.summary.average_precision,gs.summary.auc_pr,gs.summary.ks,gs.summary.max_f1);
+			}
+		}
+		for (i=0;i<num_frames && group_col < 0;i++)
+		{
+			struct data_summary sum;
+
+			if ((err = data_get_summary(&sum,frames[i])))
+				goto out;
+			fprintf(stdout,"%d\t%" PRIu64 "\t%" PRIu64 "\t%.12g\t%.12g\t%.12g\t%.12g\t%.12g",
+					pred_cols[i],sum.positives,sum.negatives,sum.auc_roc,sum.average_precision,sum.auc_pr,sum.ks,sum.max_f1);
+			if (bootstrap_replicates)
+			{
+				double lower, upper;
+
+				if ((err = data_get_bootstrap_auc_roc(&lower,&upper,frames[i],0.95)))
+				{
+					fprintf(stderr,"Couldn't determine the bootstrap confidence interval\n");
+					goto out;
+				}
+				fprintf(stdout,"\t%.12g\t%.12g",lower,upper);
+			}
+			fprintf(stdout,"\n");
+		}
+	} else if (sampling)
 	{
 		const int breaks = 1001;
-		if ((err = data_stat_hist(d,breaks,label_col,1,&pred_col)))
+		if ((err = data_stat_hist_frames(frames,num_frames,num_threads,breaks,0,1,sort_cols)))
 		{
 			fprintf(stderr,"Couldn't determine stat\n");
 			goto out;
@@ -234,22 +1102,105 @@ int main(int argc, char **argv)
 		if (!strcmp("Rscript",output_format))
 		{
 			fprintf(stdout,"#/usr/bin/Rscript --vanilla\n");
-			clperf_write_data_for_R(stdout, d, "roc.", breaks, data_get_tpr_by_fpr);
-			clperf_write_data_for_R(stdout, d, "precall.", breaks, data_get_precision_by_recall);
+			for (i=0;i<num_frames;i++)
+			{
+				char roc_prefix[32];
+				char precall_prefix[32];
+
+				if (num_frames == 1)
+				{
+					strcpy(roc_prefix,"roc.");
+					strcpy(precall_prefix,"precall.");
+				} else
+				{
+					snprintf(roc_prefix,sizeof(roc_prefix),"roc%d.",i+1);
+					snprintf(precall_prefix,sizeof(precall_prefix),"precall%d.",i+1);
+				}
+				clperf_write_data_for_R(stdout, frames[i], roc_prefix, breaks, data_get_tpr_by_fpr);
+				clperf_write_data_for_R(stdout, frames[i], precall_prefix, breaks, data_get_precision_by_recall);
+			}
 			fprintf(stdout,"pdf(width=10,height=5)\n");
 			fprintf(stdout,"par(mfrow=c(1,2))\n");
-			fprintf(stdout,"plot(main=\"ROC\",roc.x,roc.y,xlab=\"False positive rate\",ylab=\"True positive rate\",xlim=c(0,1),ylim=c(0,1))\n");
-			fprintf(stdout,"plot(main=\"Precision/Recall\",precall.x,precall.y,xlab=\"Recall\",ylab=\"Precision\",xlim=c(0,1),ylim=c(0,1))\n");
+			clperf_write_plot_for_R(stdout,"ROC","roc",pred_cols,num_frames,"False positive rate","True positive rate","bottomright");
+			clperf_write_plot_for_R(stdout,"Precision/Recall","precall",pred_cols,num_frames,"Recall","Precision","topright");
 			fprintf(stdout,"dev.off()\n");
 		}
 	} else
 	{
-		if ((err = data_stat_callback(d, clperf_stat_print_callback, NULL, label_col, 1, &pred_col)))
-			goto out;
+		if (points_format >= 0)
+		{
+			if ((err = fout_init(&points_output.out,STDOUT_FILENO,1024 * 1024)))
+				goto out;
+			points_output_initialized = 1;
+			points_output.format = points_format;
+			if ((err = clperf_write_points_header(&points_output,num_frames > 1,group_col >= 0)))
+				goto out;
+		} else
+		{
+			setvbuf(stdout,NULL,_IOFBF,1024 * 1024);
+		}
+
+		/* With several prediction columns, each line starts with the column */
+		for (i=0;i<num_frames;i++)
+		{
+			data_set_stat_points(frames[i],stat_points);
+			if (points_format >= 0)
+			{
+				points_output.pred_col = num_frames > 1 ? &pred_cols[i] : NULL;
+				points_output.group_frame = group_col >= 0 ? frames[i] : NULL;
+				err = data_stat_callback(frames[i], clperf_stat_write_callback, &points_output, 0, 1, &sort_cols[i]);
+			} else
+			{
+				err = data_stat_callback(frames[i], clperf_stat_print_callback, num_frames > 1 ? &pred_cols[i] : NULL, 0, 1, &sort_cols[i]);
+			}
+			if (err)
+				goto out;
+		}
+
+		if (points_output_initialized)
+		{
+			points_output_initialized = 0;
+			if ((err = fout_deinit(&points_output.out)))
+				goto out;
+		}
+	}
+
+	/* A cache that can't be written doesn't affect the result */
+	for (i=0;cached && i<num_frames;i++)
+	{
+		if (!cached[i] && data_save_binary(frames[i],cache_names[i],cache_keys[i]))
+			fprintf(stderr,"%s: Couldn't cache the sorted rows in \"%s\"\n",cmd,cache_names[i]);
+	}
+
+	if (verbose)
+	{
+		for (i=0;i<num_frames;i++)
+		{
+			uint64_t refills, waits;
+			data_get_merge_io_stats(frames[i],&refills,&waits);
+			fprintf(stderr,"Merge read %" PRIu64 " chunks ahead, waited for %" PRIu64 " of them\n",refills,waits);
+		}
 	}
 
 	rc = EXIT_SUCCESS;
 out:
-	if (d) data_free(d);
+	if (points_output_initialized)
+		fout_deinit(&points_output.out);
+	for (i=0;i<num_frames;i++)
+	{
+		data_free(frames[i]);
+		if (cache_keys) free(cache_keys[i]);
+		if (cache_names) free(cache_names[i]);
+	}
+	free(cache_keys);
+	free(cache_names);
+	free(cached);
+	free(input_path);
+	free(load_frames);
+	free(frames);
+	free(frame_filenames);
+	free(load_cols);
+	free(sort_cols);
+	free(pred_cols);
 	return rc;
 }
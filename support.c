@@ -7,6 +7,10 @@
 #include <ctype.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <malloc.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -14,7 +18,13 @@
 #include <string.h>
 #include <time.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "support.h"
+#include "pow5_table.h"
 
 #ifdef DEBUG
 #define D(txt,...) fprintf(stderr,txt,__VA_ARGS__)
@@ -29,1180 +39,8353 @@
 
 #define FIO_FIRST_LINES 8
 
+/** Initial size of the buffer used when the input cannot be mapped */
+#define FIO_STREAM_BUFFER_SIZE (1024 * 1024)
+
+/** Pages of a mapping are released whenever that many bytes have been read */
+#define FIO_RELEASE_BYTES (1024 * 1024)
+
+/** Largest block of a mapped file that the kernel may map at once on a fault */
+#define FIO_MAP_GRANULE (2 * 1024 * 1024)
+
+/**
+ * Line oriented input. Regular files are mapped into memory and lines
+ * are handed out as views into the mapping, i.e., without copying. Other
+ * inputs (pipes, character devices) are streamed through a growing buffer.
+ * In both cases, a returned line is always terminated by a '\n' and is
+ * valid until the next call to fio_read_next_line().
+ */
 struct fio
 {
-	FILE *file;
-	int file_was_opened;
+	int fd;
+	int fd_was_opened;
+
+	/** The mapped file or NULL, if the input is streamed */
+	const char *map;
+	size_t map_size;
+
+	/** The stream buffer, only used if map is NULL */
+	char *buf;
+	size_t buf_size;
+	size_t buf_len;
+	int eof;
+
+	/** Read position in map or buf */
+	size_t pos;
+
+	/** Position in map before which the pages have been released */
+	size_t released;
+
+	/** Copy of the last line, if it was not terminated by a newline */
+	char *tail;
+
+	/** Copy of the first lines, if the input is streamed */
+	char *head;
+
 	int current_line_nr;
-	char *current_line;
-	char *first_lines[FIO_FIRST_LINES];
+	const char *first_lines[FIO_FIRST_LINES];
+	size_t first_lines_len[FIO_FIRST_LINES];
 };
 
-int fio_init_by_file(struct fio *f, const char *filename)
+/**
+ * Releases the pages of a mapping that overlap the given range. As the
+ * mapping is private and never written, the pages are read again from
+ * the file when they are accessed afterwards, so this only limits the
+ * memory that is occupied by input that has already been processed.
+ *
+ * A fault may map a whole block of FIO_MAP_GRANULE bytes, which reaches
+ * back into pages that have been released before, so these are released
+ * once more.
+ *
+ * @param map the start of the mapping.
+ * @param start
+ * @param end
+ */
+static void fio_release_range(const char *map, const char *start, const char *end)
 {
-	int err;
-	int i;
-	FILE *file;
+	uintptr_t page_size = sysconf(_SC_PAGESIZE);
+	uintptr_t s;
 
-	err = -1;
+	start = (size_t)(start - map) > FIO_MAP_GRANULE ? start - FIO_MAP_GRANULE : map;
+	s = (uintptr_t)start & ~(page_size - 1);
+	uintptr_t e = ((uintptr_t)end + page_size - 1) & ~(page_size - 1);
 
-	memset(f,0,sizeof(*f));
-	if (!(file = fopen(filename,"r")))
-		goto out;
+	if (s < e)
+		madvise((void*)s, e - s, MADV_DONTNEED);
+}
+
+/**
+ * Reads more data into the stream buffer. Data before the read position
+ * is discarded and the buffer is enlarged, if it is full.
+ *
+ * @param f
+ * @return 0 on success, else an error.
+ */
+static int fio_stream_fill(struct fio *f)
+{
+	ssize_t r;
 
-	f->file = file;
-	f->file_was_opened = 1;
+	if (f->pos)
+	{
+		memmove(f->buf, f->buf + f->pos, f->buf_len - f->pos);
+		f->buf_len -= f->pos;
+		f->pos = 0;
+	}
 
-	for (i=0;i<FIO_FIRST_LINES;i++)
+	/* One byte is reserved for an artificial newline */
+	if (f->buf_len + 1 >= f->buf_size)
 	{
-		size_t len = 0;
+		size_t new_size = f->buf_size?f->buf_size * 2:FIO_STREAM_BUFFER_SIZE;
+		char *new_buf;
 
-		if (getline(&f->first_lines[i],&len,f->file) < 0)
-			break;
+		if (!(new_buf = (char*)realloc(f->buf,new_size)))
+			return -1;
+		f->buf = new_buf;
+		f->buf_size = new_size;
 	}
-	err = 0;
-out:
-	return err;
+
+	do
+	{
+		r = read(f->fd, f->buf + f->buf_len, f->buf_size - f->buf_len - 1);
+	} while (r < 0 && errno == EINTR);
+
+	if (r < 0)
+		return -1;
+	if (r == 0)
+		f->eof = 1;
+	f->buf_len += r;
+	return 0;
 }
 
 /**
- * Reads a single line.
+ * Determines the next line of the underlying input without considering
+ * the first lines.
  *
- * @param line
+ * @param line where the start of the line is stored.
+ * @param len where the length of the line (including the newline) is stored.
  * @param f
- * @return
+ * @return 0 on success, else an error or end of input.
  */
-int fio_read_next_line(const char **line, struct fio *f)
+static int fio_next_raw_line(const char **line, size_t *len, struct fio *f)
 {
-	char *l;
-	int err;
-
-	err = -1;
+	const char *nl;
 
-	if (f->current_line)
+	if (f->map)
 	{
-		free(f->current_line);
-		f->current_line = NULL;
-	}
+		size_t rem = f->map_size - f->pos;
 
-	if (f->current_line_nr < FIO_FIRST_LINES)
-	{
-		if (!(l = f->first_lines[f->current_line_nr]))
-			goto out;
-		f->current_line_nr++;
-	} else
-	{
-		size_t len = 0;
-		l = NULL;
+		if (!rem)
+			return -1;
 
-		if (getline(&l,&len,f->file) < 0)
+		if (!(nl = memchr(f->map + f->pos, '\n', rem)))
 		{
-			if (l) free(l);
-			goto out;
+			/* Last line without newline, make a terminated copy */
+			free(f->tail);
+			if (!(f->tail = (char*)malloc(rem + 1)))
+				return -1;
+			memcpy(f->tail, f->map + f->pos, rem);
+			f->tail[rem] = '\n';
+			f->pos = f->map_size;
+			*line = f->tail;
+			*len = rem + 1;
+			return 0;
 		}
-	}
+		*line = f->map + f->pos;
+		*len = nl - *line + 1;
+		f->pos += *len;
 
-	if (!l)
-		goto out;
+		if (f->pos - f->released >= FIO_RELEASE_BYTES)
+		{
+			fio_release_range(f->map,f->map + f->released,*line);
+			f->released = *line - f->map;
+		}
+		return 0;
+	}
 
-	*line = l;
-	f->current_line = l;
-	err = 0;
-out:
-	return err;
+	/* The buffer is only allocated by the first fill */
+	while (f->buf_len <= f->pos || !(nl = memchr(f->buf + f->pos, '\n', f->buf_len - f->pos)))
+	{
+		if (f->eof)
+		{
+			if (f->pos == f->buf_len)
+				return -1;
+			/* fio_stream_fill() always leaves room for this */
+			f->buf[f->buf_len++] = '\n';
+			continue;
+		}
+		if (fio_stream_fill(f))
+			return -1;
+	}
+	*line = f->buf + f->pos;
+	*len = nl - *line + 1;
+	f->pos += *len;
+	return 0;
 }
 
-void fio_deinit(struct fio *f)
+/**
+ * Initializes the line oriented input for an already opened file descriptor.
+ * The descriptor is not closed by fio_deinit().
+ *
+ * @param f
+ * @param fd
+ * @return 0 on success, else an error.
+ */
+int fio_init_by_fd(struct fio *f, int fd)
 {
-	if (f->current_line) free(f->current_line);
-	if (f->file_was_opened)
+	int i;
+	int n;
+	size_t head_bytes;
+	size_t offsets[FIO_FIRST_LINES];
+	struct stat st;
+
+	memset(f,0,sizeof(*f));
+	f->fd = fd;
+
+	if (!fstat(fd,&st) && S_ISREG(st.st_mode) && st.st_size > 0)
 	{
-		fclose(f->file);
+		void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED)
+		{
+			madvise(map, st.st_size, MADV_SEQUENTIAL);
+			f->map = (const char*)map;
+			f->map_size = st.st_size;
+		}
 	}
-}
 
-/**************************************************************/
+	if (f->map || (S_ISREG(st.st_mode) && st.st_size == 0))
+	{
+		for (n=0;n<FIO_FIRST_LINES;n++)
+		{
+			if (fio_next_raw_line(&f->first_lines[n],&f->first_lines_len[n],f))
+				break;
+		}
+		return 0;
+	}
 
-struct progress
-{
-	const char *task;
+	/* Streamed input, keep a copy of the first lines as the buffer moves */
+	head_bytes = 0;
+	for (n=0;n<FIO_FIRST_LINES;n++)
+	{
+		const char *l;
+		size_t l_len;
+		char *new_head;
 
-	uint64_t todo;
-	uint64_t done;
+		if (fio_next_raw_line(&l,&l_len,f))
+			break;
+		if (!(new_head = (char*)realloc(f->head,head_bytes + l_len)))
+			return -1;
+		f->head = new_head;
+		memcpy(f->head + head_bytes, l, l_len);
+		offsets[n] = head_bytes;
+		f->first_lines_len[n] = l_len;
+		head_bytes += l_len;
+	}
 
-	time_t last_time;
-};
+	for (i=0;i<n;i++)
+		f->first_lines[i] = f->head + offsets[i];
+	return 0;
+}
 
-static void progress_init(struct progress *p, const char *task, uint64_t todo)
+/**
+ * Initializes the line oriented input for the given file. Files that
+ * cannot be mapped, like named pipes, are streamed.
+ *
+ * @param f
+ * @param filename the name of the file or "-" for the standard input.
+ * @return 0 on success, else an error.
+ */
+int fio_init_by_file(struct fio *f, const char *filename)
 {
-	p->done = 0;
-	p->todo = todo;
-	p->task = task;
+	int fd;
 
-	time(&p->last_time);
-}
+	if (!strcmp(filename,"-"))
+		return fio_init_by_fd(f,STDIN_FILENO);
 
-static void progress_done(struct progress *p, uint64_t done)
-{
-	p->done = done;
+	if ((fd = open(filename,O_RDONLY)) < 0)
+	{
+		memset(f,0,sizeof(*f));
+		f->fd = -1;
+		return -1;
+	}
+
+	if (fio_init_by_fd(f,fd))
+	{
+		f->fd_was_opened = 1;
+		return -1;
+	}
+	f->fd_was_opened = 1;
+	return 0;
 }
 
-static void progress_print(struct progress *p, int force)
+/**
+ * Reads a single line. The line is always terminated by a newline
+ * character, which is included in len.
+ *
+ * @param line where the start of the line is stored.
+ * @param len where the length of the line is stored.
+ * @param f
+ * @return 0 on success, else an error or end of input.
+ */
+int fio_read_next_line(const char **line, size_t *len, struct fio *f)
 {
-	time_t new_time;
-	time(&new_time);
-	if (difftime(p->last_time,new_time))
+	if (f->current_line_nr < FIO_FIRST_LINES)
 	{
-		fprintf(stderr,"%s: %"  PRIu64 "%%\n",p->task,(p->done * 100 / p->todo));
-		p->last_time = new_time;
+		if (!f->first_lines[f->current_line_nr])
+			return -1;
+		*line = f->first_lines[f->current_line_nr];
+		*len = f->first_lines_len[f->current_line_nr];
+		f->current_line_nr++;
+		return 0;
 	}
+	return fio_next_raw_line(line,len,f);
+}
+
+void fio_deinit(struct fio *f)
+{
+	if (f->map) munmap((void*)f->map, f->map_size);
+	free(f->buf);
+	free(f->tail);
+	free(f->head);
+	if (f->fd_was_opened && f->fd >= 0)
+		close(f->fd);
 }
 
 /**************************************************************/
 
-struct hist
+/**
+ * Multiplies two 64 bit numbers and returns the 128 bit result.
+ *
+ * @param a
+ * @param b
+ * @param lo where the lower 64 bits are stored
+ * @return the upper 64 bits
+ */
+static inline uint64_t parse_mul128(uint64_t a, uint64_t b, uint64_t *lo)
 {
-	int num_counts;
-
-	int *counts;
-	double *y;
-};
+	unsigned __int128 r = (unsigned __int128)a * b;
+	*lo = (uint64_t)r;
+	return (uint64_t)(r >> 64);
+}
 
-static int hist_init(struct hist *h, int counts)
+/**
+ * Converts w * 10^q to the nearest double using the algorithm of
+ * Eisel and Lemire.
+ *
+ * @param out where to store the result
+ * @param w the decimal significand, must not be 0
+ * @param q the decimal exponent
+ * @return 0 on success, -1 if the result cannot be decided by the
+ *  algorithm.
+ */
+static int parse_eisel_lemire(double *out, uint64_t w, int q)
 {
-	int err = -1;
-	h->num_counts = counts;
-	if (!(h->counts = (int*)calloc(counts,sizeof(h->counts[0]))))
-		goto out;
+	uint64_t hi, lo;
+	uint64_t second_hi, second_lo;
+	uint64_t mantissa;
+	uint64_t bits;
+	int64_t power2;
+	int upperbit;
+	int lz;
+	const uint64_t *p5;
+
+	if (q < POW5_TABLE_SMALLEST_POWER)
+	{
+		*out = 0.0;
+		return 0;
+	}
+	if (q > POW5_TABLE_LARGEST_POWER)
+	{
+		*out = HUGE_VAL;
+		return 0;
+	}
 
-	if (!(h->y = (double*)calloc(counts,sizeof(h->y[0]))))
-		goto out;
+	lz = __builtin_clzll(w);
+	w <<= lz;
 
-	err = 0;
-out:
-	return err;
-}
+	/* We need 52 + 3 bits of precision, extend the product if the
+	 * lower bits of the first approximation are inconclusive */
+	p5 = pow5_table[q - POW5_TABLE_SMALLEST_POWER];
+	hi = parse_mul128(w, p5[0], &lo);
+	if ((hi & 0x1ff) == 0x1ff)
+	{
+		second_hi = parse_mul128(w, p5[1], &second_lo);
+		lo += second_hi;
+		if (second_hi > lo)
+			hi++;
+		if (lo == UINT64_MAX && (q < -27 || q > 55))
+			return -1;
+	}
 
-static int hist_get_slot(struct hist *h, double x)
-{
-	int slot;
+	upperbit = hi >> 63;
+	mantissa = hi >> (upperbit + 9);
+	power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
 
-	slot = (int)(x * (h->num_counts - 1));
-	slot = MAX(0.0,MIN(slot,h->num_counts - 1));
+	if (power2 <= 0)
+	{
+		/* Subnormal */
+		if (-power2 + 1 >= 64)
+		{
+			*out = 0.0;
+			return 0;
+		}
+		mantissa >>= -power2 + 1;
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+		power2 = mantissa < (UINT64_C(1) << 52) ? 0 : 1;
+		bits = mantissa | ((uint64_t)power2 << 52);
+		memcpy(out,&bits,sizeof(*out));
+		return 0;
+	}
 
-	return slot;
-}
+	/* Exactly in between two floats, round to even */
+	if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1)
+	{
+		if ((mantissa << (upperbit + 9)) == hi)
+			mantissa &= ~UINT64_C(1);
+	}
 
-static void hist_put(struct hist *h, double x, double y)
-{
-	int slot;
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if (mantissa >= (UINT64_C(2) << 52))
+	{
+		mantissa = UINT64_C(1) << 52;
+		power2++;
+	}
+	mantissa &= ~(UINT64_C(1) << 52);
 
-	slot = hist_get_slot(h,x);
-	h->counts[slot]++;
-	h->y[slot] += y;
+	if (power2 >= 0x7ff)
+	{
+		*out = HUGE_VAL;
+		return 0;
+	}
+
+	bits = mantissa | ((uint64_t)power2 << 52);
+	memcpy(out,&bits,sizeof(*out));
+	return 0;
 }
 
-static void hist_average(struct hist *h)
+/**
+ * Converts w * 10^q to the nearest double.
+ *
+ * @param out where to store the result
+ * @param w the decimal significand
+ * @param q the decimal exponent
+ * @return 0 on success, -1 if the result cannot be determined exactly.
+ */
+static int parse_decimal(double *out, uint64_t w, int q)
 {
-	int j;
+	static const double exact_pow10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
 
-	for (j=0;j<h->num_counts;j++)
+	if (!w)
 	{
-		int c = h->counts[j];
-		if (c)
-			h->y[j] /= (double)c;
+		*out = 0.0;
+	} else if (q >= -22 && q <= 22 && w <= (UINT64_C(1) << 53))
+	{
+		/* Both operands are exact, so a single rounding happens */
+		*out = (double)w;
+		if (q < 0) *out /= exact_pow10[-q];
+		else *out *= exact_pow10[q];
+	} else
+	{
+		return parse_eisel_lemire(out,w,q);
 	}
+	return 0;
 }
 
-static double hist_get_y(struct hist *h, double x)
+/**
+ * Parses a decimal floating point number in plain or scientific notation
+ * without consulting the locale. The result is correctly rounded.
+ *
+ * @param out where to store the result
+ * @param s start of the number
+ * @param e end of the number
+ * @return 0 on success, -1 if the input is not a plain decimal number
+ *  spanning the entire range or cannot be handled exactly. Use strtod()
+ *  in that case.
+ */
+static int parse_double(double *out, const char *s, const char *e)
 {
-	int slot;
-	int lslot;
-	int rslot;
-
-	slot = hist_get_slot(h,x);
-	if (h->counts[slot])
-		return h->y[slot];
+	int negative = 0;
+	uint64_t w = 0;
+	int digits = 0;
+	int any_digits = 0;
+	int q = 0;
+	double v;
+
+	if (s < e && (*s == '-' || *s == '+'))
+		negative = *s++ == '-';
+
+	/* Integral part, leading zeros are not significant */
+	for (;s < e && (unsigned)(*s - '0') < 10;s++)
+	{
+		any_digits = 1;
+		if (!w && *s == '0')
+			continue;
+		w = w * 10 + (*s - '0');
+		digits++;
+	}
 
-	lslot = slot - 1;
-	while (lslot >= 0)
+	if (s < e && *s == '.')
 	{
-		if (h->counts[lslot])
-			break;
-		lslot--;
+		for (s++;s < e && (unsigned)(*s - '0') < 10;s++)
+		{
+			any_digits = 1;
+			q--;
+			if (!w && *s == '0')
+				continue;
+			w = w * 10 + (*s - '0');
+			digits++;
+		}
 	}
 
-	rslot = slot + 1;
-	while (rslot < h->num_counts)
+	if (!any_digits || digits > 19)
+		return -1;
+
+	if (s < e && (*s == 'e' || *s == 'E'))
 	{
-		if (h->counts[rslot])
-			break;
-		rslot++;
+		int exp_negative = 0;
+		int exp = 0;
+
+		s++;
+		if (s < e && (*s == '-' || *s == '+'))
+			exp_negative = *s++ == '-';
+		if (s == e || (unsigned)(*s - '0') >= 10)
+			return -1;
+		for (;s < e && (unsigned)(*s - '0') < 10;s++)
+		{
+			if (exp < 10000)
+				exp = exp * 10 + (*s - '0');
+		}
+		q += exp_negative ? -exp : exp;
 	}
 
-	if (lslot < 0 && rslot >= h->num_counts)
-		return 0.0;
+	if (s != e)
+		return -1;
 
-	if (lslot < 0) lslot = rslot;
-	else if (rslot >= h->num_counts) rslot = lslot;
+	if (parse_decimal(&v,w,q))
+		return -1;
 
-	return (h->y[lslot] + h->y[rslot])/2;
+	*out = negative ? -v : v;
+	return 0;
 }
 
-static void hist_free(struct hist *h)
+/**
+ * Parses a decimal integer that fits into 32 bits.
+ *
+ * @param out where to store the result
+ * @param s start of the number
+ * @param e end of the number
+ * @return 0 on success, -1 if the input is not a plain decimal integer
+ *  spanning the entire range or does not fit. Use strtol() in that case.
+ */
+static int parse_int32(int32_t *out, const char *s, const char *e)
 {
-	free(h->counts);
-	free(h->y);
-}
+	int negative = 0;
+	int64_t v = 0;
 
-/**************************************************************/
+	if (s < e && (*s == '-' || *s == '+'))
+		negative = *s++ == '-';
 
-typedef struct
-{
-	/** Memory allocated for the block */
-	uint8_t *block;
+	if (s == e || e - s > 10)
+		return -1;
+
+	for (;s < e;s++)
+	{
+		unsigned digit = *s - '0';
+		if (digit >= 10)
+			return -1;
+		v = v * 10 + digit;
+	}
+
+	if (negative) v = -v;
+	if (v < INT32_MIN || v > INT32_MAX)
+		return -1;
+	*out = (int32_t)v;
+	return 0;
+}
+
+/**************************************************************/
+
+/** A floating point number f * 2^e with a 64 bit significand */
+struct format_fp
+{
+	uint64_t f;
+	int e;
+};
+
+/**
+ * Multiplies two numbers, rounding the significand of the result.
+ */
+static inline struct format_fp format_fp_mul(struct format_fp a, struct format_fp b)
+{
+	struct format_fp r;
+	uint64_t lo;
+
+	r.f = parse_mul128(a.f,b.f,&lo) + (lo >> 63);
+	r.e = a.e + b.e + 64;
+	return r;
+}
+
+/**
+ * Returns the cached power 10^q of the table of parse_eisel_lemire(),
+ * rounded to 64 bits.
+ *
+ * @param q the decimal exponent, which must be within the table.
+ */
+static inline struct format_fp format_cached_power(int q)
+{
+	const uint64_t *p5 = pow5_table[q - POW5_TABLE_SMALLEST_POWER];
+	struct format_fp c;
+
+	c.f = p5[0];
+	if (c.f != UINT64_MAX)
+		c.f += p5[1] >> 63;
+	c.e = ((q * 217706) >> 16) - 63;
+	return c;
+}
+
+/**
+ * Multiplies two normalized numbers such that the result is normalized
+ * as well, i.e., its most significant bit is set.
+ */
+static inline struct format_fp format_fp_mul_normalized(struct format_fp a, struct format_fp b)
+{
+	struct format_fp r;
+	uint64_t lo;
+
+	r.f = parse_mul128(a.f,b.f,&lo);
+	r.e = a.e + b.e + 64;
+	if (!(r.f >> 63))
+	{
+		r.f = (r.f << 1) | (lo >> 63);
+		lo <<= 1;
+		r.e--;
+	}
+	if ((lo >> 63) && r.f != UINT64_MAX)
+		r.f++;
+	return r;
+}
+
+/**
+ * Removes the last digits as long as the result stays within the bounds
+ * and gets closer to the exact value.
+ */
+static inline void format_grisu_round(char *buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+	while (rest < wp_w && delta - rest >= ten_kappa &&
+			(rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+	{
+		buf[len - 1]--;
+		rest += ten_kappa;
+	}
+}
+
+/**
+ * Generates the shortest digits of a number within the given bounds, see
+ * format_grisu2().
+ *
+ * @param buf where the digits are stored
+ * @param len where the number of digits is stored
+ * @param k the decimal exponent of the result, which is adjusted
+ * @param w the scaled number
+ * @param mp the scaled upper bound
+ * @param delta the distance between the scaled bounds
+ */
+static void format_digits(char *buf, int *len, int *k, struct format_fp w, struct format_fp mp, uint64_t delta)
+{
+	static const uint64_t pow10[] =
+	{
+		UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+		UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+		UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+		UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+		UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+		UINT64_C(100000000000000000), UINT64_C(1000000000000000000),
+		UINT64_C(10000000000000000000)
+	};
+	int shift = -mp.e;
+	uint64_t one = UINT64_C(1) << shift;
+	uint64_t wp_w = mp.f - w.f;
+	uint32_t p1 = (uint32_t)(mp.f >> shift);
+	uint64_t p2 = mp.f & (one - 1);
+	int kappa = 1;
+
+	while (kappa < 10 && p1 >= pow10[kappa])
+		kappa++;
+
+	*len = 0;
+
+	/* Integral part */
+	while (kappa > 0)
+	{
+		uint32_t d = p1 / pow10[kappa - 1];
+		uint64_t rest;
+
+		p1 %= pow10[kappa - 1];
+		if (d || *len)
+			buf[(*len)++] = '0' + d;
+		kappa--;
+		rest = ((uint64_t)p1 << shift) + p2;
+		if (rest <= delta)
+		{
+			*k += kappa;
+			format_grisu_round(buf,*len,delta,rest,pow10[kappa] << shift,wp_w);
+			return;
+		}
+	}
+
+	/* Fractional part */
+	for (;;)
+	{
+		int d;
+
+		p2 *= 10;
+		delta *= 10;
+		d = (int)(p2 >> shift);
+		if (d || *len)
+			buf[(*len)++] = '0' + d;
+		p2 &= one - 1;
+		kappa--;
+		if (p2 < delta)
+		{
+			*k += kappa;
+			format_grisu_round(buf,*len,delta,p2,one,-kappa < 20 ? wp_w * pow10[-kappa] : 0);
+			return;
+		}
+	}
+}
+
+/**
+ * Determines a short sequence of digits that identifies the given positive
+ * finite number using the Grisu2 algorithm of Loitsch. The cached powers
+ * of ten are taken from the table of parse_eisel_lemire().
+ *
+ * @param buf where the digits are stored, at least 18 bytes
+ * @param len where the number of digits is stored
+ * @param k where the decimal exponent is stored, i.e., the number is
+ *  digits * 10^k.
+ * @param v the number
+ * @return 0 on success, -1 if the number is out of the range of the table.
+ */
+static int format_grisu2(char *buf, int *len, int *k, double v)
+{
+	struct format_fp w, mp, mm, c;
+	uint64_t bits;
+	uint64_t imprecision = 1;
+	int biased_e;
+	int lz;
+	int q;
+
+	memcpy(&bits,&v,sizeof(bits));
+	biased_e = (int)((bits >> 52) & 0x7ff);
+	w.f = bits & ((UINT64_C(1) << 52) - 1);
+	if (biased_e)
+	{
+		w.f += UINT64_C(1) << 52;
+		w.e = biased_e - 1075;
+	} else
+	{
+		w.e = -1074;
+	}
+
+	/* The boundaries are the midpoints to the neighbors */
+	mp.f = (w.f << 1) + 1;
+	mp.e = w.e - 1;
+	lz = __builtin_clzll(mp.f);
+	mp.f <<= lz;
+	mp.e -= lz;
+	if (w.f == (UINT64_C(1) << 52) && biased_e > 1)
+	{
+		mm.f = (w.f << 2) - 1;
+		mm.e = w.e - 2;
+	} else
+	{
+		mm.f = (w.f << 1) - 1;
+		mm.e = w.e - 1;
+	}
+	mm.f <<= mm.e - mp.e;
+	mm.e = mp.e;
+
+	lz = __builtin_clzll(w.f);
+	w.f <<= lz;
+	w.e -= lz;
+
+	/* Choose 10^q such that the scaled upper bound has a binary exponent
+	 * between -60 and -32 */
+	q = ((-61 - mp.e) * 78913 + (1 << 18) - 1) >> 18;
+	while (mp.e + ((q * 217706) >> 16) + 1 < -60)
+		q++;
+	while (mp.e + ((q * 217706) >> 16) + 1 > -32)
+		q--;
+	if (q < POW5_TABLE_SMALLEST_POWER)
+		return -1;
+	if (q > POW5_TABLE_LARGEST_POWER)
+	{
+		/* Tiny and subnormal numbers need powers beyond the table, which are
+		 * composed of two powers at the expense of some precision */
+		if (q - POW5_TABLE_LARGEST_POWER > POW5_TABLE_LARGEST_POWER)
+			return -1;
+		c = format_fp_mul_normalized(format_cached_power(POW5_TABLE_LARGEST_POWER),format_cached_power(q - POW5_TABLE_LARGEST_POWER));
+		imprecision = 2;
+	} else
+	{
+		c = format_cached_power(q);
+	}
+
+	w = format_fp_mul(w,c);
+	mp = format_fp_mul(mp,c);
+	mm = format_fp_mul(mm,c);
+
+	/* Account for the imprecision of the products */
+	mm.f += imprecision;
+	mp.f -= imprecision;
+
+	*k = -q;
+	format_digits(buf,len,k,w,mp,mp.f - mm.f);
+	return 0;
+}
+
+/**
+ * Formats a double such that parsing the result yields the same number.
+ * Usually, the shortest such representation is chosen. The format doesn't
+ * depend on the locale. Numbers between 1e-6 and 1e21 are written in plain
+ * notation, others in scientific notation. Infinities and NaNs are written
+ * as inf, -inf and nan.
+ *
+ * @param buf where the result is stored, must be at least FORMAT_DOUBLE_MAX
+ *  bytes large. It is not terminated.
+ * @param v
+ * @return the number of characters written.
+ */
+int format_double(char *buf, double v)
+{
+	char digits[24];
+	char *s = buf;
+	uint64_t w = 0;
+	int len;
+	int k;
+	int i;
+	int point;
+	double back;
+	double orig = v;
+
+	if (isnan(v))
+	{
+		memcpy(buf,"nan",3);
+		return 3;
+	}
+
+	if (signbit(v))
+	{
+		*s++ = '-';
+		v = -v;
+	}
+
+	if (isinf(v))
+	{
+		memcpy(s,"inf",3);
+		return s - buf + 3;
+	}
+
+	if (v == 0)
+	{
+		*s++ = '0';
+		return s - buf;
+	}
+
+	if (format_grisu2(digits,&len,&k,v))
+		goto fallback;
+
+	/* The imprecise products could have yielded digits that don't identify
+	 * the number, which is very rare */
+	for (i=0;i<len;i++)
+		w = w * 10 + (digits[i] - '0');
+	if (len > 19 || parse_decimal(&back,w,k) || back != v)
+		goto fallback;
+
+	/* They could also have excluded a shorter result, in which case the
+	 * digits only stop at the precision of the number, which is lower for
+	 * subnormal numbers. The neighbors of such results with a digit less
+	 * are tried instead */
+	if (len >= 16 || fpclassify(v) == FP_SUBNORMAL)
+	{
+		int shortened = 0;
+
+		while (w >= 10)
+		{
+			uint64_t lower = w / 10;
+			uint64_t nearer = w % 10 >= 5 ? lower + 1 : lower;
+			uint64_t farther = w % 10 >= 5 ? lower : lower + 1;
+
+			if (!parse_decimal(&back,nearer,k + 1) && back == v)
+				w = nearer;
+			else if (!parse_decimal(&back,farther,k + 1) && back == v)
+				w = farther;
+			else
+				break;
+			k++;
+			shortened = 1;
+		}
+
+		if (shortened)
+		{
+			while (w % 10 == 0)
+			{
+				w /= 10;
+				k++;
+			}
+			len = snprintf(digits,sizeof(digits),"%" PRIu64,w);
+		}
+	}
+
+	/* Position of the decimal point relative to the first digit */
+	point = len + k;
+
+	if (k >= 0 && point <= 21)
+	{
+		memcpy(s,digits,len);
+		memset(&s[len],'0',k);
+		s += point;
+	} else if (point > 0 && point <= 21)
+	{
+		memcpy(s,digits,point);
+		s[point] = '.';
+		memcpy(&s[point + 1],&digits[point],len - point);
+		s += len + 1;
+	} else if (point > -6 && point <= 0)
+	{
+		*s++ = '0';
+		*s++ = '.';
+		memset(s,'0',-point);
+		memcpy(&s[-point],digits,len);
+		s += len - point;
+	} else
+	{
+		int exp = point - 1;
+
+		*s++ = digits[0];
+		if (len > 1)
+		{
+			*s++ = '.';
+			memcpy(s,&digits[1],len - 1);
+			s += len - 1;
+		}
+		*s++ = 'e';
+		if (exp < 0)
+		{
+			*s++ = '-';
+			exp = -exp;
+		}
+		if (exp >= 100) *s++ = '0' + exp / 100;
+		if (exp >= 10) *s++ = '0' + exp / 10 % 10;
+		*s++ = '0' + exp % 10;
+	}
+	return s - buf;
+
+fallback:
+	/* The shortest of the precisions that usually suffice */
+	for (i=15;i<17;i++)
+	{
+		len = snprintf(buf,FORMAT_DOUBLE_MAX,"%.*g",i,orig);
+		if (strtod(buf,NULL) == orig)
+			return len;
+	}
+	return snprintf(buf,FORMAT_DOUBLE_MAX,"%.17g",orig);
+}
+
+/**************************************************************/
+
+/**
+ * Initializes the buffered output to the given file descriptor.
+ *
+ * @param f
+ * @param fd
+ * @param size the size of the buffer in bytes
+ * @return 0 on success, else an error.
+ */
+int fout_init(struct fout *f, int fd, size_t size)
+{
+	memset(f,0,sizeof(*f));
+	f->fd = fd;
+	f->size = MAX(size,FORMAT_DOUBLE_MAX);
+	if (!(f->buf = (char*)malloc(f->size)))
+		return -1;
+	return 0;
+}
+
+/**
+ * Writes the given bytes to the file descriptor of the output.
+ *
+ * @param f
+ * @param data
+ * @param len
+ * @return 0 on success, else an error.
+ */
+static int fout_write_fd(struct fout *f, const char *data, size_t len)
+{
+	while (!f->err && len)
+	{
+		ssize_t w = write(f->fd,data,len);
+		if (w < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr,"Couldn't write output: %s\n",strerror(errno));
+			f->err = -1;
+			break;
+		}
+		data += w;
+		len -= w;
+	}
+	return f->err;
+}
+
+/**
+ * Writes the buffered output.
+ *
+ * @param f
+ * @return 0 on success, else an error.
+ */
+int fout_flush(struct fout *f)
+{
+	fout_write_fd(f,f->buf,f->used);
+	f->used = 0;
+	return f->err;
+}
+
+/**
+ * Makes sure that the buffer has room for the given number of bytes.
+ */
+static inline int fout_reserve(struct fout *f, size_t len)
+{
+	if (f->size - f->used < len)
+		return fout_flush(f);
+	return f->err;
+}
+
+/**
+ * Appends the given bytes to the output.
+ *
+ * @param f
+ * @param data
+ * @param len
+ * @return 0 on success, else an error.
+ */
+int fout_write(struct fout *f, const void *data, size_t len)
+{
+	if (fout_reserve(f,len))
+		return -1;
+
+	/* Too large to be buffered */
+	if (len > f->size)
+		return fout_write_fd(f,(const char*)data,len);
+
+	memcpy(&f->buf[f->used],data,len);
+	f->used += len;
+	return 0;
+}
+
+/**
+ * Appends the given string to the output.
+ *
+ * @param f
+ * @param str
+ * @return 0 on success, else an error.
+ */
+int fout_puts(struct fout *f, const char *str)
+{
+	return fout_write(f,str,strlen(str));
+}
+
+/**
+ * Appends the given double in the format of format_double() to the output.
+ *
+ * @param f
+ * @param v
+ * @return 0 on success, else an error.
+ */
+int fout_put_double(struct fout *f, double v)
+{
+	if (fout_reserve(f,FORMAT_DOUBLE_MAX))
+		return -1;
+	f->used += format_double(&f->buf[f->used],v);
+	return 0;
+}
+
+/**
+ * Appends the given double as 8 bytes in little-endian order.
+ *
+ * @param f
+ * @param v
+ * @return 0 on success, else an error.
+ */
+int fout_put_double_le(struct fout *f, double v)
+{
+	uint64_t bits;
+	int i;
+
+	if (fout_reserve(f,sizeof(bits)))
+		return -1;
+	memcpy(&bits,&v,sizeof(bits));
+	for (i=0;i<sizeof(bits);i++)
+		f->buf[f->used++] = (char)(bits >> (i * 8));
+	return 0;
+}
+
+/**
+ * Flushes the output and frees the resources. The file descriptor is
+ * not closed.
+ *
+ * @param f
+ * @return 0 on success, else an error.
+ */
+int fout_deinit(struct fout *f)
+{
+	int err = fout_flush(f);
+	free(f->buf);
+	f->buf = NULL;
+	return err;
+}
+
+/**************************************************************/
+
+struct progress
+{
+	const char *task;
+	int show;
+
+	uint64_t todo;
+	uint64_t done;
+
+	time_t last_time;
+};
+
+static void progress_init(struct progress *p, const char *task, uint64_t todo, int show)
+{
+	p->done = 0;
+	p->todo = todo;
+	p->task = task;
+	p->show = show;
+
+	time(&p->last_time);
+}
+
+static void progress_done(struct progress *p, uint64_t done)
+{
+	p->done = done;
+}
+
+static void progress_print(struct progress *p, int force)
+{
+	time_t new_time;
+	time(&new_time);
+	if (p->show && difftime(p->last_time,new_time))
+	{
+		fprintf(stderr,"%s: %"  PRIu64 "%%\n",p->task,(p->done * 100 / p->todo));
+		p->last_time = new_time;
+	}
+}
+
+/**************************************************************/
+
+/**
+ * A bounded, blocking FIFO of pointers that connects threads.
+ */
+struct queue
+{
+	void **items;
+	int capacity;
+	int head;
+	int count;
+
+	/** Set when no further items will be put */
+	int closed;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+};
+
+static int queue_init(struct queue *q, int capacity)
+{
+	memset(q,0,sizeof(*q));
+	if (!(q->items = (void**)malloc(sizeof(q->items[0])*capacity)))
+		return -1;
+	q->capacity = capacity;
+	pthread_mutex_init(&q->mutex,NULL);
+	pthread_cond_init(&q->not_empty,NULL);
+	pthread_cond_init(&q->not_full,NULL);
+	return 0;
+}
+
+static void queue_free(struct queue *q)
+{
+	pthread_cond_destroy(&q->not_full);
+	pthread_cond_destroy(&q->not_empty);
+	pthread_mutex_destroy(&q->mutex);
+	free(q->items);
+}
+
+/**
+ * Appends an item, blocks while the queue is full.
+ *
+ * @param q
+ * @param item
+ * @return 0 on success, -1 if the queue has been closed.
+ */
+static int queue_put(struct queue *q, void *item)
+{
+	int err = -1;
+
+	pthread_mutex_lock(&q->mutex);
+	while (q->count == q->capacity && !q->closed)
+		pthread_cond_wait(&q->not_full,&q->mutex);
+	if (!q->closed)
+	{
+		q->items[(q->head + q->count) % q->capacity] = item;
+		q->count++;
+		pthread_cond_signal(&q->not_empty);
+		err = 0;
+	}
+	pthread_mutex_unlock(&q->mutex);
+	return err;
+}
+
+/**
+ * Removes the first item, blocks while the queue is empty.
+ *
+ * @param q
+ * @return the item or NULL if the queue is empty and has been closed.
+ */
+static void *queue_get(struct queue *q)
+{
+	void *item = NULL;
+
+	pthread_mutex_lock(&q->mutex);
+	while (!q->count && !q->closed)
+		pthread_cond_wait(&q->not_empty,&q->mutex);
+	if (q->count)
+	{
+		item = q->items[q->head];
+		q->head = (q->head + 1) % q->capacity;
+		q->count--;
+		pthread_cond_signal(&q->not_full);
+	}
+	pthread_mutex_unlock(&q->mutex);
+	return item;
+}
+
+/**
+ * Closes the queue. Remaining items can still be taken, but no new items
+ * can be put and waiting threads are woken up.
+ *
+ * @param q
+ */
+static void queue_close(struct queue *q)
+{
+	pthread_mutex_lock(&q->mutex);
+	q->closed = 1;
+	pthread_cond_broadcast(&q->not_empty);
+	pthread_cond_broadcast(&q->not_full);
+	pthread_mutex_unlock(&q->mutex);
+}
+
+/**************************************************************/
+
+struct hist
+{
+	int num_counts;
+
+	int *counts;
+	double *y;
+};
+
+static int hist_init(struct hist *h, int counts)
+{
+	int err = -1;
+	h->num_counts = counts;
+	if (!(h->counts = (int*)calloc(counts,sizeof(h->counts[0]))))
+		goto out;
+
+	if (!(h->y = (double*)calloc(counts,sizeof(h->y[0]))))
+		goto out;
+
+	err = 0;
+out:
+	return err;
+}
+
+static int hist_get_slot(struct hist *h, double x)
+{
+	int slot;
+
+	slot = (int)(x * (h->num_counts - 1));
+	slot = MAX(0.0,MIN(slot,h->num_counts - 1));
+
+	return slot;
+}
+
+static void hist_put(struct hist *h, double x, double y)
+{
+	int slot;
+
+	slot = hist_get_slot(h,x);
+	h->counts[slot]++;
+	h->y[slot] += y;
+}
+
+static void hist_average(struct hist *h)
+{
+	int j;
+
+	for (j=0;j<h->num_counts;j++)
+	{
+		int c = h->counts[j];
+		if (c)
+			h->y[j] /= (double)c;
+	}
+}
+
+static double hist_get_y(struct hist *h, double x)
+{
+	int slot;
+	int lslot;
+	int rslot;
+
+	slot = hist_get_slot(h,x);
+	if (h->counts[slot])
+		return h->y[slot];
+
+	lslot = slot - 1;
+	while (lslot >= 0)
+	{
+		if (h->counts[lslot])
+			break;
+		lslot--;
+	}
+
+	rslot = slot + 1;
+	while (rslot < h->num_counts)
+	{
+		if (h->counts[rslot])
+			break;
+		rslot++;
+	}
+
+	if (lslot < 0 && rslot >= h->num_counts)
+		return 0.0;
+
+	if (lslot < 0) lslot = rslot;
+	else if (rslot >= h->num_counts) rslot = lslot;
+
+	return (h->y[lslot] + h->y[rslot])/2;
+}
+
+static void hist_free(struct hist *h)
+{
+	free(h->counts);
+	free(h->y);
+}
+
+/**************************************************************/
+
+typedef struct
+{
+	/** Memory allocated for the block */
+	uint8_t *block;
+
+	/** Size of the block in bytes */
+	uint32_t block_bytes;
+
+	/** The offset of the blocks in rows */
+	uint32_t row_offset;
+
+	/** The number of rows covered by the block */
+	uint32_t num_rows;
+
+	/** The current row relative to row_offset */
+	uint32_t current_relative_row;
+
+	uint32_t current_row;
+} block_t;
+
+/**
+ * Distinct rows of a data frame along with their multiplicities. As long
+ * as there are not too many distinct rows, the rows of a frame are
+ * aggregated in a hash table rather than stored in blocks.
+ */
+struct data_aggregate
+{
+	/** Maximal number of distinct rows, 0 if rows are not aggregated */
+	uint32_t max_rows;
+
+	/** The label column by which the weights of the rows are determined */
+	int label_col;
+
+	/** Set once the rows are stored in blocks */
+	int expanded;
+
+	/** The distinct rows without their weights, their multiplicities and, for weighted rows, their total weights */
+	uint8_t *rows;
+	uint64_t *counts;
+	uint64_t *positives;
+	uint64_t *negatives;
+	uint32_t num_rows;
+
+	/** Open addressing hash table of indices + 1 of the distinct rows */
+	uint32_t *slots;
+	uint32_t num_slots;
+};
+
+/**
+ * Total weights of the positive and the negative rows for each value of the
+ * group column, see data_set_group_column().
+ */
+struct data_groups
+{
+	uint32_t num_groups;
+	double *values;
+
+	/** Positive and negative weight of each group */
+	uint64_t *weights;
+
+	/** Open addressing hash table of indices + 1 of the groups */
+	uint32_t *slots;
+	uint32_t num_slots;
+};
+
+/** A chunk of consecutive rows of a compressed external file */
+struct spill_chunk
+{
+	uint32_t first_row;
+	uint32_t rows;
+
+	/** Bytes stored at the offset of the first row, rows * num_bytes_per_row if the rows are stored as they are */
+	uint32_t bytes;
+};
+
+/** The chunks of a compressed external file ordered by their first row, see data_set_spill_compression() */
+struct spill_file
+{
+	int used;
+	int fd;
+	struct spill_chunk *chunks;
+	uint32_t num_chunks;
+	uint32_t max_chunks;
+};
+
+/** Number of compressed files that may be open at once: the external file, the one of the merge passes and the sorted copy */
+#define DATA_SPILL_FILES 3
+
+struct data
+{
+	const char *filename;
+	FILE *tmp;
+
+	enum column_datatype_t *column_datatype;
+	uint32_t *column_offsets;
+	uint32_t num_columns;
+	uint32_t num_rows;
+
+	/** Number of columns of the input, which may exceed num_columns */
+	uint32_t num_input_columns;
+	uint32_t num_bytes_per_row;
+
+	/** How rows are stored within blocks, in memory as well as on disk */
+	enum data_layout_t layout;
+
+	/** Size in bytes for the input block, which is also the size of a run */
+	uint32_t ib_bytes;
+
+	/** Number of rows to which the input block may grow before anything is spilled, 0 if it doesn't grow */
+	uint32_t ib_max_rows;
+
+	/** Memory in bytes that may be used overall, 0 if the sizes are fixed */
+	size_t memory_budget;
+
+	/** Number of threads used for loading */
+	int num_threads;
+
+	/** Size in bytes of the chunks of the input that are parsed concurrently */
+	size_t parse_chunk_bytes;
+
+	/** Memory in bytes for the read buffers of a single merge */
+	size_t merge_bytes;
+
+	/** Minimal size in bytes of the read buffer of a run */
+	uint32_t merge_buffer_min_bytes;
+
+	/** Maximal number of runs merged at once, 0 to derive it from merge_bytes */
+	int max_fan_in;
+
+	/** Whether the progress of sorting is written to stderr */
+	int show_progress;
+
+	/** Number of read-ahead buffers consumed by merges and how often they weren't ready */
+	uint64_t merge_refills;
+	uint64_t merge_waits;
+
+	/** Input block */
+	block_t ib;
+
+	/** Whether the external files are compressed, see data_set_spill_compression() */
+	int spill_compression;
+
+	/** The chunks of the compressed files, protected by spill_mutex */
+	struct spill_file spill_files[DATA_SPILL_FILES];
+	pthread_mutex_t spill_mutex;
+
+	/** Whether loaded columns are narrowed, see data_set_narrow_integers() and data_set_float32() */
+	int narrow_integers;
+	int float32;
+
+	/** Input column whose values didn't fit into its narrowed datatype during loading, -1 if none */
+	int load_overflow_col;
+
+	/** Aggregated rows, see data_set_max_distinct_rows() */
+	struct data_aggregate agg;
+
+	int *to_sort_columns;
+	int num_to_sort_columns;
+
+	int label_col;
+
+	/** Columns by which rows are weighted, -1 if unused, see data_set_weight_columns() */
+	int weight_col;
+	int negatives_col;
+
+	/** Total weight of the positive and the negative rows, determined when the rows are sorted */
+	uint64_t positives;
+	uint64_t negatives;
+
+	/** Column whose values divide the rows into groups, -1 if none, see data_set_group_column() */
+	int group_col;
+
+	/** Total weights of the groups, determined when the rows are sorted */
+	struct data_groups groups;
+	struct data_groups presorted_groups;
+
+	/** Sort columns of data_stat_callback() preceded by the group column */
+	int *group_sort_columns;
+
+	/** The group that data_stat_callback() currently accounts */
+	double stat_group;
+
+	/** Measures of each group determined by the last data_stat_callback() */
+	struct data_group_summary *group_summaries;
+	uint32_t num_group_summaries;
+	uint32_t max_group_summaries;
+
+	/** Whether data_stat_callback() leaves the rows sorted */
+	int keep_sorted;
+
+	/** Columns by which all rows are known to be sorted, see data_save_binary() */
+	int *sorted_columns;
+	int num_sorted_columns;
+
+	/** Mapping of a binary frame file that holds the input block, see data_load_binary() */
+	uint8_t *map;
+	size_t map_bytes;
+
+	/** For which points data_stat_callback() invokes the callback */
+	enum data_stat_points_t stat_points;
+
+	/** Number of bootstrap replicates and their seed, see data_set_bootstrap() */
+	uint32_t bootstrap_replicates;
+	uint64_t bootstrap_seed;
+
+	/** The areas under the ROC curve of the replicates of the last data_stat_callback() */
+	double *bootstrap_auc_roc;
+
+	/** Sort columns and label column by which blocks are sorted before they are spilled */
+	int *presort_columns;
+	int num_presort_columns;
+	int presort_label_col;
+
+	/** Number of rows of the consecutive blocks that have been sorted when spilled, and their weights */
+	uint32_t presorted_rows;
+	uint64_t presorted_positives;
+	uint64_t presorted_negatives;
+
+	/** Frames among which loaded rows are distributed instead, see data_load_from_ascii_split() */
+	data_t **split_frames;
+	int num_split_frames;
+
+	/** For each split frame, the num_split_columns columns of this frame that it consists of */
+	int *split_columns;
+	int num_split_columns;
+
+	/** Buffer for the rows of a split frame that are about to be inserted */
+	uint8_t *split_rows;
+
+	/** Measures determined by the last data_stat_callback() */
+	int has_summary;
+	struct data_summary summary;
+
+	/* Histograms of various measures */
+	int hist_initialized;
+	struct hist roc;
+	struct hist precall;
+};
+
+/**
+ * Frees the groups and makes them empty.
+ *
+ * @param g
+ */
+static void data_groups_free(struct data_groups *g)
+{
+	free(g->values);
+	free(g->weights);
+	free(g->slots);
+	memset(g,0,sizeof(*g));
+}
+
+static inline uint32_t data_groups_hash(double value)
+{
+	uint64_t v;
+
+	memcpy(&v,&value,sizeof(v));
+	v *= UINT64_C(0x9e3779b97f4a7c15);
+	return (uint32_t)(v >> 32);
+}
+
+/**
+ * Finds the slot of the given group value, which is either the one of the
+ * group or the free one at which it can be added.
+ *
+ * @param g
+ * @param value
+ * @return the slot.
+ */
+static inline uint32_t data_groups_slot(struct data_groups *g, double value)
+{
+	uint32_t mask = g->num_slots - 1;
+	uint32_t h = data_groups_hash(value) & mask;
+	uint32_t idx;
+
+	while ((idx = g->slots[h]))
+	{
+		if (g->values[idx - 1] == value)
+			break;
+		h = (h + 1) & mask;
+	}
+	return h;
+}
+
+/**
+ * Adds weights to the given group, which is created if needed.
+ *
+ * @param g
+ * @param value
+ * @param pos
+ * @param neg
+ * @return 0 on success, else an error.
+ */
+static int data_groups_add(struct data_groups *g, double value, uint64_t pos, uint64_t neg)
+{
+	uint32_t h;
+	uint32_t idx;
+
+	/* Grows the table and the groups when it is half full */
+	if (g->num_groups * 2 >= g->num_slots)
+	{
+		uint32_t num_slots = g->num_slots ? g->num_slots * 2 : 64;
+		uint32_t *slots;
+		double *values;
+		uint64_t *weights;
+		uint32_t i;
+
+		if (!(slots = (uint32_t*)calloc(num_slots,sizeof(slots[0]))))
+			return -1;
+		if (!(values = (double*)realloc(g->values,sizeof(values[0]) * num_slots / 2)))
+		{
+			free(slots);
+			return -1;
+		}
+		g->values = values;
+		if (!(weights = (uint64_t*)realloc(g->weights,sizeof(weights[0]) * num_slots)))
+		{
+			free(slots);
+			return -1;
+		}
+		g->weights = weights;
+
+		free(g->slots);
+		g->slots = slots;
+		g->num_slots = num_slots;
+		for (i=0;i<g->num_groups;i++)
+			g->slots[data_groups_slot(g,g->values[i])] = i + 1;
+	}
+
+	h = data_groups_slot(g,value);
+	if (!(idx = g->slots[h]))
+	{
+		idx = ++g->num_groups;
+		g->values[idx - 1] = value;
+		g->weights[2 * (idx - 1)] = 0;
+		g->weights[2 * (idx - 1) + 1] = 0;
+		g->slots[h] = idx;
+	}
+	g->weights[2 * (idx - 1)] += pos;
+	g->weights[2 * (idx - 1) + 1] += neg;
+	return 0;
+}
+
+/**
+ * Returns the positive and negative weight of the given group.
+ *
+ * @param g
+ * @param value
+ * @param pos
+ * @param neg
+ * @return 0 on success, else an error, if there is no such group.
+ */
+static int data_groups_get(struct data_groups *g, double value, uint64_t *pos, uint64_t *neg)
+{
+	uint32_t idx;
+
+	if (!g->num_slots || !(idx = g->slots[data_groups_slot(g,value)]))
+		return -1;
+	*pos = g->weights[2 * (idx - 1)];
+	*neg = g->weights[2 * (idx - 1) + 1];
+	return 0;
+}
+
+/**
+ * Constructs an empty data frame.
+ *
+ * @param out where the reference is stored.
+ * @return 0 on success, else an error.
+ */
+int data_create(data_t **out)
+{
+	int err = -1;
+	data_t *n;
+
+	if (!(n = (data_t*)malloc(sizeof(*n))))
+		goto out;
+	memset(n,0,sizeof(*n));
+
+	n->ib_bytes = 1024 * 1024 * 10;
+	n->num_threads = 1;
+	n->parse_chunk_bytes = 1024 * 1024 * 16;
+	n->merge_bytes = 1024 * 1024 * 128;
+	n->merge_buffer_min_bytes = 1024 * 256;
+	n->filename = "out";
+	n->weight_col = -1;
+	n->negatives_col = -1;
+	n->group_col = -1;
+	n->narrow_integers = 1;
+	n->load_overflow_col = -1;
+	n->show_progress = 1;
+	pthread_mutex_init(&n->spill_mutex,NULL);
+	*out = n;
+	err = 0;
+out:
+	return err;
+}
+
+/**
+ * Frees all memory associated with the given
+ * data frame.
+ *
+ * @param d
+ */
+void data_free(data_t *d)
+{
+	if (d)
+	{
+		int i;
+
+		if (d->hist_initialized)
+		{
+			hist_free(&d->precall);
+			hist_free(&d->roc);
+		}
+
+		/* The external file is only of use to the frame */
+		if (d->tmp)
+		{
+			fclose(d->tmp);
+			remove(d->filename);
+		}
+		for (i=0;i<DATA_SPILL_FILES;i++)
+			free(d->spill_files[i].chunks);
+		pthread_mutex_destroy(&d->spill_mutex);
+		free(d->column_datatype);
+		free(d->column_offsets);
+		free(d->agg.rows);
+		free(d->agg.counts);
+		free(d->agg.positives);
+		free(d->agg.negatives);
+		free(d->agg.slots);
+		free(d->presort_columns);
+		free(d->split_columns);
+		free(d->bootstrap_auc_roc);
+		free(d->group_sort_columns);
+		free(d->sorted_columns);
+		free(d->group_summaries);
+		data_groups_free(&d->groups);
+		data_groups_free(&d->presorted_groups);
+		free(d->split_rows);
+		if (d->map)
+			munmap(d->map,d->map_bytes);
+		else
+			free(d->ib.block);
+		free(d);
+	}
+}
+
+/**
+ * Set the name of the external file to be used when storing and
+ * sorting. The file is removed when the frame is freed.
+ *
+ * @param d
+ * @param filename
+ */
+void data_set_external_filename(data_t *d, const char *filename)
+{
+	d->filename = filename;
+}
+
+/**
+ * Set the number of threads that may be used to process the data.
+ *
+ * @param d
+ * @param threads
+ */
+void data_set_number_of_threads(data_t *d, int threads)
+{
+	d->num_threads = MAX(1,threads);
+}
+
+/**
+ * Set the maximal number of runs that are merged at once during an
+ * external sort. More runs are merged in several passes.
+ *
+ * @param d
+ * @param fan_in the maximal number of runs or 0 to derive it from
+ *  the memory available for merging.
+ */
+void data_set_max_fan_in(data_t *d, int fan_in)
+{
+	d->max_fan_in = fan_in < 2 ? 0 : fan_in;
+}
+
+/**
+ * Set whether the progress of sorting is written to stderr, which is
+ * the default.
+ *
+ * @param d
+ * @param show
+ */
+void data_set_progress(data_t *d, int show)
+{
+	d->show_progress = show;
+}
+
+/**
+ * Set the layout of the rows. In the columnar layout, each block holds
+ * the values of a column in a contiguous segment, so scans over single
+ * columns touch only the bytes of these columns. The layout can only be
+ * changed before the first row has been inserted.
+ *
+ * @param d
+ * @param layout
+ * @return 0 on success, else an error.
+ */
+int data_set_layout(data_t *d, enum data_layout_t layout)
+{
+	if (d->ib.block)
+		return -1;
+	d->layout = layout;
+	return 0;
+}
+
+/**
+ * Set whether the blocks and runs that are written to the external files
+ * are compressed. Rows are then stored in chunks whose columns are packed
+ * with as few bits as their range of values or, for sorted columns, of
+ * their differences needs, which trades some time for much less I/O. This
+ * can only be changed before anything has been written to the external
+ * file.
+ *
+ * @param d
+ * @param compress
+ * @return 0 on success, else an error.
+ */
+int data_set_spill_compression(data_t *d, int compress)
+{
+	if (d->tmp)
+		return -1;
+	d->spill_compression = compress;
+	return 0;
+}
+
+/**
+ * Set whether data_load_from_ascii() and its relatives store integer
+ * columns with fewer bits, i.e., as INT8, UINT8 or INT16, when the sampled
+ * values of a column allow it. Should a later value not fit, the input is
+ * loaded again with the column widened to INT32, so this is only done for
+ * input that can be read again, not for pipes. Enabled by default.
+ *
+ * @param d
+ * @param narrow
+ */
+void data_set_narrow_integers(data_t *d, int narrow)
+{
+	d->narrow_integers = narrow;
+}
+
+/**
+ * Set whether data_load_from_ascii() and its relatives store floating point
+ * columns as FLOAT32 rather than DOUBLE. This halves their size, but the
+ * values are rounded to single precision, so distinct values may become
+ * equal.
+ *
+ * @param d
+ * @param float32
+ */
+void data_set_float32(data_t *d, int float32)
+{
+	d->float32 = float32;
+}
+
+/**
+ * Set the memory that may be used overall. The sizes of the parsed chunks,
+ * of the input block, of the runs and of the merge buffers are derived
+ * from it. The input block grows up to the largest size that can still be
+ * sorted within the budget, so data that fits is sorted in memory without
+ * using the external file. This can only be changed before the first row
+ * has been inserted.
+ *
+ * @param d
+ * @param bytes the budget in bytes.
+ * @return 0 on success, else an error.
+ */
+int data_set_memory_budget(data_t *d, size_t bytes)
+{
+	if (d->ib.block)
+		return -1;
+	d->memory_budget = bytes;
+
+#ifdef M_MMAP_THRESHOLD
+	/* The large buffers of the different phases are mapped separately,
+	 * so freed buffers are returned rather than left in the heap */
+	mallopt(M_MMAP_THRESHOLD, 1024 * 128);
+#endif
+	return 0;
+}
+
+/**
+ * Set the maximal number of distinct rows for which rows are aggregated.
+ * As long as there are at most that many distinct rows, only the distinct
+ * rows, their multiplicities and their total positive and negative weights
+ * for the given label column are kept, and the statistics are determined
+ * by sorting only the distinct rows. Rows that differ only in their weights,
+ * i.e., in the weight column or, with a negatives column, in the label and
+ * the negatives column, count as equal, see data_set_weight_columns().
+ *
+ * Once there are more distinct rows, the aggregated rows are expanded and
+ * all rows are stored as usual. Any access to individual rows, as well as
+ * statistics for another label column, expands the rows as well. Expanded
+ * rows that count as equal get the total weights spread evenly among them,
+ * which doesn't change any measure. This can only be changed before the
+ * first row has been inserted.
+ *
+ * @param d
+ * @param label_col the label column by which the weights are determined.
+ * @param max_rows the maximal number of distinct rows, 0 to disable
+ *  the aggregation.
+ * @return 0 on success, else an error.
+ */
+int data_set_max_distinct_rows(data_t *d, int label_col, uint32_t max_rows)
+{
+	if (d->ib.block || label_col < 0)
+		return -1;
+	d->agg.label_col = label_col;
+	d->agg.max_rows = max_rows;
+	return 0;
+}
+
+/**
+ * Set whether the rows should be left in sorted order after the statistics
+ * have been determined. If not set, the statistics of data that doesn't fit
+ * into the input block are determined during the final merge, which avoids
+ * writing and reading a sorted copy of the data, but leaves the rows in an
+ * unspecified order.
+ *
+ * @param d
+ * @param keep_sorted
+ */
+void data_set_keep_sorted(data_t *d, int keep_sorted)
+{
+	d->keep_sorted = keep_sorted;
+}
+
+/**
+ * Sets for which points of the curves data_stat_callback() invokes the
+ * callback. By default, this happens for every row, so the points of rows
+ * with equal predictions depend on the order of the rows.
+ *
+ * @param d
+ * @param points
+ */
+void data_set_stat_points(data_t *d, enum data_stat_points_t points)
+{
+	d->stat_points = points;
+}
+
+/**
+ * Set the columns by which the data is going to be sorted. Blocks are then
+ * sorted as soon as they are full during insertion, so a sort with these
+ * columns only needs to sort the last block. This is useful if the input
+ * arrives slowly, e.g., from a pipe. This can only be changed before the
+ * first row has been inserted.
+ *
+ * @param d
+ * @param label_col the column of the label, whose sum is determined as well.
+ * @param cols the number of sort columns.
+ * @param to_sort_cols the sort columns, a negative column denotes a descending order.
+ * @return 0 on success, else an error.
+ */
+int data_set_presort_columns(data_t *d, int label_col, int cols, const int *to_sort_cols)
+{
+	int *presort_columns;
+
+	if (d->ib.block || cols < 1)
+		return -1;
+	if (!(presort_columns = (int*)malloc(sizeof(presort_columns[0]) * cols)))
+		return -1;
+	memcpy(presort_columns,to_sort_cols,sizeof(presort_columns[0]) * cols);
+
+	free(d->presort_columns);
+	d->presort_columns = presort_columns;
+	d->num_presort_columns = cols;
+	d->presort_label_col = label_col;
+	return 0;
+}
+
+/**
+ * Sets the columns by which the rows are weighted when their measures are
+ * determined, which allows to process pre-aggregated input. With a weight
+ * column, a row counts as often as the weight says as positive or negative,
+ * depending on its label. With a negatives column, the label column holds
+ * the number of positives of the row and the negatives column the number of
+ * negatives. Negative weights count as 0, fractional weights are truncated.
+ * This can only be changed before the first row has been inserted.
+ *
+ * @param d
+ * @param weight_col the weight column or -1.
+ * @param negatives_col the negatives column or -1.
+ * @return 0 on success, else an error.
+ */
+int data_set_weight_columns(data_t *d, int weight_col, int negatives_col)
+{
+	if (d->ib.block || (weight_col >= 0 && negatives_col >= 0))
+		return -1;
+	d->weight_col = weight_col;
+	d->negatives_col = negatives_col;
+	return 0;
+}
+
+/**
+ * Sets the column whose values divide the rows into groups. The measures
+ * are then determined for each group on its own by data_stat_callback(),
+ * for which the rows are sorted by the group column first, so all rows
+ * are still sorted only once. This can only be changed before the first
+ * row has been inserted.
+ *
+ * @param d
+ * @param col the group column or -1.
+ * @return 0 on success, else an error.
+ */
+int data_set_group_column(data_t *d, int col)
+{
+	if (d->ib.block)
+		return -1;
+	d->group_col = col;
+	return 0;
+}
+
+/**
+ * Sets the number of bootstrap replicates that data_stat_callback() determines
+ * alongside the actual measures. Within each replicate, each row is weighted
+ * by a Poisson(1) distributed number, which is derived from the seed, the
+ * group of tied rows to which the row belongs and the label of the row.
+ * Weighted rows that tie are resampled at once, see data_stat_tie_flush().
+ * The replicates are accounted by up to the number of threads of the frame
+ * at once.
+ *
+ * @param d
+ * @param replicates the number of replicates, 0 to disable the bootstrap.
+ * @param seed
+ */
+void data_set_bootstrap(data_t *d, uint32_t replicates, uint64_t seed)
+{
+	d->bootstrap_replicates = replicates;
+	d->bootstrap_seed = seed;
+}
+
+/**
+ * Returns the number of bytes occupied by a single value of the given
+ * datatype.
+ *
+ * @param dt
+ * @return the size in bytes, 0 for an unknown datatype.
+ */
+static inline uint32_t data_datatype_size(enum column_datatype_t dt)
+{
+	switch (dt)
+	{
+		case	INT8: case UINT8: return sizeof(int8_t);
+		case	INT16: return sizeof(int16_t);
+		case	INT32: return sizeof(int32_t);
+		case	FLOAT32: return sizeof(float);
+		case	DOUBLE: return sizeof(double);
+		default: return 0;
+	}
+}
+
+/**
+ * Returns a value of an integer datatype.
+ *
+ * @param dt
+ * @param value location of the value.
+ * @return the value.
+ */
+static inline int32_t data_value_int32(enum column_datatype_t dt, const uint8_t *value)
+{
+	switch (dt)
+	{
+		case	INT8: return (int8_t)value[0];
+		case	UINT8: return value[0];
+		case	INT16:
+				{
+					int16_t v;
+					memcpy(&v,value,sizeof(v));
+					return v;
+				}
+		default:
+				{
+					int32_t v;
+					memcpy(&v,value,sizeof(v));
+					return v;
+				}
+	}
+}
+
+/**
+ * Returns a value of any datatype as double.
+ *
+ * @param dt
+ * @param value location of the value.
+ * @return the value.
+ */
+static inline double data_value_double(enum column_datatype_t dt, const uint8_t *value)
+{
+	switch (dt)
+	{
+		case	FLOAT32:
+				{
+					float v;
+					memcpy(&v,value,sizeof(v));
+					return v;
+				}
+		case	DOUBLE:
+				{
+					double v;
+					memcpy(&v,value,sizeof(v));
+					return v;
+				}
+		default:
+				return data_value_int32(dt,value);
+	}
+}
+
+/**
+ * Stores an integer as a value of an integer datatype.
+ *
+ * @param dt
+ * @param value where the value is stored.
+ * @param v
+ * @return 0 on success, -1 if v doesn't fit into the datatype, in which
+ *  case it is truncated.
+ */
+static inline int data_store_int32(enum column_datatype_t dt, uint8_t *value, int32_t v)
+{
+	switch (dt)
+	{
+		case	INT8:
+				value[0] = (uint8_t)v;
+				return v < INT8_MIN || v > INT8_MAX ? -1 : 0;
+		case	UINT8:
+				value[0] = (uint8_t)v;
+				return v < 0 || v > UINT8_MAX ? -1 : 0;
+		case	INT16:
+				{
+					int16_t i = (int16_t)v;
+					memcpy(value,&i,sizeof(i));
+					return v < INT16_MIN || v > INT16_MAX ? -1 : 0;
+				}
+		default:
+				memcpy(value,&v,sizeof(v));
+				return 0;
+	}
+}
+
+/**
+ * Stores a number as a value of a floating point datatype.
+ *
+ * @param dt
+ * @param value where the value is stored.
+ * @param v
+ */
+static inline void data_store_double(enum column_datatype_t dt, uint8_t *value, double v)
+{
+	if (dt == FLOAT32)
+	{
+		float f = (float)v;
+		memcpy(value,&f,sizeof(f));
+	} else
+	{
+		memcpy(value,&v,sizeof(v));
+	}
+}
+
+/**
+ * Maps a value to an unsigned integer of as many bits as the value
+ * occupies, such that the order of the values is preserved.
+ *
+ * @param dt
+ * @param value location of the value.
+ * @return the integer.
+ */
+static inline uint64_t data_value_key(enum column_datatype_t dt, const uint8_t *value)
+{
+	switch (dt)
+	{
+		case	UINT8:
+				return value[0];
+		case	FLOAT32:
+				{
+					uint32_t v;
+					memcpy(&v,value,sizeof(v));
+					/* Negative numbers have their order reversed */
+					return v >> 31 ? (uint32_t)~v : v | UINT32_C(0x80000000);
+				}
+		case	DOUBLE:
+				{
+					uint64_t v;
+					memcpy(&v,value,sizeof(v));
+					return v >> 63 ? ~v : v | (UINT64_C(1) << 63);
+				}
+		default:
+				return (uint64_t)((int64_t)data_value_int32(dt,value) + (INT64_C(1) << (data_datatype_size(dt) * 8 - 1)));
+	}
+}
+
+/**
+ * Stores the value that corresponds to an integer of data_value_key().
+ *
+ * @param dt
+ * @param value where the value is stored.
+ * @param key
+ */
+static inline void data_value_from_key(enum column_datatype_t dt, uint8_t *value, uint64_t key)
+{
+	switch (dt)
+	{
+		case	UINT8:
+				value[0] = (uint8_t)key;
+				break;
+		case	FLOAT32:
+				{
+					uint32_t v = (uint32_t)key;
+					v = v >> 31 ? v & ~UINT32_C(0x80000000) : ~v;
+					memcpy(value,&v,sizeof(v));
+				}
+				break;
+		case	DOUBLE:
+				key = key >> 63 ? key & ~(UINT64_C(1) << 63) : ~key;
+				memcpy(value,&key,sizeof(key));
+				break;
+		default:
+				data_store_int32(dt,value,(int32_t)((int64_t)key - (INT64_C(1) << (data_datatype_size(dt) * 8 - 1))));
+				break;
+	}
+}
+
+/**
+ * Sets the number of columns of the given data frame.
+ *
+ * @param d
+ * @param cols
+ * @return 0 on success, else an error.
+ */
+int data_set_number_of_columns(data_t *d, uint32_t cols)
+{
+	int i;
+	int err = -1;
+
+	d->num_columns = cols;
+
+	if (!(d->column_datatype = malloc(sizeof(d->column_datatype[0])*cols)))
+		goto out;
+
+	if (!(d->column_offsets = malloc(sizeof(d->column_offsets[0])*cols)))
+		goto out;
+
+	for (i=0;i<cols;i++)
+	{
+		d->column_datatype[i] = UNKNOWN;
+		d->column_offsets[i] = 0;
+	}
+	err = 0;
+
+out:
+	return err;
+}
+
+/**
+ * Sets the type of the column.
+ *
+ * @param d
+ * @param col
+ * @param dt
+ * @return
+ */
+int data_set_column_datatype(data_t *d, int col, enum column_datatype_t dt)
+{
+	d->column_datatype[col] = dt;
+	return 0;
+}
+
+/**
+ * Calculates the memory occupied by one row and determines the
+ * column offsets.
+ *
+ * @param d
+ * @return the number of bytes occupied by one row.
+ */
+static size_t data_sizeof_row_and_set_column_offsets(data_t *d)
+{
+	int col;
+	size_t size = 0;
+
+	for (col=0;col<d->num_columns;col++)
+	{
+		d->column_offsets[col] = size;
+		size += data_datatype_size(d->column_datatype[col]);
+	}
+	return size;
+}
+
+/**
+ * Initializes a given block.
+ *
+ * @param b
+ * @param d
+ * @param block_bytes
+ * @return 0 on success, else an error.
+ */
+static int data_initialize_block(block_t *b, data_t *d, uint32_t block_bytes)
+{
+	int err = -1;
+	if (!(b->block = (uint8_t*)malloc(block_bytes)))
+		goto out;
+
+	b->num_rows = block_bytes / d->num_bytes_per_row;
+	b->row_offset = 0;
+	b->current_row = 0;
+
+	D("Initialized block %p with %d rows of storage\n",b,b->num_rows);
+	err = 0;
+out:
+	return err;
+}
+
+/**
+ * Returns the number of bytes occupied by a single value of the given
+ * column.
+ *
+ * @param d
+ * @param col
+ * @return the size in bytes.
+ */
+static inline uint32_t data_column_size(data_t *d, int col)
+{
+	return data_datatype_size(d->column_datatype[col]);
+}
+
+/**
+ * Returns the distance in bytes between the values of the given column
+ * of two consecutive rows of a block.
+ *
+ * @param d
+ * @param col
+ * @return the distance in bytes.
+ */
+static inline size_t data_column_stride(data_t *d, int col)
+{
+	return d->layout == LAYOUT_COLUMNS ? data_column_size(d,col) : d->num_bytes_per_row;
+}
+
+/**
+ * Returns the location of a value within a block. In the columnar
+ * layout, the values of column col start at ib.num_rows * column_offsets[col],
+ * so every block that is stored in that layout must have the capacity of
+ * the input block.
+ *
+ * @param d
+ * @param block
+ * @param r the row relative to the start of the block.
+ * @param col
+ * @return the location of the value.
+ */
+static inline uint8_t *data_block_entry(data_t *d, uint8_t *block, uint32_t r, int col)
+{
+	if (d->layout == LAYOUT_COLUMNS)
+		return block + (size_t)d->ib.num_rows * d->column_offsets[col] + (size_t)r * data_column_size(d,col);
+	return block + (size_t)r * d->num_bytes_per_row + d->column_offsets[col];
+}
+
+/**
+ * Copies n values of the given size between two strided arrays.
+ *
+ * @param dest
+ * @param dest_stride
+ * @param src
+ * @param src_stride
+ * @param size
+ * @param n
+ */
+static void data_copy_values(uint8_t *dest, size_t dest_stride, const uint8_t *src, size_t src_stride, uint32_t size, uint32_t n)
+{
+	uint32_t i;
+
+	switch (size)
+	{
+		case	sizeof(int8_t):
+				for (i=0;i<n;i++)
+					dest[i * dest_stride] = src[i * src_stride];
+				break;
+		case	sizeof(int16_t):
+				for (i=0;i<n;i++)
+					memcpy(&dest[i * dest_stride],&src[i * src_stride],sizeof(int16_t));
+				break;
+		case	sizeof(int32_t):
+				for (i=0;i<n;i++)
+					memcpy(&dest[i * dest_stride],&src[i * src_stride],sizeof(int32_t));
+				break;
+		case	sizeof(double):
+				for (i=0;i<n;i++)
+					memcpy(&dest[i * dest_stride],&src[i * src_stride],sizeof(double));
+				break;
+		default:
+				for (i=0;i<n;i++)
+					memcpy(&dest[i * dest_stride],&src[i * src_stride],size);
+				break;
+	}
+}
+
+/**
+ * Copies packed rows into a block.
+ *
+ * @param d
+ * @param block
+ * @param r the row of the block where the first row is stored.
+ * @param rows
+ * @param n the number of rows.
+ */
+static void data_block_put_rows(data_t *d, uint8_t *block, uint32_t r, const uint8_t *rows, uint32_t n)
+{
+	int col;
+
+	if (d->layout == LAYOUT_ROWS)
+	{
+		memcpy(&block[(size_t)r * d->num_bytes_per_row],rows,(size_t)n * d->num_bytes_per_row);
+		return;
+	}
+
+	for (col=0;col<d->num_columns;col++)
+	{
+		uint32_t size = data_column_size(d,col);
+		data_copy_values(data_block_entry(d,block,r,col),size,&rows[d->column_offsets[col]],d->num_bytes_per_row,size,n);
+	}
+}
+
+/**
+ * Copies rows of a block into packed rows.
+ *
+ * @param d
+ * @param block
+ * @param r the row of the block of the first row to be copied.
+ * @param rows
+ * @param n the number of rows.
+ */
+static void data_block_get_rows(data_t *d, uint8_t *block, uint32_t r, uint8_t *rows, uint32_t n)
+{
+	int col;
+
+	if (d->layout == LAYOUT_ROWS)
+	{
+		memcpy(rows,&block[(size_t)r * d->num_bytes_per_row],(size_t)n * d->num_bytes_per_row);
+		return;
+	}
+
+	for (col=0;col<d->num_columns;col++)
+	{
+		uint32_t size = data_column_size(d,col);
+		data_copy_values(&rows[d->column_offsets[col]],d->num_bytes_per_row,data_block_entry(d,block,r,col),size,size,n);
+	}
+}
+
+/**
+ * Returns the number of bytes that a block that holds the given number
+ * of rows occupies on disk. In the columnar layout, the column segments
+ * are spread over the entire capacity of the block.
+ *
+ * @param d
+ * @param rows
+ * @return the number of bytes.
+ */
+static inline size_t data_block_file_bytes(data_t *d, uint32_t rows)
+{
+	if (d->layout == LAYOUT_COLUMNS)
+		rows = d->ib.num_rows;
+	return (size_t)rows * d->num_bytes_per_row;
+}
+
+/**
+ * Returns the value of a weight column as a count.
+ *
+ * @param d
+ * @param col
+ * @param value location of the value.
+ * @return the count, 0 for negative values.
+ */
+static inline uint64_t data_weight_value(data_t *d, int col, const uint8_t *value)
+{
+	enum column_datatype_t dt = d->column_datatype[col];
+
+	if (dt != FLOAT32 && dt != DOUBLE)
+	{
+		int32_t v = data_value_int32(dt,value);
+		return v > 0 ? (uint64_t)v : 0;
+	} else
+	{
+		double v = data_value_double(dt,value);
+		if (!(v > 0)) return 0;
+		return v < 18446744073709551616.0 ? (uint64_t)v : UINT64_MAX;
+	}
+}
+
+/**
+ * Determines how much a row counts as positive and as negative, see
+ * data_set_weight_columns().
+ *
+ * @param d
+ * @param label_col
+ * @param label location of the label value.
+ * @param weight location of the value of the weight or negatives column,
+ *  if there is any.
+ * @param pos where the positive weight is stored.
+ * @param neg where the negative weight is stored.
+ */
+static inline void data_row_weights(data_t *d, int label_col, const uint8_t *label, const uint8_t *weight, uint64_t *pos, uint64_t *neg)
+{
+	uint64_t w = 1;
+	int positive;
+
+	if (d->negatives_col >= 0)
+	{
+		*pos = data_weight_value(d,label_col,label);
+		*neg = data_weight_value(d,d->negatives_col,weight);
+		return;
+	}
+
+	if (d->weight_col >= 0)
+		w = data_weight_value(d,d->weight_col,weight);
+	positive = data_value_double(d->column_datatype[label_col],label) > 0;
+	*pos = positive ? w : 0;
+	*neg = positive ? 0 : w;
+}
+
+/**
+ * Returns the column of the weights of a row, if any.
+ */
+static inline int data_weights_col(data_t *d)
+{
+	return d->negatives_col >= 0 ? d->negatives_col : d->weight_col;
+}
+
+/**
+ * Adds up the positive and negative weights of the rows of a block.
+ *
+ * @param d
+ * @param block
+ * @param n the number of rows.
+ * @param label_col
+ * @param positives where the positive weight is added.
+ * @param negatives where the negative weight is added.
+ */
+static void data_block_count(data_t *d, uint8_t *block, uint32_t n, int label_col, uint64_t *positives, uint64_t *negatives)
+{
+	const uint8_t *labels = data_block_entry(d,block,0,label_col);
+	size_t stride = data_column_stride(d,label_col);
+	int wcol = data_weights_col(d);
+	const uint8_t *weights = NULL;
+	size_t wstride = 0;
+	uint32_t k;
+
+	if (wcol < 0)
+	{
+		enum column_datatype_t dt = d->column_datatype[label_col];
+		uint64_t pos = 0;
+
+		for (k=0;k<n;k++)
+			pos += data_value_double(dt,&labels[k * stride]) > 0;
+		*positives += pos;
+		*negatives += n - pos;
+		return;
+	}
+
+	weights = data_block_entry(d,block,0,wcol);
+	wstride = data_column_stride(d,wcol);
+	for (k=0;k<n;k++)
+	{
+		uint64_t pos, neg;
+
+		data_row_weights(d,label_col,&labels[k * stride],&weights[k * wstride],&pos,&neg);
+		*positives += pos;
+		*negatives += neg;
+	}
+}
+
+/**
+ * Returns the group value of a row.
+ *
+ * @param d
+ * @param value location of the value of the group column.
+ * @return the value.
+ */
+static inline double data_group_value(data_t *d, const uint8_t *value)
+{
+	/* Turns -0 into 0 */
+	return data_value_double(d->column_datatype[d->group_col],value) + 0.0;
+}
+
+/**
+ * Adds the positive and negative weights of the rows of a block to their
+ * groups. Rows of a group are expected to be mostly consecutive.
+ *
+ * @param d
+ * @param block
+ * @param n the number of rows.
+ * @param label_col
+ * @param g the groups.
+ * @param mutex protects the groups if not NULL.
+ * @return 0 on success, else an error.
+ */
+static int data_block_count_groups(data_t *d, uint8_t *block, uint32_t n, int label_col, struct data_groups *g, pthread_mutex_t *mutex)
+{
+	const uint8_t *labels = data_block_entry(d,block,0,label_col);
+	const uint8_t *groups = data_block_entry(d,block,0,d->group_col);
+	size_t stride = data_column_stride(d,label_col);
+	size_t gstride = data_column_stride(d,d->group_col);
+	int wcol = data_weights_col(d);
+	const uint8_t *weights = wcol >= 0 ? data_block_entry(d,block,0,wcol) : NULL;
+	size_t wstride = wcol >= 0 ? data_column_stride(d,wcol) : 0;
+	uint64_t run_pos = 0;
+	uint64_t run_neg = 0;
+	double run_value = 0;
+	int err = 0;
+	uint32_t k;
+
+	if (mutex)
+		pthread_mutex_lock(mutex);
+	for (k=0;k<n && !err;k++)
+	{
+		double value = data_group_value(d,&groups[k * gstride]);
+		uint64_t pos, neg;
+
+		if (k && value != run_value)
+		{
+			err = data_groups_add(g,run_value,run_pos,run_neg);
+			run_pos = run_neg = 0;
+		}
+		run_value = value;
+		data_row_weights(d,label_col,&labels[k * stride],weights ? &weights[k * wstride] : NULL,&pos,&neg);
+		run_pos += pos;
+		run_neg += neg;
+	}
+	if (n && !err)
+		err = data_groups_add(g,run_value,run_pos,run_neg);
+	if (mutex)
+		pthread_mutex_unlock(mutex);
+	return err;
+}
+
+/**
+ * Reads or writes all bytes at the given offset of the file.
+ *
+ * @param fd
+ * @param buf
+ * @param bytes
+ * @param offset
+ * @param write whether to write or to read.
+ * @return 0 on success, else an error.
+ */
+static int file_pio(int fd, uint8_t *buf, size_t bytes, off_t offset, int write)
+{
+	while (bytes)
+	{
+		ssize_t r = write ? pwrite(fd,buf,bytes,offset) : pread(fd,buf,bytes,offset);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return -1;
+		buf += r;
+		bytes -= r;
+		offset += r;
+	}
+	return 0;
+}
+
+/** Maximal number of rows of a chunk of a compressed file */
+#define DATA_SPILL_CHUNK_ROWS 4096
+
+/** How the values of a column of a chunk are stored */
+#define DATA_SPILL_FOR 0
+#define DATA_SPILL_DELTA 1
+
+/** Size of the header of a column of a chunk: the encoding, the width and the base */
+#define DATA_SPILL_COLUMN_BYTES (2 * sizeof(uint64_t))
+
+/**
+ * Returns the number of bits that are needed to store values up to the
+ * given one.
+ *
+ * @param range
+ * @return the number of bits.
+ */
+static inline int spill_bits(uint64_t range)
+{
+	return range ? 64 - __builtin_clzll(range) : 0;
+}
+
+/**
+ * Returns the number of bytes of the given number of packed values, which
+ * are stored in whole 64 bit words.
+ *
+ * @param n
+ * @param width the number of bits of each value.
+ * @return the number of bytes.
+ */
+static inline size_t spill_packed_bytes(uint32_t n, int width)
+{
+	return (((uint64_t)n * width + 63) / 64) * sizeof(uint64_t);
+}
+
+/**
+ * Packs values that fit into the given number of bits.
+ *
+ * @param out where the spill_packed_bytes() bytes are stored.
+ * @param values
+ * @param n the number of values.
+ * @param width the number of bits of each value.
+ */
+static void spill_pack(uint8_t *out, const uint64_t *values, uint32_t n, int width)
+{
+	uint64_t acc = 0;
+	int bits = 0;
+	uint32_t i;
+
+	if (!width)
+		return;
+
+	for (i=0;i<n;i++)
+	{
+		uint64_t v = values[i];
+
+		acc |= v << bits;
+		bits += width;
+		if (bits >= 64)
+		{
+			memcpy(out,&acc,sizeof(acc));
+			out += sizeof(acc);
+			bits -= 64;
+			acc = bits ? v >> (width - bits) : 0;
+		}
+	}
+	if (bits)
+		memcpy(out,&acc,sizeof(acc));
+}
+
+/**
+ * Unpacks values that have been packed by spill_pack().
+ *
+ * @param values
+ * @param in
+ * @param n the number of values.
+ * @param width the number of bits of each value.
+ */
+static void spill_unpack(uint64_t *values, const uint8_t *in, uint32_t n, int width)
+{
+	uint64_t mask = width == 64 ? ~UINT64_C(0) : (UINT64_C(1) << width) - 1;
+	uint64_t acc = 0;
+	int bits = 0;
+	uint32_t i;
+
+	if (!width)
+	{
+		memset(values,0,sizeof(values[0]) * n);
+		return;
+	}
+
+	for (i=0;i<n;i++)
+	{
+		uint64_t next;
+
+		if (bits >= width)
+		{
+			values[i] = acc & mask;
+			acc >>= width;
+			bits -= width;
+			continue;
+		}
+
+		/* The value continues in the next word */
+		memcpy(&next,in,sizeof(next));
+		in += sizeof(next);
+		values[i] = (acc | (next << bits)) & mask;
+		acc = width - bits < 64 ? next >> (width - bits) : 0;
+		bits = 64 - (width - bits);
+	}
+}
+
+/**
+ * Returns the maximal number of bytes of an encoded chunk.
+ *
+ * @param d
+ * @param n the number of rows of the chunk.
+ * @return the number of bytes.
+ */
+static inline size_t data_spill_max_chunk_bytes(data_t *d, uint32_t n)
+{
+	return d->num_columns * (DATA_SPILL_COLUMN_BYTES + sizeof(uint64_t) + spill_packed_bytes(n,64));
+}
+
+/**
+ * Encodes packed rows as a chunk. The values of each column are mapped to
+ * integers by data_value_key() and stored with as few bits as their range
+ * needs, either relative to the smallest value or, which suits sorted
+ * columns, as differences of consecutive values relative to the smallest
+ * difference. Labels thus take a single bit.
+ *
+ * @param d
+ * @param out where the chunk is stored, data_spill_max_chunk_bytes() bytes.
+ * @param rows
+ * @param n the number of rows, at least 1.
+ * @param keys scratch space for n values.
+ * @return the number of bytes of the chunk.
+ */
+static size_t data_spill_encode(data_t *d, uint8_t *out, const uint8_t *rows, uint32_t n, uint64_t *keys)
+{
+	uint8_t *start = out;
+	uint32_t bpr = d->num_bytes_per_row;
+	int col;
+
+	for (col=0;col<d->num_columns;col++)
+	{
+		const uint8_t *values = &rows[d->column_offsets[col]];
+		enum column_datatype_t dt = d->column_datatype[col];
+		uint64_t min, max;
+		int64_t diff_min, diff_max;
+		int width, diff_width;
+		uint32_t i;
+
+		if (!data_column_size(d,col))
+			continue;
+
+		min = max = keys[0] = data_value_key(dt,values);
+		diff_min = INT64_MAX;
+		diff_max = INT64_MIN;
+		for (i=1;i<n;i++)
+		{
+			int64_t diff;
+
+			keys[i] = data_value_key(dt,&values[(size_t)i * bpr]);
+			diff = (int64_t)(keys[i] - keys[i-1]);
+			min = MIN(min,keys[i]);
+			max = MAX(max,keys[i]);
+			diff_min = MIN(diff_min,diff);
+			diff_max = MAX(diff_max,diff);
+		}
+
+		width = spill_bits(max - min);
+		diff_width = n > 1 ? spill_bits((uint64_t)diff_max - (uint64_t)diff_min) : 64;
+
+		memset(out,0,DATA_SPILL_COLUMN_BYTES);
+		if (spill_packed_bytes(n - 1,diff_width) + sizeof(uint64_t) < spill_packed_bytes(n,width))
+		{
+			/* Backwards, so the preceding value is still available */
+			for (i=n-1;i>0;i--)
+				keys[i] = keys[i] - keys[i-1] - (uint64_t)diff_min;
+
+			out[0] = DATA_SPILL_DELTA;
+			out[1] = diff_width;
+			memcpy(&out[sizeof(uint64_t)],&diff_min,sizeof(diff_min));
+			memcpy(&out[DATA_SPILL_COLUMN_BYTES],&keys[0],sizeof(keys[0]));
+			out += DATA_SPILL_COLUMN_BYTES + sizeof(uint64_t);
+			spill_pack(out,&keys[1],n - 1,diff_width);
+			out += spill_packed_bytes(n - 1,diff_width);
+		} else
+		{
+			for (i=0;i<n;i++)
+				keys[i] -= min;
+
+			out[0] = DATA_SPILL_FOR;
+			out[1] = width;
+			memcpy(&out[sizeof(uint64_t)],&min,sizeof(min));
+			out += DATA_SPILL_COLUMN_BYTES;
+			spill_pack(out,keys,n,width);
+			out += spill_packed_bytes(n,width);
+		}
+	}
+	return out - start;
+}
+
+/**
+ * Decodes a chunk that has been encoded by data_spill_encode().
+ *
+ * @param d
+ * @param rows where the packed rows are stored.
+ * @param in
+ * @param bytes the number of bytes of the chunk.
+ * @param n the number of rows.
+ * @param keys scratch space for n values.
+ * @return 0 on success, else an error.
+ */
+static int data_spill_decode(data_t *d, uint8_t *rows, const uint8_t *in, size_t bytes, uint32_t n, uint64_t *keys)
+{
+	const uint8_t *end = in + bytes;
+	uint32_t bpr = d->num_bytes_per_row;
+	int col;
+
+	for (col=0;col<d->num_columns;col++)
+	{
+		uint8_t *values = &rows[d->column_offsets[col]];
+		enum column_datatype_t dt = d->column_datatype[col];
+		uint64_t base;
+		int width;
+		uint32_t i;
+
+		if (!data_column_size(d,col))
+			continue;
+
+		if (end - in < DATA_SPILL_COLUMN_BYTES || in[1] > 64)
+			return -1;
+		width = in[1];
+		memcpy(&base,&in[sizeof(uint64_t)],sizeof(base));
+
+		if (in[0] == DATA_SPILL_DELTA)
+		{
+			if (end - in < DATA_SPILL_COLUMN_BYTES + sizeof(uint64_t) + spill_packed_bytes(n - 1,width))
+				return -1;
+			memcpy(&keys[0],&in[DATA_SPILL_COLUMN_BYTES],sizeof(keys[0]));
+			in += DATA_SPILL_COLUMN_BYTES + sizeof(uint64_t);
+			spill_unpack(&keys[1],in,n - 1,width);
+			in += spill_packed_bytes(n - 1,width);
+			for (i=1;i<n;i++)
+				keys[i] += keys[i-1] + base;
+		} else
+		{
+			if (end - in < DATA_SPILL_COLUMN_BYTES + spill_packed_bytes(n,width))
+				return -1;
+			in += DATA_SPILL_COLUMN_BYTES;
+			spill_unpack(keys,in,n,width);
+			in += spill_packed_bytes(n,width);
+			for (i=0;i<n;i++)
+				keys[i] += base;
+		}
+
+		for (i=0;i<n;i++)
+			data_value_from_key(dt,&values[(size_t)i * bpr],keys[i]);
+	}
+	return 0;
+}
+
+/**
+ * Returns the chunks of a compressed file. The caller must hold the
+ * spill_mutex.
+ *
+ * @param d
+ * @param fd
+ * @param create whether the chunks are created if the file has none.
+ * @return the chunks or NULL.
+ */
+static struct spill_file *data_spill_file(data_t *d, int fd, int create)
+{
+	struct spill_file *unused = NULL;
+	int i;
+
+	for (i=0;i<DATA_SPILL_FILES;i++)
+	{
+		struct spill_file *f = &d->spill_files[i];
+
+		if (f->used && f->fd == fd)
+			return f;
+		if (!f->used && !unused)
+			unused = f;
+	}
+	if (!create || !unused)
+		return NULL;
+	unused->used = 1;
+	unused->fd = fd;
+	unused->num_chunks = 0;
+	return unused;
+}
+
+/**
+ * Forgets the chunks of a file, e.g., because the file is closed or
+ * completely rewritten.
+ *
+ * @param d
+ * @param fd
+ */
+static void data_spill_forget(data_t *d, int fd)
+{
+	struct spill_file *f;
+
+	pthread_mutex_lock(&d->spill_mutex);
+	if ((f = data_spill_file(d,fd,0)))
+		f->used = 0;
+	pthread_mutex_unlock(&d->spill_mutex);
+}
+
+/**
+ * Passes the chunks of a file on to another descriptor of the same file,
+ * e.g., because it has been renamed and opened again.
+ *
+ * @param d
+ * @param from
+ * @param to
+ */
+static void data_spill_move(data_t *d, int from, int to)
+{
+	struct spill_file *f;
+
+	if (from == to)
+		return;
+
+	pthread_mutex_lock(&d->spill_mutex);
+	if ((f = data_spill_file(d,to,0)))
+		f->used = 0;
+	if ((f = data_spill_file(d,from,0)))
+		f->fd = to;
+	pthread_mutex_unlock(&d->spill_mutex);
+}
+
+/**
+ * Records consecutive chunks that have been written to a file. They
+ * replace the chunks that they overlap.
+ *
+ * @param d
+ * @param fd
+ * @param chunks
+ * @param n the number of chunks, at least 1.
+ * @return 0 on success, else an error.
+ */
+static int data_spill_record(data_t *d, int fd, const struct spill_chunk *chunks, uint32_t n)
+{
+	int err = -1;
+	struct spill_file *f;
+	uint32_t first = chunks[0].first_row;
+	uint32_t end = chunks[n-1].first_row + chunks[n-1].rows;
+	uint32_t lo, hi, m;
+
+	pthread_mutex_lock(&d->spill_mutex);
+	if (!(f = data_spill_file(d,fd,1)))
+		goto out;
+
+	/* The chunks [lo,hi) are replaced */
+	for (lo=0,hi=f->num_chunks;lo<hi;)
+	{
+		m = lo + (hi - lo) / 2;
+		if (f->chunks[m].first_row + f->chunks[m].rows <= first)
+			lo = m + 1;
+		else
+			hi = m;
+	}
+	for (hi=lo;hi<f->num_chunks && f->chunks[hi].first_row < end;hi++);
+
+	/* Rows are always rewritten together with the rows of their chunk */
+	if ((lo < hi && f->chunks[lo].first_row < first) || (lo < hi && f->chunks[hi-1].first_row + f->chunks[hi-1].rows > end))
+	{
+		fprintf(stderr,"Rows of a compressed chunk were rewritten partly\n");
+		goto out;
+	}
+
+	if (f->num_chunks - (hi - lo) + n > f->max_chunks)
+	{
+		uint32_t max_chunks = MAX(f->max_chunks * 2,f->num_chunks - (hi - lo) + n);
+		struct spill_chunk *c;
+
+		if (!(c = (struct spill_chunk*)realloc(f->chunks,sizeof(c[0]) * max_chunks)))
+			goto out;
+		f->chunks = c;
+		f->max_chunks = max_chunks;
+	}
+	memmove(&f->chunks[lo + n],&f->chunks[hi],sizeof(f->chunks[0]) * (f->num_chunks - hi));
+	memcpy(&f->chunks[lo],chunks,sizeof(chunks[0]) * n);
+	f->num_chunks += n - (hi - lo);
+	err = 0;
+out:
+	pthread_mutex_unlock(&d->spill_mutex);
+	return err;
+}
+
+/**
+ * Looks up the chunk of a file that contains the given row.
+ *
+ * @param d
+ * @param fd
+ * @param row
+ * @param c where the chunk is stored.
+ * @return 0 on success, else an error.
+ */
+static int data_spill_lookup(data_t *d, int fd, uint32_t row, struct spill_chunk *c)
+{
+	int err = -1;
+	struct spill_file *f;
+	uint32_t lo, hi, m;
+
+	pthread_mutex_lock(&d->spill_mutex);
+	if (!(f = data_spill_file(d,fd,0)))
+		goto out;
+	for (lo=0,hi=f->num_chunks;lo<hi;)
+	{
+		m = lo + (hi - lo) / 2;
+		if (f->chunks[m].first_row + f->chunks[m].rows <= row)
+			lo = m + 1;
+		else
+			hi = m;
+	}
+	if (lo == f->num_chunks || f->chunks[lo].first_row > row)
+		goto out;
+	*c = f->chunks[lo];
+	err = 0;
+out:
+	pthread_mutex_unlock(&d->spill_mutex);
+	return err;
+}
+
+/**
+ * Writes consecutive rows to a compressed file. Chunks of rows are encoded
+ * by data_spill_encode() and stored at the offset of their first row, so
+ * the file keeps the positions of the uncompressed one, but has holes.
+ * Chunks that don't get smaller are stored as they are. As the chunks
+ * start at the given row, rows are always written in whole blocks.
+ *
+ * @param d
+ * @param fd
+ * @param buf the rows, either packed or as a block of the data frame whose
+ *  first row is the given one.
+ * @param packed whether buf contains packed rows.
+ * @param row the first row to be written.
+ * @param n the number of rows.
+ * @return 0 on success, else an error.
+ */
+static int data_spill_pwrite(data_t *d, int fd, const uint8_t *buf, int packed, uint32_t row, uint32_t n)
+{
+	int err = -1;
+	uint32_t bpr = d->num_bytes_per_row;
+	uint32_t num_chunks = (n + DATA_SPILL_CHUNK_ROWS - 1) / DATA_SPILL_CHUNK_ROWS;
+	struct spill_chunk *chunks = NULL;
+	uint64_t *keys = NULL;
+	uint8_t *rows = NULL;
+	uint8_t *encoded = NULL;
+	uint32_t i;
+
+	if (!n)
+		return 0;
+
+	if (!(chunks = (struct spill_chunk*)malloc(sizeof(chunks[0]) * num_chunks)))
+		goto out;
+	if (!(keys = (uint64_t*)malloc(sizeof(keys[0]) * DATA_SPILL_CHUNK_ROWS)))
+		goto out;
+	if (!(encoded = (uint8_t*)malloc(data_spill_max_chunk_bytes(d,DATA_SPILL_CHUNK_ROWS))))
+		goto out;
+	if (!packed && d->layout == LAYOUT_COLUMNS && !(rows = (uint8_t*)malloc((size_t)DATA_SPILL_CHUNK_ROWS * bpr)))
+		goto out;
+
+	for (i=0;i<num_chunks;i++)
+	{
+		uint32_t r = i * DATA_SPILL_CHUNK_ROWS;
+		uint32_t m = MIN(n - r,DATA_SPILL_CHUNK_ROWS);
+		const uint8_t *chunk_rows = &buf[(size_t)r * bpr];
+		size_t bytes;
+
+		if (rows)
+		{
+			data_block_get_rows(d,(uint8_t*)buf,r,rows,m);
+			chunk_rows = rows;
+		}
+
+		bytes = data_spill_encode(d,encoded,chunk_rows,m,keys);
+		if (bytes >= (size_t)m * bpr)
+			bytes = (size_t)m * bpr;
+		if (file_pio(fd,bytes == (size_t)m * bpr ? (uint8_t*)chunk_rows : encoded,bytes,(off_t)(row + r) * bpr,1))
+		{
+			fprintf(stderr,"Write failed!\n");
+			goto out;
+		}
+		chunks[i].first_row = row + r;
+		chunks[i].rows = m;
+		chunks[i].bytes = bytes;
+	}
+	err = data_spill_record(d,fd,chunks,num_chunks);
+out:
+	free(rows);
+	free(encoded);
+	free(keys);
+	free(chunks);
+	return err;
+}
+
+/**
+ * Reads consecutive rows from a compressed file that has been written by
+ * data_spill_pwrite().
+ *
+ * @param d
+ * @param fd
+ * @param buf where the rows are stored, either packed or as a block of the
+ *  data frame whose first row is the given one.
+ * @param packed whether buf takes packed rows.
+ * @param row the first row to be read.
+ * @param n the number of rows.
+ * @return 0 on success, else an error.
+ */
+static int data_spill_pread(data_t *d, int fd, uint8_t *buf, int packed, uint32_t row, uint32_t n)
+{
+	int err = -1;
+	uint32_t bpr = d->num_bytes_per_row;
+	uint64_t *keys = NULL;
+	uint8_t *rows = NULL;
+	uint8_t *encoded = NULL;
+	uint32_t r;
+
+	if (!n)
+		return 0;
+
+	if (!(keys = (uint64_t*)malloc(sizeof(keys[0]) * DATA_SPILL_CHUNK_ROWS)))
+		goto out;
+	if (!(encoded = (uint8_t*)malloc(data_spill_max_chunk_bytes(d,DATA_SPILL_CHUNK_ROWS))))
+		goto out;
+	if (!(rows = (uint8_t*)malloc((size_t)DATA_SPILL_CHUNK_ROWS * bpr)))
+		goto out;
+
+	for (r=0;r<n;)
+	{
+		struct spill_chunk c;
+		uint32_t skip, m;
+		uint8_t *chunk_rows;
+
+		if (data_spill_lookup(d,fd,row + r,&c) || c.rows > DATA_SPILL_CHUNK_ROWS)
+		{
+			fprintf(stderr,"Row %d hasn't been written\n",row + r);
+			goto out;
+		}
+		skip = row + r - c.first_row;
+		m = MIN(n - r,c.rows - skip);
+
+		/* Whole chunks of packed rows are read or decoded in place */
+		if (c.bytes == (size_t)c.rows * bpr)
+		{
+			chunk_rows = packed ? &buf[(size_t)r * bpr] : rows;
+			if (file_pio(fd,chunk_rows,(size_t)m * bpr,(off_t)(row + r) * bpr,0))
+			{
+				fprintf(stderr,"Reading row %d failed!\n",row + r);
+				goto out;
+			}
+			skip = 0;
+		} else
+		{
+			chunk_rows = packed && !skip && m == c.rows ? &buf[(size_t)r * bpr] : rows;
+			if (file_pio(fd,encoded,c.bytes,(off_t)c.first_row * bpr,0))
+			{
+				fprintf(stderr,"Reading row %d failed!\n",row + r);
+				goto out;
+			}
+			if (data_spill_decode(d,chunk_rows,encoded,c.bytes,c.rows,keys))
+			{
+				fprintf(stderr,"Chunk at row %d is corrupt\n",c.first_row);
+				goto out;
+			}
+		}
+
+		if (!packed)
+			data_block_put_rows(d,buf,r,&chunk_rows[(size_t)skip * bpr],m);
+		else if (chunk_rows == rows)
+			memcpy(&buf[(size_t)r * bpr],&chunk_rows[(size_t)skip * bpr],(size_t)m * bpr);
+		r += m;
+	}
+	err = 0;
+out:
+	free(rows);
+	free(encoded);
+	free(keys);
+	return err;
+}
+
+/**
+ * Reads or writes the rows of a block at the position of the given row
+ * of the external file.
+ *
+ * @param d
+ * @param fd
+ * @param block
+ * @param row the first row of the block.
+ * @param n the number of rows.
+ * @param write whether to write or to read.
+ * @return 0 on success, else an error.
+ */
+static int data_block_pio(data_t *d, int fd, uint8_t *block, uint32_t row, uint32_t n, int write)
+{
+	if (d->spill_compression)
+		return write ? data_spill_pwrite(d,fd,block,0,row,n) : data_spill_pread(d,fd,block,0,row,n);
+	return file_pio(fd,block,data_block_file_bytes(d,n),(off_t)row * d->num_bytes_per_row,write);
+}
+
+/**
+ * Write the contents of the input block to disk.
+ *
+ * @param d
+ * @return 0 on success, else an error.
+ */
+static int data_write_input_block(data_t *d)
+{
+	int err;
+	block_t *b = &d->ib;
+
+	err = -1;
+
+	if (!d->tmp)
+	{
+		if (!(d->tmp = fopen(d->filename,"w+")))
+			goto out;
+	}
+
+	if (d->spill_compression)
+	{
+		/* Only the rows that have been inserted are compressed */
+		if (b->row_offset < d->num_rows && data_spill_pwrite(d,fileno(d->tmp),b->block,0,b->row_offset,MIN(b->num_rows,d->num_rows - b->row_offset)))
+			goto out;
+		err = 0;
+		goto out;
+	}
+
+	if (fseeko(d->tmp,(off_t)d->num_bytes_per_row * b->row_offset,SEEK_SET))
+	{
+		fprintf(stderr,"Seek failed\n");
+		goto out;
+	}
+	D("Writing to %llx (offset %d)\n",(unsigned long long)ftello(d->tmp),b->row_offset);
+	if ((fwrite(b->block,d->num_bytes_per_row,b->num_rows,d->tmp) != b->num_rows ))
+	{
+		fprintf(stderr,"Write failed!\n");
+		goto out;
+	}
+	err = 0;
+out:
+	return err;
+}
+
+
+/** Bytes per row that are needed in addition to the rows by data_sort_block() */
+#define DATA_SORT_SCRATCH_BYTES_PER_ROW (2 * sizeof(uint64_t) + 2 * sizeof(uint32_t))
+
+/** Initial size of an input block that may grow */
+#define DATA_INITIAL_BLOCK_BYTES (1024 * 1024)
+
+/**
+ * Derives the sizes of the various buffers from the memory budget. The
+ * row layout must be known.
+ *
+ * An eighth of the budget is reserved for parsing. The run size is chosen
+ * such that the input block plus the buffers of the run generation pipeline
+ * and the scratch space of the sorters fit into the rest. The input block
+ * may grow to the size that can be sorted in memory, and the merge buffers
+ * take what remains next to the input block and the output buffer.
+ *
+ * @param d
+ */
+static void data_apply_memory_budget(data_t *d)
+{
+	size_t bpr = d->num_bytes_per_row;
+	size_t sort_bpr = bpr + DATA_SORT_SCRATCH_BYTES_PER_ROW;
+	size_t threads = d->num_threads;
+	size_t avail;
+	size_t run_rows;
+	size_t max_rows;
+
+	if (!d->memory_budget || !bpr)
+		return;
+
+	d->parse_chunk_bytes = MIN(d->memory_budget / 8 / threads, 1024 * 1024 * 16);
+	d->parse_chunk_bytes = MAX(d->parse_chunk_bytes, 1024 * 64);
+	avail = d->memory_budget - MIN(d->memory_budget / 8, d->parse_chunk_bytes * threads);
+
+	/* Input block, a reading and a writing buffer, and a buffer for each sorter */
+	run_rows = avail / (bpr * (threads + 3) + threads * sort_bpr);
+	run_rows = MAX(run_rows, 16);
+	run_rows = MIN(run_rows, INT32_MAX / bpr);
+
+	/* The input block is spilled as several runs, so it's a multiple of them */
+	max_rows = avail / (bpr + sort_bpr);
+	max_rows = MIN(max_rows, INT32_MAX / bpr);
+	if (max_rows > run_rows)
+	{
+		size_t runs = (max_rows + run_rows - 1) / run_rows;
+		run_rows = max_rows / runs;
+		max_rows = runs * run_rows;
+	} else
+	{
+		max_rows = run_rows;
+	}
+
+	d->ib_bytes = run_rows * bpr;
+	d->ib_max_rows = max_rows;
+
+	/* The input block and the output buffer stay around while merging */
+	d->merge_bytes = avail > 4 * d->ib_bytes ? avail - 2 * d->ib_bytes : avail / 2;
+	d->merge_buffer_min_bytes = MIN(1024 * 256, d->merge_bytes / 2 / 16);
+	d->merge_buffer_min_bytes = MAX(d->merge_buffer_min_bytes, bpr);
+
+	D("Memory budget %zd: runs of %zd rows, up to %zd rows in memory, %zd bytes for merging\n",
+		d->memory_budget,run_rows,max_rows,d->merge_bytes);
+}
+
+/**
+ * Doubles the capacity of the input block, at most to ib_max_rows rows.
+ *
+ * @param d
+ * @return 0 on success, else an error.
+ */
+static int data_grow_input_block(data_t *d)
+{
+	block_t *b = &d->ib;
+	uint32_t rows = (uint32_t)MIN((uint64_t)b->num_rows * 2, d->ib_max_rows);
+	uint8_t *block;
+	int col;
+
+	if (!(block = (uint8_t*)realloc(b->block, (size_t)rows * d->num_bytes_per_row)))
+	{
+		fprintf(stderr,"Couldn't enlarge the input block\n");
+		return -1;
+	}
+
+	/* Column segments start at offsets that are proportional to the capacity */
+	if (d->layout == LAYOUT_COLUMNS)
+	{
+		for (col=d->num_columns-1;col>0;col--)
+			memmove(&block[(size_t)rows * d->column_offsets[col]],&block[(size_t)b->num_rows * d->column_offsets[col]],(size_t)b->num_rows * data_column_size(d,col));
+	}
+
+	D("Enlarged input block from %d to %d rows\n",b->num_rows,rows);
+	b->block = block;
+	b->num_rows = rows;
+	return 0;
+}
+
+static int data_sort_block(data_t *d, uint8_t *block, uint32_t n);
+
+/**
+ * Sorts the full input block by the presort columns before it is spilled.
+ *
+ * @param d
+ * @return 0 on success, else an error.
+ */
+static int data_presort_input_block(data_t *d)
+{
+	int err;
+
+	d->to_sort_columns = d->presort_columns;
+	d->num_to_sort_columns = d->num_presort_columns;
+	if ((err = data_sort_block(d,d->ib.block,d->ib.num_rows)))
+		return err;
+
+	data_block_count(d,d->ib.block,d->ib.num_rows,d->presort_label_col,&d->presorted_positives,&d->presorted_negatives);
+	if (d->group_col >= 0 && (err = data_block_count_groups(d,d->ib.block,d->ib.num_rows,d->presort_label_col,&d->presorted_groups,NULL)))
+		return err;
+	d->presorted_rows += d->ib.num_rows;
+	return 0;
+}
+
+/**
+ * Writes the full input block to the external file and makes room for
+ * the following rows.
+ *
+ * @param d
+ * @return 0 on success, else an error.
+ */
+static int data_spill_input_block(data_t *d)
+{
+	int err;
+
+	if (d->num_presort_columns && d->presorted_rows == d->ib.row_offset)
+	{
+		if ((err = data_presort_input_block(d)))
+			return err;
+	}
+	if ((err = data_write_input_block(d)))
+		return err;
+	d->ib.row_offset += d->ib.num_rows;
+	d->ib.current_relative_row = 0;
+	return 0;
+}
+
+/**
+ * Writes the full input block that has grown beyond the size of a run
+ * as several runs. The input block is then shrunk to the size of a run.
+ *
+ * @param d
+ * @return 0 on success, else an error.
+ */
+static int data_spill_grown_input_block(data_t *d)
+{
+	int err = -1;
+	uint32_t bpr = d->num_bytes_per_row;
+	uint32_t run_rows = d->ib_bytes / bpr;
+	uint32_t rows = d->ib.num_rows;
+	uint8_t *grown = d->ib.block;
+	uint32_t r;
+	int col;
+
+	if (!(d->ib.block = (uint8_t*)malloc((size_t)run_rows * bpr)))
+	{
+		d->ib.block = grown;
+		return err;
+	}
+	d->ib.num_rows = run_rows;
+
+	for (r=0;r<rows;r+=run_rows)
+	{
+		if (d->layout == LAYOUT_COLUMNS)
+		{
+			for (col=0;col<d->num_columns;col++)
+			{
+				uint32_t size = data_column_size(d,col);
+				memcpy(data_block_entry(d,d->ib.block,0,col),&grown[(size_t)rows * d->column_offsets[col] + (size_t)r * size],(size_t)run_rows * size);
+			}
+		} else
+		{
+			memcpy(d->ib.block,&grown[(size_t)r * bpr],(size_t)run_rows * bpr);
+		}
+		d->ib.current_relative_row = run_rows;
+
+		if ((err = data_spill_input_block(d)))
+			goto out;
+	}
+	err = 0;
+out:
+	free(grown);
+	return err;
+}
+
+/**
+ * Prepare the data for the next row, i.e., make sure that the input
+ * block has room for at least one more row.
+ *
+ * @param d
+ * @return 0 on success, else an error.
+ */
+int data_insert_row_prolog(data_t* d)
+{
+	int err = -1;
+
+	if (d->map)
+	{
+		fprintf(stderr,"Rows can't be inserted into a frame that maps a binary file\n");
+		goto out;
+	}
+
+	/* The new row may be out of order */
+	d->num_sorted_columns = 0;
+
+	if (!d->ib.block)
+	{
+		uint32_t bytes;
+
+		d->num_bytes_per_row = data_sizeof_row_and_set_column_offsets(d);
+		data_apply_memory_budget(d);
+
+		bytes = d->ib_bytes;
+		if (d->ib_max_rows)
+			bytes = MIN(DATA_INITIAL_BLOCK_BYTES / d->num_bytes_per_row, d->ib_max_rows) * d->num_bytes_per_row;
+		if ((err = data_initialize_block(&d->ib, d, bytes)))
+			goto out;
+	}
+
+	if (d->ib.current_relative_row >= d->ib.num_rows)
+	{
+		if (!d->tmp && d->ib.num_rows < d->ib_max_rows)
+			err = data_grow_input_block(d);
+		else if (d->ib.num_rows > d->ib_bytes / d->num_bytes_per_row)
+			err = data_spill_grown_input_block(d);
+		else
+			err = data_spill_input_block(d);
+		if (err)
+			goto out;
+	}
+	err = 0;
+out:
+	return err;
+}
+
+/**
+ * Stores several consecutive rows in the blocks.
+ *
+ * @param d
+ * @param rows
+ * @param n the number of rows.
+ * @return 0 on success, else an error.
+ */
+static int data_store_rows(data_t *d, const uint8_t *rows, uint32_t n)
+{
+	int err = -1;
+
+	while (n)
+	{
+		uint32_t m;
+
+		if ((err = data_insert_row_prolog(d)))
+			goto out;
+
+		m = MIN(n, d->ib.num_rows - d->ib.current_relative_row);
+		data_block_put_rows(d,d->ib.block,d->ib.current_relative_row,rows,m);
+
+		d->num_rows += m;
+		d->ib.current_relative_row += m;
+		rows += m * d->num_bytes_per_row;
+		n -= m;
+	}
+
+	err = 0;
+out:
+	return err;
+}
+
+/**
+ * Determines whether the rows of the frame are currently aggregated.
+ *
+ * @param d
+ * @return whether the rows are aggregated.
+ */
+static inline int data_is_aggregated(data_t *d)
+{
+	return d->agg.max_rows && !d->agg.expanded;
+}
+
+static inline uint32_t data_aggregate_hash(const uint8_t *row, uint32_t bytes)
+{
+	uint64_t h = UINT64_C(0x9e3779b97f4a7c15) ^ bytes;
+
+	while (bytes)
+	{
+		uint64_t v = 0;
+		uint32_t m = MIN(bytes,sizeof(v));
+
+		memcpy(&v,row,m);
+		h = (h ^ v) * UINT64_C(0xff51afd7ed558ccd);
+		h ^= h >> 32;
+		row += m;
+		bytes -= m;
+	}
+	return (uint32_t)h;
+}
+
+/**
+ * Stores a weight as a value of the given datatype.
+ *
+ * @param dt
+ * @param value where the value is stored.
+ * @param w the weight, which must fit into the datatype.
+ */
+static inline void data_store_weight(enum column_datatype_t dt, uint8_t *value, uint64_t w)
+{
+	if (dt == FLOAT32 || dt == DOUBLE)
+		data_store_double(dt,value,(double)w);
+	else
+		data_store_int32(dt,value,(int32_t)w);
+}
+
+/**
+ * Clears the values of a row that are summed up when the row is aggregated,
+ * see data_set_max_distinct_rows().
+ *
+ * @param d
+ * @param row
+ */
+static inline void data_aggregate_clear_weights(data_t *d, uint8_t *row)
+{
+	if (d->negatives_col >= 0)
+	{
+		memset(&row[d->column_offsets[d->agg.label_col]],0,data_column_size(d,d->agg.label_col));
+		memset(&row[d->column_offsets[d->negatives_col]],0,data_column_size(d,d->negatives_col));
+	} else if (d->weight_col >= 0)
+	{
+		memset(&row[d->column_offsets[d->weight_col]],0,data_column_size(d,d->weight_col));
+	}
+}
+
+/** Number of copies of a row that are stored at once when expanding */
+#define DATA_EXPAND_BATCH_ROWS 4096
+
+/**
+ * Expands the aggregated rows, i.e., stores each distinct row as often
+ * as it has been inserted. The total weights of a distinct row are spread
+ * evenly among its copies, so no copy gets a larger weight than the largest
+ * one of the inserted rows. Afterwards, rows are no longer aggregated.
+ *
+ * @param d
+ * @return 0 on success, else an error.
+ */
+static int data_expand_aggregate(data_t *d)
+{
+	int err = -1;
+	uint32_t bpr = d->num_bytes_per_row;
+	uint32_t num_rows = d->num_rows;
+	uint8_t *batch = NULL;
+	uint32_t i;
+
+	if (!data_is_aggregated(d))
+		return 0;
+
+	d->agg.expanded = 1;
+	d->num_rows = 0;
+
+	if (d->agg.num_rows && !(batch = (uint8_t*)malloc((size_t)DATA_EXPAND_BATCH_ROWS * bpr)))
+		goto out;
+
+	for (i=0;i<d->agg.num_rows;i++)
+	{
+		const uint8_t *row = &d->agg.rows[(size_t)i * bpr];
+		uint64_t count = d->agg.counts[i];
+		uint64_t pos = d->agg.positives ? d->agg.positives[i] : 0;
+		uint64_t neg = d->agg.negatives ? d->agg.negatives[i] : 0;
+		uint64_t c = 0;
+
+		while (c < count)
+		{
+			uint32_t m = MIN(count - c,DATA_EXPAND_BATCH_ROWS);
+			uint32_t j;
+
+			for (j=0;j<m;j++,c++)
+			{
+				uint8_t *r = &batch[(size_t)j * bpr];
+				uint64_t p = pos / count + (c < pos % count);
+				uint64_t n = neg / count + (c < neg % count);
+
+				memcpy(r,row,bpr);
+				if (d->negatives_col >= 0)
+				{
+					data_store_weight(d->column_datatype[d->agg.label_col],&r[d->column_offsets[d->agg.label_col]],p);
+					data_store_weight(d->column_datatype[d->negatives_col],&r[d->column_offsets[d->negatives_col]],n);
+				} else if (d->weight_col >= 0)
+				{
+					/* The label is kept, so either p or n is 0 */
+					data_store_weight(d->column_datatype[d->weight_col],&r[d->column_offsets[d->weight_col]],p + n);
+				}
+			}
+			if ((err = data_store_rows(d,batch,m)))
+				goto out;
+		}
+	}
+	D("Expanded %d distinct rows into %d rows\n",d->agg.num_rows,d->num_rows);
+	err = d->num_rows == num_rows ? 0 : -1;
+out:
+	free(batch);
+	free(d->agg.rows);
+	free(d->agg.counts);
+	free(d->agg.positives);
+	free(d->agg.negatives);
+	free(d->agg.slots);
+	d->agg.rows = NULL;
+	d->agg.counts = NULL;
+	d->agg.positives = NULL;
+	d->agg.negatives = NULL;
+	d->agg.slots = NULL;
+	d->agg.num_rows = 0;
+	return err;
+}
+
+/**
+ * Adds rows to the aggregate until a row would exceed the maximal number
+ * of distinct rows.
+ *
+ * @param aggregated where the number of rows that have been aggregated
+ *  is stored.
+ * @param d
+ * @param rows
+ * @param n
+ * @return 0 on success, else an error.
+ */
+static int data_aggregate_rows(uint32_t *aggregated, data_t *d, const uint8_t *rows, uint32_t n)
+{
+	struct data_aggregate *agg = &d->agg;
+	uint32_t bpr = d->num_bytes_per_row;
+	int wcol = data_weights_col(d);
+	uint8_t key[wcol >= 0 ? bpr : 1];
+	uint32_t i;
+
+	/* Without the label column, the rows can't be weighted */
+	if (agg->label_col >= d->num_columns)
+	{
+		*aggregated = 0;
+		return 0;
+	}
+
+	if (!agg->slots)
+	{
+		agg->num_slots = 16;
+		while (agg->num_slots < agg->max_rows * 2)
+			agg->num_slots *= 2;
+
+		if (!(agg->slots = (uint32_t*)calloc(agg->num_slots,sizeof(agg->slots[0]))))
+			return -1;
+		if (!(agg->rows = (uint8_t*)malloc((size_t)agg->max_rows * bpr)))
+			return -1;
+		if (!(agg->counts = (uint64_t*)malloc(sizeof(agg->counts[0]) * agg->max_rows)))
+			return -1;
+		if (wcol >= 0 && !(agg->positives = (uint64_t*)malloc(sizeof(agg->positives[0]) * agg->max_rows)))
+			return -1;
+		if (wcol >= 0 && !(agg->negatives = (uint64_t*)malloc(sizeof(agg->negatives[0]) * agg->max_rows)))
+			return -1;
+	}
+
+	for (i=0;i<n;i++)
+	{
+		const uint8_t *row = &rows[(size_t)i * bpr];
+		uint32_t mask = agg->num_slots - 1;
+		uint64_t pos = 0, neg = 0;
+		uint32_t h;
+		uint32_t idx;
+
+		/* Unweighted rows keep their label, so their weights follow from their count */
+		if (wcol >= 0)
+		{
+			data_row_weights(d,agg->label_col,&row[d->column_offsets[agg->label_col]],&row[d->column_offsets[wcol]],&pos,&neg);
+			memcpy(key,row,bpr);
+			data_aggregate_clear_weights(d,key);
+			row = key;
+		}
+
+		h = data_aggregate_hash(row,bpr) & mask;
+		while ((idx = agg->slots[h]))
+		{
+			if (!memcmp(&agg->rows[(size_t)(idx - 1) * bpr],row,bpr))
+				break;
+			h = (h + 1) & mask;
+		}
+
+		if (!idx)
+		{
+			if (agg->num_rows == agg->max_rows)
+				break;
+			idx = ++agg->num_rows;
+			memcpy(&agg->rows[(size_t)(idx - 1) * bpr],row,bpr);
+			agg->counts[idx - 1] = 0;
+			if (wcol >= 0)
+				agg->positives[idx - 1] = agg->negatives[idx - 1] = 0;
+			agg->slots[h] = idx;
+		}
+		agg->counts[idx - 1]++;
+		if (wcol >= 0)
+		{
+			agg->positives[idx - 1] += pos;
+			agg->negatives[idx - 1] += neg;
+		}
+		d->num_rows++;
+	}
+	*aggregated = i;
+	return 0;
+}
+
+/**
+ * Insert several consecutive rows.
+ *
+ * @param d
+ * @param rows
+ * @param n the number of rows.
+ * @return 0 on success, else an error.
+ */
+int data_insert_rows(data_t *d, const uint8_t *rows, uint32_t n)
+{
+	int err = -1;
+
+	if (data_is_aggregated(d))
+	{
+		uint32_t aggregated;
+
+		/* Determines the row layout */
+		if ((err = data_insert_row_prolog(d)))
+			goto out;
+		if ((err = data_aggregate_rows(&aggregated,d,rows,n)))
+			goto out;
+		if (aggregated == n)
+			return 0;
+
+		D("More than %d distinct rows, switching to regular storage\n",d->agg.max_rows);
+		if ((err = data_expand_aggregate(d)))
+			goto out;
+		rows += (size_t)aggregated * d->num_bytes_per_row;
+		n -= aggregated;
+	}
+
+	err = data_store_rows(d,rows,n);
+out:
+	return err;
+}
+
+/**
+ * Insert a single row.
+ *
+ * @param d
+ * @param row
+ * @return 0 on success, else an error.
+ */
+int data_insert_row(data_t *d, uint8_t *row)
+{
+	return data_insert_rows(d,row,1);
+}
+
+/**
+ * Insert a single row using a list of variable arguments.
+ *
+ * @param d the data frame in which to insert the row.
+ * @return 0 on success, else an error.
+ */
+int data_insert_row_v(data_t *d, ...)
+{
+	int err = -1;
+	int col;
+	uint8_t *buf;
+
+	va_list vl;
+
+	if (!d->ib.block)
+		d->num_bytes_per_row = data_sizeof_row_and_set_column_offsets(d);
+
+	uint8_t row[d->num_bytes_per_row];
+	buf = row;
+
+	va_start(vl,d);
+
+	for (col=0;col<d->num_columns;col++)
+	{
+		enum column_datatype_t dt = d->column_datatype[col];
+
+		switch (dt)
+		{
+			case	INT8:
+			case	UINT8:
+			case	INT16:
+			case	INT32:
+					/* Narrower integers are promoted to int */
+					data_store_int32(dt,buf,va_arg(vl,int32_t));
+					break;
+
+			case	FLOAT32:
+			case	DOUBLE:
+					data_store_double(dt,buf,va_arg(vl,double));
+					break;
+			default: goto out;
+		}
+		buf += data_datatype_size(dt);
+	}
+
+	err = data_insert_row(d,row);
+out:
+	va_end(vl);
+	return err;
+}
+
+/**
+ * Determines the end of the field that starts at the given position, i.e.,
+ * the position of the next tab or of the terminating newline.
+ *
+ * @param s start of the field
+ * @param line_end position of the newline that terminates the line
+ * @return the end of the field
+ */
+static const char *data_field_end(const char *s, const char *line_end)
+{
+	const char *e;
+
+	if (!(e = memchr(s, '\t', line_end - s)))
+		e = line_end;
+	return e;
+}
+
+/**
+ * Parses a field as 32 bit integer. The field must be followed
+ * by a tab or newline.
+ *
+ * @param out where the value is stored, 0 if the field is empty.
+ * @param s start of the field
+ * @param e end of the field
+ * @return 0 on success, -1 if the value doesn't fit into 32 bits, in which
+ *  case it is truncated.
+ */
+static int data_parse_int32(int32_t *out, const char *s, const char *e)
+{
+	long v;
+
+	while (s < e && *s == ' ')
+		s++;
+	*out = 0;
+	if (s == e)
+		return 0;
+	if (!parse_int32(out,s,e))
+		return 0;
+	/* strtol() stops at the latest at the tab or newline */
+	errno = 0;
+	v = strtol(s, NULL, 10);
+	*out = (int32_t)v;
+	return errno == ERANGE || v < INT32_MIN || v > INT32_MAX ? -1 : 0;
+}
+
+/**
+ * Parses a field as double. The field must be followed
+ * by a tab or newline.
+ *
+ * @param s start of the field
+ * @param e end of the field
+ * @return the value or 0 if the field is empty.
+ */
+static double data_parse_double(const char *s, const char *e)
+{
+	double v;
+
+	while (s < e && *s == ' ')
+		s++;
+	if (s == e)
+		return 0;
+	if (!parse_double(&v,s,e))
+		return v;
+	return strtod(s, NULL);
+}
+
+/**
+ * Parses the given line into a row.
+ *
+ * @param d the data frame whose column layout is used.
+ * @param num_cols the number of columns to parse.
+ * @param proj pairs of input column and frame column ordered by input column.
+ * @param line the line, which must be terminated by a newline.
+ * @param len length of the line including the newline.
+ * @param row where to store the row.
+ * @return 0 on success, else the input column + 1 that couldn't be parsed,
+ *  negated if its value doesn't fit into the narrowed datatype of the column
+ *  or into 32 bits.
+ */
+static int data_parse_line(data_t *d, int num_cols, int (*proj)[2], const char *line, size_t len, uint8_t *row)
+{
+	const char *line_end = line + len - 1;
+	const char *s = line;
+	int input_col = 0;
+	int i;
+
+	for (i=0;i<num_cols;i++)
+	{
+		const char *e;
+		int c = proj[i][0];
+		int fc = proj[i][1];
+
+		/* Skip the columns that are not projected without parsing them */
+		for (;input_col < c;input_col++)
+		{
+			e = data_field_end(s,line_end);
+			s = e < line_end ? e + 1 : e;
+		}
+
+		e = data_field_end(s,line_end);
+
+		switch (d->column_datatype[fc])
+		{
+			case	INT8:
+			case	UINT8:
+			case	INT16:
+			case	INT32:
+					{
+						int32_t v;
+
+						if (data_parse_int32(&v,s,e) || data_store_int32(d->column_datatype[fc],&row[d->column_offsets[fc]],v))
+							return -(c + 1);
+					}
+					break;
+
+			case	FLOAT32:
+			case	DOUBLE:
+					data_store_double(d->column_datatype[fc],&row[d->column_offsets[fc]],data_parse_double(s,e));
+					break;
+
+			default:
+					return c + 1;
+		}
+
+		/* The same input column may be projected more than once */
+		if (i + 1 < num_cols && proj[i+1][0] == c)
+			continue;
+
+		/* Skip the tab, missing fields will be empty */
+		s = e < line_end ? e + 1 : e;
+		input_col++;
+	}
+	return 0;
+}
+
+/** Number of rows that a loader thread parses before inserting them */
+#define DATA_LOAD_BATCH_ROWS 4096
+
+/**
+ * Prepares the split frames of the given frame once the types of its
+ * columns are known, i.e., derives their columns from the ones of the
+ * given frame.
+ *
+ * @param d
+ * @return 0 on success, else an error.
+ */
+static int data_split_init(data_t *d)
+{
+	size_t max_bytes_per_row = 0;
+	int err = -1;
+	int i, j;
+
+	d->num_bytes_per_row = data_sizeof_row_and_set_column_offsets(d);
+	data_apply_memory_budget(d);
+
+	for (i=0;i<d->num_split_frames;i++)
+	{
+		data_t *f = d->split_frames[i];
+		int *cols = &d->split_columns[i * d->num_split_columns];
+
+		if ((err = data_set_number_of_columns(f,d->num_split_columns)))
+			goto out;
+		for (j=0;j<d->num_split_columns;j++)
+			data_set_column_datatype(f,j,d->column_datatype[cols[j]]);
+		f->num_input_columns = d->num_input_columns;
+		f->num_bytes_per_row = data_sizeof_row_and_set_column_offsets(f);
+		max_bytes_per_row = MAX(max_bytes_per_row,f->num_bytes_per_row);
+	}
+
+	err = -1;
+	if (!(d->split_rows = (uint8_t*)malloc(DATA_LOAD_BATCH_ROWS * max_bytes_per_row)))
+		goto out;
+	err = 0;
+out:
+	return err;
+}
+
+/**
+ * Inserts loaded rows into the frame, or distributes them among its split
+ * frames.
+ *
+ * @param d
+ * @param rows
+ * @param n the number of rows, at most DATA_LOAD_BATCH_ROWS.
+ * @return 0 on success, else an error.
+ */
+static int data_load_insert_rows(data_t *d, const uint8_t *rows, uint32_t n)
+{
+	int err = 0;
+	int i, j;
+	uint32_t r;
+
+	if (!d->split_frames)
+		return data_insert_rows(d,rows,n);
+
+	for (i=0;i<d->num_split_frames && !err;i++)
+	{
+		data_t *f = d->split_frames[i];
+		int *cols = &d->split_columns[i * d->num_split_columns];
+
+		for (r=0;r<n;r++)
+		{
+			const uint8_t *src = &rows[r * d->num_bytes_per_row];
+			uint8_t *dest = &d->split_rows[r * f->num_bytes_per_row];
+
+			for (j=0;j<d->num_split_columns;j++)
+				memcpy(&dest[f->column_offsets[j]],&src[d->column_offsets[cols[j]]],data_column_size(d,cols[j]));
+		}
+		err = data_insert_rows(f,d->split_rows,n);
+	}
+	return err;
+}
+
+struct data_load_context
+{
+	data_t *d;
+	int num_cols;
+	int (*proj)[2];
+
+	/** Start and end of the input */
+	const char *begin;
+	const char *end;
+
+	/** The following is protected by the mutex */
+	pthread_mutex_t mutex;
+
+	/** Start of the next chunk that is to be parsed, always at the start of a line */
+	const char *next;
+	int err;
+};
+
+/**
+ * Parses one chunk of the input into batches of rows and inserts them.
+ *
+ * @param ctx
+ * @param start start of the chunk
+ * @param end end of the chunk
+ * @param rows buffer of DATA_LOAD_BATCH_ROWS rows
+ * @return 0 on success, else an error.
+ */
+static int data_load_chunk(struct data_load_context *ctx, const char *start, const char *end, uint8_t *rows)
+{
+	const char *s = start;
+	data_t *d = ctx->d;
+	uint32_t n = 0;
+	int err = 0;
+	int c;
+	char *tail = NULL;
+
+	while (s < end)
+	{
+		const char *nl;
+		const char *line = s;
+		size_t len;
+
+		if ((nl = memchr(s,'\n',end - s)))
+		{
+			len = nl - s + 1;
+		} else
+		{
+			/* The very last line lacks the newline */
+			len = end - s + 1;
+			if (!(tail = (char*)malloc(len)))
+			{
+				err = -1;
+				break;
+			}
+			memcpy(tail,s,len - 1);
+			tail[len - 1] = '\n';
+			line = tail;
+		}
+		s += len;
+
+		if ((c = data_parse_line(d,ctx->num_cols,ctx->proj,line,len,&rows[n * d->num_bytes_per_row])))
+		{
+			if (c < 0)
+			{
+				pthread_mutex_lock(&ctx->mutex);
+				d->load_overflow_col = -c - 1;
+				pthread_mutex_unlock(&ctx->mutex);
+			} else
+			{
+				fprintf(stderr,"Unknown column type\n");
+			}
+			err = -1;
+			break;
+		}
+
+		if (++n == DATA_LOAD_BATCH_ROWS || s >= end)
+		{
+			pthread_mutex_lock(&ctx->mutex);
+			err = data_load_insert_rows(d,rows,n);
+			pthread_mutex_unlock(&ctx->mutex);
+			if (err) break;
+			n = 0;
+		}
+	}
+	if (!err)
+		fio_release_range(ctx->begin,start,end);
+	free(tail);
+	return err;
+}
+
+static void *data_load_thread(void *arg)
+{
+	struct data_load_context *ctx = (struct data_load_context*)arg;
+	uint8_t *rows;
+	int err = 0;
+
+	if (!(rows = (uint8_t*)malloc(DATA_LOAD_BATCH_ROWS * ctx->d->num_bytes_per_row)))
+		err = -1;
+
+	while (!err)
+	{
+		const char *start;
+		const char *end;
+		const char *nl;
+		size_t chunk_bytes = ctx->d->parse_chunk_bytes;
+
+		/* Chunks are determined on demand, so only the parts of the
+		 * input that are currently parsed need to be resident */
+		pthread_mutex_lock(&ctx->mutex);
+		start = ctx->next;
+		if ((size_t)(ctx->end - start) <= chunk_bytes)
+			end = ctx->end;
+		else if ((nl = memchr(start + chunk_bytes, '\n', ctx->end - start - chunk_bytes)))
+			end = nl + 1;
+		else
+			end = ctx->end;
+		ctx->next = end;
+		err = ctx->err;
+		pthread_mutex_unlock(&ctx->mutex);
+
+		if (err || start == end)
+			break;
+
+		err = data_load_chunk(ctx,start,end,rows);
+	}
+
+	if (err)
+	{
+		pthread_mutex_lock(&ctx->mutex);
+		ctx->err = err;
+		pthread_mutex_unlock(&ctx->mutex);
+	}
+	free(rows);
+	return NULL;
+}
+
+/**
+ * Parses the lines in the given memory range concurrently and inserts the
+ * resulting rows into the data frame. The order of the rows within the frame
+ * is not defined.
+ *
+ * @param d
+ * @param num_cols
+ * @param proj
+ * @param start
+ * @param end
+ * @return 0 on success, else an error.
+ */
+static int data_load_parallel(data_t *d, int num_cols, int (*proj)[2], const char *start, const char *end)
+{
+	struct data_load_context ctx;
+	pthread_t *threads = NULL;
+	int num_threads = 0;
+	size_t num_chunks;
+	int err = -1;
+	int i;
+
+	memset(&ctx,0,sizeof(ctx));
+	ctx.d = d;
+	ctx.num_cols = num_cols;
+	ctx.proj = proj;
+
+	/* Make sure that the row layout is determined before the threads start */
+	if (!d->ib.block && !d->split_frames)
+	{
+		if ((err = data_insert_row_prolog(d)))
+			goto out;
+		err = -1;
+	}
+
+	ctx.begin = start;
+	ctx.next = start;
+	ctx.end = end;
+	num_chunks = (end - start) / d->parse_chunk_bytes + 1;
+
+	if (!(threads = (pthread_t*)malloc(sizeof(threads[0]) * d->num_threads)))
+		goto out;
+
+	pthread_mutex_init(&ctx.mutex,NULL);
+
+	for (i=0;i<MIN(d->num_threads,num_chunks);i++)
+	{
+		if (pthread_create(&threads[i],NULL,data_load_thread,&ctx))
+			break;
+		num_threads++;
+	}
+
+	/* Make sure progress happens even if no thread could be created */
+	if (!num_threads)
+		data_load_thread(&ctx);
+
+	for (i=0;i<num_threads;i++)
+		pthread_join(threads[i],NULL);
+
+	pthread_mutex_destroy(&ctx.mutex);
+	err = ctx.err;
+out:
+	free(threads);
+	return err;
+}
+
+/**
+ * Comparison function for sorting projected columns by their input column.
+ */
+static int data_projection_compare(const void *a, const void *b)
+{
+	const int *pa = (const int*)a;
+	const int *pb = (const int*)b;
+
+	if (pa[0] != pb[0]) return pa[0] - pb[0];
+	return pa[1] - pb[1];
+}
+
+/** Number of lines spread over a mapped input that are sampled in addition to the first lines */
+#define DATA_LOAD_SAMPLE_LINES 64
+
+/**
+ * Extends the ranges of the integer input columns by the values of a line.
+ * Columns with values beyond 32 bits are changed to DOUBLE.
+ *
+ * @param line the line, which must be terminated by a newline.
+ * @param len length of the line including the newline.
+ * @param column_types the datatypes of the input columns.
+ * @param last_input_col the last input column that is sampled.
+ * @param ranges the smallest and the largest value of each input column.
+ */
+static void data_sample_line(const char *line, size_t len, enum column_datatype_t *column_types, int last_input_col, int32_t (*ranges)[2])
+{
+	const char *line_end = line + len - 1;
+	const char *s = line;
+	int col;
+
+	for (col=0;col<=last_input_col;col++)
+	{
+		const char *e = data_field_end(s,line_end);
+		int32_t v;
+
+		if (column_types[col] == INT32 && data_parse_int32(&v,s,e))
+			column_types[col] = DOUBLE;
+		else if (column_types[col] == INT32)
+		{
+			ranges[col][0] = MIN(ranges[col][0],v);
+			ranges[col][1] = MAX(ranges[col][1],v);
+		}
+		s = e < line_end ? e + 1 : e;
+	}
+}
+
+/**
+ * Returns the narrowest integer datatype that holds the given range.
+ *
+ * @param min
+ * @param max
+ * @return the datatype.
+ */
+static enum column_datatype_t data_narrowest_integer(int32_t min, int32_t max)
+{
+	if (min >= INT8_MIN && max <= INT8_MAX) return INT8;
+	if (min >= 0 && max <= UINT8_MAX) return UINT8;
+	if (min >= INT16_MIN && max <= INT16_MAX) return INT16;
+	return INT32;
+}
+
+/**
+ * Narrows the datatypes of the input columns, see data_set_narrow_integers()
+ * and data_set_float32(). The ranges of the integer columns are sampled from
+ * the first lines and, if the input is mapped, from lines that are spread
+ * over the entire input.
+ *
+ * @param d
+ * @param fio
+ * @param first_data_line index of the first line of fio that isn't a header.
+ * @param column_types the datatypes of the input columns, which are narrowed.
+ * @param last_input_col the last input column that is loaded.
+ * @param wide input columns that are to be kept at INT32.
+ * @param num_wide
+ * @return 0 on success, else an error.
+ */
+static int data_narrow_column_types(data_t *d, struct fio *fio, int first_data_line, enum column_datatype_t *column_types, int last_input_col, const int *wide, int num_wide)
+{
+	int32_t (*ranges)[2];
+	const char *line;
+	int i, ln;
+
+	if (d->float32)
+	{
+		for (i=0;i<=last_input_col;i++)
+		{
+			if (column_types[i] == DOUBLE)
+				column_types[i] = FLOAT32;
+		}
+	}
+
+	/* An overflow is only dealt with by loading the input again */
+	if (!d->narrow_integers || !fio->map || !fio->fd_was_opened)
+		return 0;
+
+	if (!(ranges = (int32_t(*)[2])malloc(sizeof(ranges[0]) * (last_input_col + 1))))
+		return -1;
+	for (i=0;i<=last_input_col;i++)
+	{
+		ranges[i][0] = INT32_MAX;
+		ranges[i][1] = INT32_MIN;
+	}
+
+	for (ln = first_data_line; ln < FIO_FIRST_LINES && ((line = fio->first_lines[ln])); ln++)
+		data_sample_line(line,fio->first_lines_len[ln],column_types,last_input_col,ranges);
+
+	line = fio->first_lines[first_data_line];
+	if (line && line >= fio->map && line < fio->map + fio->map_size)
+	{
+		const char *end = fio->map + fio->map_size;
+		size_t bytes = end - line;
+
+		for (i=1;i<DATA_LOAD_SAMPLE_LINES;i++)
+		{
+			const char *p = line + bytes / DATA_LOAD_SAMPLE_LINES * i;
+			const char *start, *nl;
+
+			/* The sampled line is the one that follows p */
+			if (!(start = memchr(p,'\n',end - p)) || ++start >= end)
+				break;
+			if (!(nl = memchr(start,'\n',end - start)))
+				break;
+			data_sample_line(start,nl - start + 1,column_types,last_input_col,ranges);
+		}
+
+		/* The samples would otherwise stay resident until they are parsed */
+		fio_release_range(fio->map,line,end);
+	}
+
+	for (i=0;i<=last_input_col;i++)
+	{
+		int j;
+
+		for (j=0;j<num_wide && wide[j] != i;j++);
+		if (column_types[i] == INT32 && j == num_wide && ranges[i][0] <= ranges[i][1])
+			column_types[i] = data_narrowest_integer(ranges[i][0],ranges[i][1]);
+	}
+	free(ranges);
+	return 0;
+}
+
+/**
+ * Loads from the given file the given columns into an already
+ * created (vanilla) data frame.
+ *
+ * @param d the result as returned by data_create().
+ * @param filename the file from which to read
+ * @param num_cols number of columns to load or 0 for all columns.
+ * @param cols the input columns that constitute the columns of the frame.
+ * @param wide input columns that aren't narrowed, those that are listed
+ *  more than once are loaded as DOUBLE.
+ * @param num_wide
+ * @return 0 on success, else an error. If a value doesn't fit into the
+ *  narrowed datatype of its column, the column is stored in
+ *  d->load_overflow_col.
+ */
+static int data_load_from_ascii_attempt(data_t *d, const char *filename, int num_cols, const int *cols, const int *wide, int num_wide)
+{
+	int i;
+	int err = -1;
+	struct fio fio;
+	int pro_header = 0;
+	int con_header = 0;
+	int ncols = 1;
+	enum column_datatype_t *column_types = NULL;
+	uint8_t *row = NULL;
+
+	/* Pairs of input column and frame column, ordered by input column */
+	int (*proj)[2] = NULL;
+	int last_input_col;
+
+	size_t len;
+	const char *line;
+	int linenr = 1; /* 1-based */
+	int first_data_line = 0;
+
+	if ((err = fio_init_by_file(&fio,filename)))
+	{
+		fprintf(stderr,"Couldn't open \"%s\"\n",filename);
+		goto out;
+	}
+
+	if (!(line = fio.first_lines[0]))
+	{
+		fprintf(stderr,"\"%s\" is empty\n",filename);
+		err = -1;
+		goto out;
+	}
+	len = fio.first_lines_len[0];
+
+	/* Guess, if this is a header, also determine number of columns */
+	for (i=0;i<len-1;i++)
+	{
+		if (line[i] == '\t')
+			ncols++;
+		else
+		{
+			if (line[i] == '-' || line[i] == 'e' || line[i] == 'E' || line[i] == '.' || isdigit((int)line[i]))
+			{
+				pro_header++;
+				con_header++;
+			} else
+			{
+				pro_header++;
+			}
+		}
+	}
+
+	if (pro_header > con_header)
+	{
+		first_data_line = 1;
+		if ((err = fio_read_next_line(&line,&len,&fio)))
+			goto out;
+	}
+	else
+		first_data_line = 0;
+
+	err = -1;
+	d->num_input_columns = ncols;
+
+	if (!num_cols)
+		num_cols = ncols;
+
+	if (!(proj = malloc(sizeof(proj[0]) * num_cols)))
+		goto out;
+
+	for (i=0;i<num_cols;i++)
+	{
+		int c = cols?cols[i]:i;
+		if (c < 0 || c >= ncols)
+		{
+			fprintf(stderr,"Column %d is out of bounds, \"%s\" has %d columns\n",c,filename,ncols);
+			goto out;
+		}
+		proj[i][0] = c;
+		proj[i][1] = i;
+	}
+	qsort(proj,num_cols,sizeof(proj[0]),data_projection_compare);
+	last_input_col = proj[num_cols-1][0];
+
+	/* Determine columns */
+	int ln;
+
+	if (!(column_types = (enum column_datatype_t*)calloc(ncols,sizeof(column_types[0]))))
+		goto out;
+
+	for (ln = first_data_line; ln < FIO_FIRST_LINES && ((line = fio.first_lines[ln])); ln++)
+	{
+		int is_double = 0;
+		int col = 0;
+		len = fio.first_lines_len[ln];
+
+		for (i=0;i<len && col<=last_input_col;i++)
+		{
+			if (line[i] == '\t' || line[i] == '\n')
+			{
+				enum column_datatype_t newt = INT32;
+				if (is_double) newt = DOUBLE;
+
+				if (column_types[col] == UNKNOWN || newt == DOUBLE)
+					column_types[col] = newt;
+
+				col++;
+				is_double = 0;
+			} else
+			{
+				if (line[i] == '-' || line[i] == 'e' || line[i] == 'E' || line[i] == '.')
+					is_double = 1;
+			}
+		}
+	}
+
+	/* A column that overflows although it isn't narrowed holds integers beyond 32 bits */
+	for (i=1;i<num_wide;i++)
+	{
+		int j;
+
+		for (j=0;j<i && wide[j] != wide[i];j++);
+		if (j < i && column_types[wide[i]] == INT32)
+			column_types[wide[i]] = DOUBLE;
+	}
+
+	if ((err = data_narrow_column_types(d,&fio,first_data_line,column_types,last_input_col,wide,num_wide)))
+		goto out;
+
+	if ((err = data_set_number_of_columns(d,num_cols)))
+		goto out;
+
+	for (i=0;i<num_cols;i++)
+		data_set_column_datatype(d,proj[i][1],column_types[proj[i][0]]);
+
+	if (d->split_frames && (err = data_split_init(d)))
+		goto out;
+
+	err = -1;
+	if (!(row = (uint8_t*)malloc(data_sizeof_row_and_set_column_offsets(d))))
+		goto out;
+
+	linenr = first_data_line;
+
+	D("Identified %d columns, loading %d of them\n",ncols,num_cols);
+
+	line = fio.first_lines[first_data_line];
+	if (d->num_threads > 1 && fio.map && line && line >= fio.map && line < fio.map + fio.map_size)
+	{
+		/* The remaining input is mapped, so it can be divided among threads */
+		if ((err = data_load_parallel(d,num_cols,proj,line,fio.map + fio.map_size)))
+			goto out;
+	} else
+	{
+		while (!(err = fio_read_next_line(&line,&len,&fio)))
+		{
+			int c;
+
+			linenr++;
+
+			if ((c = data_parse_line(d,num_cols,proj,line,len,row)))
+			{
+				/* Only files can be read again with a wider column */
+				if (c < 0 && !fio.fd_was_opened)
+					fprintf(stderr,"Integer at line %d in column %d exceeds 32 bits\n",linenr,-c - 1);
+				else if (c < 0)
+					d->load_overflow_col = -c - 1;
+				else
+					fprintf(stderr,"Unknown column type at line %d in column %d\n",linenr,c - 1);
+				err = -1;
+				goto out;
+			}
+
+			if ((err = data_load_insert_rows(d,row,1)))
+				goto out;
+		}
+	}
+
+	err = 0;
+out:
+	free(proj);
+	free(column_types);
+	free(row);
+	fio_deinit(&fio);
+	return err;
+}
+
+/**
+ * Removes the rows and the columns of a frame, so that it can be loaded
+ * again. The settings of the frame are kept.
+ *
+ * @param d
+ */
+static void data_clear(data_t *d)
+{
+	uint32_t max_rows = d->agg.max_rows;
+	int label_col = d->agg.label_col;
+
+	if (d->tmp)
+	{
+		data_spill_forget(d,fileno(d->tmp));
+		fclose(d->tmp);
+		d->tmp = NULL;
+	}
+
+	free(d->column_datatype);
+	free(d->column_offsets);
+	d->column_datatype = NULL;
+	d->column_offsets = NULL;
+	d->num_columns = 0;
+	d->num_bytes_per_row = 0;
+	d->num_rows = 0;
+	d->num_sorted_columns = 0;
+
+	free(d->ib.block);
+	memset(&d->ib,0,sizeof(d->ib));
+
+	free(d->agg.rows);
+	free(d->agg.counts);
+	free(d->agg.positives);
+	free(d->agg.negatives);
+	free(d->agg.slots);
+	memset(&d->agg,0,sizeof(d->agg));
+	d->agg.max_rows = max_rows;
+	d->agg.label_col = label_col;
+
+	d->presorted_rows = 0;
+	d->presorted_positives = 0;
+	d->presorted_negatives = 0;
+	data_groups_free(&d->presorted_groups);
+
+	free(d->split_rows);
+	d->split_rows = NULL;
+}
+
+/**
+ * Loads from the given file the given columns into an already
+ * created (vanilla) data frame. Should a value not fit into the narrowed
+ * datatype of its column, the frame is cleared and the input is loaded
+ * again with that column widened to INT32. Should it not fit into 32 bits,
+ * the column is widened to DOUBLE, which holds integers of up to 53 bits
+ * exactly.
+ *
+ * @param d the result as returned by data_create().
+ * @param filename the file from which to read
+ * @param num_cols number of columns to load or 0 for all columns.
+ * @param cols the input columns that constitute the columns of the frame.
+ * @return 0 on success, else an error.
+ */
+static int data_load_from_ascii_cols(data_t *d, const char *filename, int num_cols, const int *cols)
+{
+	int *wide = NULL;
+	int num_wide = 0;
+	int err;
+	int i;
+
+	for (;;)
+	{
+		int *w;
+		int beyond_32_bits = 0;
+
+		d->load_overflow_col = -1;
+		if (!(err = data_load_from_ascii_attempt(d,filename,num_cols,cols,wide,num_wide)) || d->load_overflow_col < 0)
+			break;
+
+		D("Column %d doesn't fit into its datatype, loading again\n",d->load_overflow_col);
+
+		/* A column that overflows as INT32 is listed twice, so it becomes DOUBLE */
+		for (i=0;i<d->num_columns;i++)
+		{
+			if ((cols ? cols[i] : i) == d->load_overflow_col && d->column_datatype[i] == INT32)
+				beyond_32_bits = 1;
+		}
+
+		if (!(w = (int*)realloc(wide,sizeof(wide[0]) * (num_wide + 2))))
+			break;
+		wide = w;
+		wide[num_wide++] = d->load_overflow_col;
+		if (beyond_32_bits)
+			wide[num_wide++] = d->load_overflow_col;
+
+		data_clear(d);
+		for (i=0;i<d->num_split_frames;i++)
+			data_clear(d->split_frames[i]);
+	}
+	free(wide);
+	return err;
+}
+
+/**
+ * Loads the given columns from the given file into several already
+ * created (vanilla) data frames at once, so the input is parsed only
+ * once. Column j of frame i will contain the values of input column
+ * cols[i * num_cols + j]. The frames may share input columns, e.g.,
+ * the label.
+ *
+ * @param frames the frames as returned by data_create().
+ * @param num_frames the number of frames
+ * @param filename the file from which to read
+ * @param num_cols the number of columns of each frame
+ * @param cols the (0-based) input columns of the frames
+ * @return 0 on success, else an error.
+ */
+int data_load_from_ascii_split(data_t **frames, int num_frames, const char *filename, int num_cols, const int *cols)
+{
+	data_t *d = NULL;
+	int *input_cols = NULL;
+	int num_input_cols = 0;
+	int err = -1;
+	int i, j;
+
+	if (num_frames <= 0 || num_cols <= 0)
+		return -1;
+
+	if ((err = data_create(&d)))
+		goto out;
+	err = -1;
+
+	if (!(input_cols = (int*)malloc(sizeof(input_cols[0]) * num_frames * num_cols)))
+		goto out;
+	if (!(d->split_columns = (int*)malloc(sizeof(d->split_columns[0]) * num_frames * num_cols)))
+		goto out;
+
+	/* The loaded frame consists of the distinct input columns */
+	for (i=0;i<num_frames * num_cols;i++)
+	{
+		for (j=0;j<num_input_cols && input_cols[j] != cols[i];j++);
+		if (j == num_input_cols)
+			input_cols[num_input_cols++] = cols[i];
+		d->split_columns[i] = j;
+	}
+
+	d->split_frames = frames;
+	d->num_split_frames = num_frames;
+	d->num_split_columns = num_cols;
+	d->num_threads = frames[0]->num_threads;
+	d->narrow_integers = frames[0]->narrow_integers;
+	d->float32 = frames[0]->float32;
+	for (i=0;i<num_frames;i++)
+		d->memory_budget += frames[i]->memory_budget;
+
+	err = data_load_from_ascii_cols(d,filename,num_input_cols,input_cols);
+out:
+	free(input_cols);
+	data_free(d);
+	return err;
+}
+
+/**
+ * Loads from the given file a data frame in to an already
+ * created (vanilla) data frame.
+ *
+ * @param d the result as returned by data_create().
+ * @param filename the file from which to read
+ * @return 0 on success, else an error.
+ */
+int data_load_from_ascii(data_t *d, const char *filename)
+{
+	return data_load_from_ascii_cols(d,filename,0,NULL);
+}
+
+/**
+ * Loads only the given columns from the given file into an already
+ * created (vanilla) data frame. Column i of the frame will contain
+ * the values of input column cols[i]. All other input columns are
+ * skipped without being converted or stored.
+ *
+ * @param d the result as returned by data_create().
+ * @param filename the file from which to read
+ * @param num_cols the number of columns to load
+ * @param cols the (0-based) input columns to load
+ * @return 0 on success, else an error.
+ */
+int data_load_from_ascii_projected(data_t *d, const char *filename, int num_cols, const int *cols)
+{
+	if (num_cols <= 0)
+		return -1;
+	return data_load_from_ascii_cols(d,filename,num_cols,cols);
+}
+
+/**
+ * Returns the number of columns of the data frame.
+ *
+ * @param d the data frame in question
+ * @return the number of columns
+ */
+uint32_t data_get_number_of_columns(data_t *d)
+{
+	return d->num_columns;
+}
+
+/**
+ * Returns the number of columns of the input from which the data
+ * frame was loaded. This differs from the number of columns of the
+ * frame, if only some columns were loaded.
+ *
+ * @param d the data frame in question
+ * @return the number of input columns
+ */
+uint32_t data_get_number_of_input_columns(data_t *d)
+{
+	return d->num_input_columns;
+}
+
+/**
+ * Returns how often merges switched to the read-ahead buffer of a run
+ * and how often they had to wait for it to be filled.
+ *
+ * @param d
+ * @param refills where to store the number of buffer switches.
+ * @param waits where to store the number of waits.
+ */
+void data_get_merge_io_stats(data_t *d, uint64_t *refills, uint64_t *waits)
+{
+	*refills = d->merge_refills;
+	*waits = d->merge_waits;
+}
+
+/**
+ * Returns the number of rows of the data frame.
+ *
+ * @param d the data frame in question
+ * @return the number of rows
+ */
+uint32_t data_get_number_of_rows(data_t *d)
+{
+	return d->num_rows;
+}
+
+/**
+ * Returns whether the rows of the data frame are currently held as
+ * distinct rows with counts, see data_set_max_distinct_rows().
+ *
+ * @param d the data frame in question
+ * @return whether the rows are aggregated
+ */
+int data_has_aggregated_rows(data_t *d)
+{
+	return data_is_aggregated(d);
+}
+
+
+/**
+ * Read the block starting at row from the given file.
+ *
+ * @param d the data frame associated with the block
+ * @param f the file to read from
+ * @param b the block where to store the result of the read operation.
+ * @param row the index of the row.
+ * @return 0 on success, else an error.
+ */
+static int data_read_block_from_file(data_t *d, FILE *f, block_t *b, uint32_t row)
+{
+	int err = -1;
+
+	if (d->spill_compression)
+	{
+		if (row < d->num_rows && data_spill_pread(d,fileno(f),b->block,0,row,MIN(b->num_rows,d->num_rows - row)))
+			goto out;
+		b->row_offset = row;
+		err = 0;
+		goto out;
+	}
+
+	if (fseeko(f, (off_t)row * d->num_bytes_per_row, SEEK_SET))
+	{
+		fprintf(stderr,"Seek failed\n");
+		goto out;
+	}
+	D("Reading from %llx (offset %d)\n", (unsigned long long)ftello(f), row);
+	if (fread(b->block, d->num_bytes_per_row, b->num_rows, f) == 0)
+	{
+		fprintf(stderr,"Reading row %d failed!\n",row);
+		goto out;
+	}
+	b->row_offset = row;
+	err = 0;
+out:
+	return err;
+
+}
+
+/**
+ * Read the block starting at row in the block.
+ *
+ * @param d the data frame associated with the block
+ * @param b the block where to store the result of the read operation.
+ * @param row the index of the row.
+ * @return 0 on success, else an error.
+ */
+static int data_read_block_for_row(data_t *d, block_t *b, int row)
+{
+	return data_read_block_from_file(d, d->tmp, b, row);
+}
+
+/**
+ * Read the contents of the given row to the input block.
+ *
+ * @param d the associated data frame.
+ * @param row
+ * @return 0 on success, else an error.
+ */
+static int data_read_input_block_for_row(data_t *d, int row)
+{
+	int err = -1;
+	uint32_t new_row_offset_of_block;
+
+	new_row_offset_of_block = (row / d->ib.num_rows) * d->ib.num_rows;
+	if (new_row_offset_of_block != d->ib.row_offset)
+	{
+		data_write_input_block(d);
+		if ((err = data_read_block_for_row(d, &d->ib, new_row_offset_of_block)))
+			goto out;
+	}
+	err = 0;
+out:
+	return err;
+}
+
+/**
+ * Determine the pointer to the given column/row. May read the associated
+ * block if the element is currently not in the input block.
+ *
+ * @param out where to store the pointer.
+ * @param d the associatated data frame.
+ * @param i the row
+ * @param j the column
+ * @return 0 on success, else an error.
+ */
+static int data_get_buf_ptr(uint8_t **out, data_t *d, int i, int j)
+{
+	int err = -1;
+	uint8_t *buf;
+
+	if ((err = data_expand_aggregate(d)))
+		goto out;
+
+	if (i < d->ib.row_offset || i >= d->ib.row_offset + d->ib.num_rows)
+	{
+		if ((err = data_read_input_block_for_row(d,i)))
+		{
+			fprintf(stderr,"Couldn't read block %d\n",errno);
+			goto out;
+		}
+	}
+
+	buf = data_block_entry(d, d->ib.block, i - d->ib.row_offset, j);
+	*out = buf;
+	err = 0;
+out:
+	return err;
+}
+
+/**
+ * Determine the values of a column for a range of rows starting at the
+ * given row. The range ends at the end of the block that contains the row,
+ * which may be read. The values are valid until the next access to a
+ * row of another block.
+ *
+ * @param values where to store the pointer to the value of the first row.
+ * @param stride where to store the distance in bytes between the values
+ *  of two consecutive rows.
+ * @param count where to store the number of rows in the range.
+ * @param d the associated data frame.
+ * @param i the first row
+ * @param j the column
+ * @return 0 on success, else an error.
+ */
+static int data_get_column_values(const uint8_t **values, size_t *stride, uint32_t *count, data_t *d, uint32_t i, int j)
+{
+	int err = -1;
+	uint8_t *buf;
+
+	if ((err = data_get_buf_ptr(&buf, d, i, j)))
+		goto out;
+
+	*values = buf;
+	*stride = data_column_stride(d, j);
+	*count = MIN(d->ib.row_offset + d->ib.num_rows, d->num_rows) - i;
+	err = 0;
+out:
+	return err;
+}
+
+int data_get_entry_as_double(double *out, data_t *d, int i, int j)
+{
+	uint8_t *buf;
+	data_get_buf_ptr(&buf,d,i,j);
+	*out = data_value_double(d->column_datatype[j],buf);
+	return 0;
+}
+
+int data_get_entry_as_int32(int32_t *out, data_t *d, int i, int j)
+{
+	uint8_t *buf;
+	data_get_buf_ptr(&buf,d,i,j);
+	if (d->column_datatype[j] == FLOAT32 || d->column_datatype[j] == DOUBLE)
+		*out = (int32_t)data_value_double(d->column_datatype[j],buf);
+	else
+		*out = data_value_int32(d->column_datatype[j],buf);
+	return 0;
+}
+
+static int data_sort_compare_cb(const void *a, const void *b, void *data)
+{
+	int c;
+	data_t *d = (data_t*)data;
+	const uint8_t *ra = (const uint8_t*)a;
+	const uint8_t *rb = (const uint8_t*)b;
+
+	for (c=0;c<d->num_to_sort_columns;c++)
+	{
+		int rc;
+
+		int col = d->to_sort_columns[c];
+		int offset = d->column_offsets[abs(col)];
+		enum column_datatype_t dt = d->column_datatype[abs(col)];
+
+		if (dt == INT32)
+		{
+			int32_t ia = *(int32_t*)(&ra[offset]);
+			int32_t ib = *(int32_t*)(&rb[offset]);
+
+			if (ia > ib) rc = 1;
+			else if (ia < ib) rc = -1;
+			else continue;
+		} else if (dt == DOUBLE)
+		{
+			double da = *(double*)(&ra[offset]);
+			double db = *(double*)(&rb[offset]);
+
+			if (da > db) rc = 1;
+			else if (da < db) rc = -1;
+			else continue;
+		} else
+		{
+			double da = data_value_double(dt,&ra[offset]);
+			double db = data_value_double(dt,&rb[offset]);
+
+			if (da > db) rc = 1;
+			else if (da < db) rc = -1;
+			else continue;
+		}
+
+		if (col < 0)
+			rc *= -1;
+
+		return rc;
+	}
+	return 0;
+}
+
+/** Blocks with fewer rows are sorted using the comparator */
+#define DATA_RADIX_SORT_MIN_ROWS 256
+
+/** Part of a normalized sort key, which corresponds to one sort column */
+struct sort_key_part
+{
+	/** Location of the value of the first row within a block */
+	size_t offset;
+
+	/** Distance between the values of consecutive rows */
+	size_t stride;
+
+	enum column_datatype_t datatype;
+	int bits;
+	int descending;
+};
+
+/**
+ * Determines how the sort columns are encoded into unsigned 64 bit keys
+ * whose natural order is the order of the rows. Consecutive columns share
+ * a key as long as they fit into 64 bits, see data_sort_key_segment().
+ *
+ * @param d
+ * @param parts where to store the parts of the keys, one for each sort column.
+ * @return 0 if the sort columns can be encoded, else -1.
+ */
+static int data_sort_key_parts(data_t *d, struct sort_key_part *parts)
+{
+	int c;
+
+	for (c=0;c<d->num_to_sort_columns;c++)
+	{
+		int col = d->to_sort_columns[c];
+
+		parts[c].offset = d->column_offsets[abs(col)];
+		if (d->layout == LAYOUT_COLUMNS)
+			parts[c].offset *= d->ib.num_rows;
+		parts[c].stride = data_column_stride(d,abs(col));
+		parts[c].datatype = d->column_datatype[abs(col)];
+		parts[c].descending = col < 0;
+
+		if (!(parts[c].bits = data_datatype_size(parts[c].datatype) * 8))
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * Determines the first part of the key that ends before the given part,
+ * i.e., the least significant key of the remaining parts.
+ *
+ * @param parts
+ * @param end the part after the last one of the key.
+ * @return the first part of the key.
+ */
+static int data_sort_key_segment(const struct sort_key_part *parts, int end)
+{
+	int start = end - 1;
+	int bits = parts[start].bits;
+
+	while (start > 0 && bits + parts[start - 1].bits <= 64)
+		bits += parts[--start].bits;
+	return start;
+}
+
+/**
+ * Encodes the sort key of the given row of a block.
+ *
+ * @param parts as determined by data_sort_key_parts()
+ * @param num_parts
+ * @param block
+ * @param r
+ * @return the key
+ */
+static inline uint64_t data_sort_key(const struct sort_key_part *parts, int num_parts, const uint8_t *block, uint32_t r)
+{
+	uint64_t key = 0;
+	int c;
+
+	for (c=0;c<num_parts;c++)
+	{
+		const uint8_t *value = &block[parts[c].offset + r * parts[c].stride];
+		uint64_t k;
+
+		if (parts[c].datatype == INT32)
+		{
+			uint32_t v;
+			memcpy(&v,value,sizeof(v));
+			k = v ^ UINT32_C(0x80000000);
+			if (parts[c].descending) k ^= UINT32_C(0xffffffff);
+		} else if (parts[c].datatype == DOUBLE)
+		{
+			uint64_t v;
+			memcpy(&v,value,sizeof(v));
+			/* Negative numbers have their order reversed */
+			if (v >> 63) k = ~v;
+			else k = v ^ (UINT64_C(1) << 63);
+			if (parts[c].descending) k = ~k;
+		} else
+		{
+			k = data_value_key(parts[c].datatype,value);
+			if (parts[c].descending) k ^= (UINT64_C(1) << parts[c].bits) - 1;
+		}
+
+		key = parts[c].bits == 64 ? k : (key << parts[c].bits) | k;
+	}
+	return key;
+}
+
+/**
+ * Sorts the keys and the accompanying row indices by means of an LSD
+ * radix sort. Passes on bytes that are equal for all keys are skipped.
+ *
+ * @param keys
+ * @param idx
+ * @param tmp_keys scratch space for n keys
+ * @param tmp_idx scratch space for n indices
+ * @param n
+ * @return pointer to the sorted indices, which is either idx or tmp_idx.
+ */
+static uint32_t *data_radix_sort_keys(uint64_t *keys, uint32_t *idx, uint64_t *tmp_keys, uint32_t *tmp_idx, uint32_t n)
+{
+	uint32_t counts[8][256];
+	uint32_t i;
+	int pass;
+
+	memset(counts,0,sizeof(counts));
+	for (i=0;i<n;i++)
+	{
+		uint64_t k = keys[i];
+		for (pass=0;pass<8;pass++)
+			counts[pass][(k >> (pass * 8)) & 0xff]++;
+	}
+
+	for (pass=0;pass<8;pass++)
+	{
+		uint32_t offsets[256];
+		uint32_t sum = 0;
+		int shift = pass * 8;
+		int b;
+
+		if (counts[pass][(keys[0] >> shift) & 0xff] == n)
+			continue;
+
+		for (b=0;b<256;b++)
+		{
+			offsets[b] = sum;
+			sum += counts[pass][b];
+		}
+
+		for (i=0;i<n;i++)
+		{
+			uint32_t o = offsets[(keys[i] >> shift) & 0xff]++;
+			tmp_keys[o] = keys[i];
+			tmp_idx[o] = idx[i];
+		}
+
+		{
+			uint64_t *t = keys; keys = tmp_keys; tmp_keys = t;
+		}
+		{
+			uint32_t *t = idx; idx = tmp_idx; tmp_idx = t;
+		}
+	}
+	return idx;
+}
+
+/**
+ * Sorts the rows of the given block in place according to the sort
+ * columns by means of LSD radix sorts. If the sort columns don't fit into
+ * a single key, the rows are sorted by the least significant key first,
+ * which works as the radix sort is stable. The comparator is used for
+ * small blocks.
+ *
+ * @param d
+ * @param block
+ * @param n the number of rows
+ * @return 0 on success, else an error.
+ */
+static int data_sort_block(data_t *d, uint8_t *block, uint32_t n)
+{
+	int err = -1;
+	struct sort_key_part parts[d->num_to_sort_columns];
+	uint64_t *keys = NULL;
+	uint32_t *idx = NULL;
+	uint32_t *sorted_idx;
+	uint32_t *tmp_idx;
+	uint8_t *sorted = NULL;
+	int end;
+	uint32_t bpr = d->num_bytes_per_row;
+	uint32_t i;
+	int col;
+
+	if (!(sorted = (uint8_t*)malloc((size_t)n * bpr)))
+		goto fallback;
+
+	if (n < DATA_RADIX_SORT_MIN_ROWS || data_sort_key_parts(d,parts))
+		goto fallback;
+
+	if (!(keys = (uint64_t*)malloc(sizeof(keys[0]) * n * 2)))
+		goto fallback;
+	if (!(idx = (uint32_t*)malloc(sizeof(idx[0]) * n * 2)))
+		goto fallback;
+
+	sorted_idx = idx;
+	tmp_idx = &idx[n];
+	for (i=0;i<n;i++)
+		idx[i] = i;
+
+	for (end=d->num_to_sort_columns;end>0;)
+	{
+		int start = data_sort_key_segment(parts,end);
+		uint32_t *r;
+
+		for (i=0;i<n;i++)
+			keys[i] = data_sort_key(&parts[start],end - start,block,sorted_idx[i]);
+
+		if ((r = data_radix_sort_keys(keys,sorted_idx,&keys[n],tmp_idx,n)) != sorted_idx)
+		{
+			tmp_idx = sorted_idx;
+			sorted_idx = r;
+		}
+		end = start;
+	}
+
+	if (d->layout == LAYOUT_COLUMNS)
+	{
+		/* Permute each column segment on its own */
+		for (col=0;col<d->num_columns;col++)
+		{
+			uint32_t size = data_column_size(d,col);
+			uint8_t *values = data_block_entry(d,block,0,col);
+
+			for (i=0;i<n;i++)
+				memcpy(&sorted[i * size],&values[sorted_idx[i] * size],size);
+			memcpy(values,sorted,(size_t)n * size);
+		}
+	} else
+	{
+		for (i=0;i<n;i++)
+			memcpy(&sorted[i * bpr],&block[sorted_idx[i] * bpr],bpr);
+		memcpy(block,sorted,(size_t)n * bpr);
+	}
+	err = 0;
+	goto out;
+
+fallback:
+	if (d->layout == LAYOUT_COLUMNS)
+	{
+		/* The comparator works on packed rows */
+		if (!sorted)
+		{
+			fprintf(stderr,"Couldn't alloc memory for sorting\n");
+			goto out;
+		}
+		data_block_get_rows(d,block,0,sorted,n);
+		qsort_r(sorted,n,bpr,data_sort_compare_cb,d);
+		data_block_put_rows(d,block,0,sorted,n);
+	} else
+	{
+		qsort_r(block,n,bpr,data_sort_compare_cb,d);
+	}
+	err = 0;
+out:
+	free(sorted);
+	free(idx);
+	free(keys);
+	return err;
+}
+
+/**
+ * Reads consecutive rows of a file that stores blocks of the data frame
+ * as packed rows. In the columnar layout, the values of each column are
+ * read from the column segments of the blocks that contain the rows.
+ *
+ * @param d
+ * @param fd
+ * @param rows where to store the rows.
+ * @param row the first row to be read.
+ * @param n the number of rows.
+ * @return 0 on success, else an error.
+ */
+static int data_pread_rows(data_t *d, int fd, uint8_t *rows, uint32_t row, uint32_t n)
+{
+	int err = -1;
+	uint32_t bpr = d->num_bytes_per_row;
+	uint32_t cap = d->ib.num_rows;
+	uint8_t *values = NULL;
+
+	if (d->spill_compression)
+		return data_spill_pread(d,fd,rows,1,row,n);
+	if (d->layout == LAYOUT_ROWS)
+		return file_pio(fd,rows,(size_t)n * bpr,(off_t)row * bpr,0);
+
+	if (!(values = (uint8_t*)malloc((size_t)MIN(n,cap) * sizeof(double))))
+		goto out;
+
+	while (n)
+	{
+		uint32_t r = row % cap;
+		uint32_t m = MIN(n,cap - r);
+		off_t block_offset = (off_t)(row - r) * bpr;
+		int col;
+
+		for (col=0;col<d->num_columns;col++)
+		{
+			uint32_t size = data_column_size(d,col);
+			off_t offset = block_offset + (off_t)cap * d->column_offsets[col] + (off_t)r * size;
+
+			if (file_pio(fd,values,(size_t)m * size,offset,0))
+				goto out;
+			data_copy_values(&rows[d->column_offsets[col]],bpr,values,size,size,m);
+		}
+		rows += (size_t)m * bpr;
+		row += m;
+		n -= m;
+	}
+	err = 0;
+out:
+	free(values);
+	return err;
+}
+
+/** State of the read-ahead buffer of a run */
+enum prefetch_state
+{
+	PREFETCH_IDLE,
+	PREFETCH_REQUESTED,
+	PREFETCH_DONE,
+	PREFETCH_FAILED
+};
+
+/** The read-ahead buffer of a run */
+struct prefetch
+{
+	uint8_t *buf;
+
+	/** First row and number of rows to be read */
+	uint32_t row;
+	uint32_t rows;
+
+	enum prefetch_state state;
+};
+
+/**
+ * State of a k-way merge of sorted runs that are stored consecutively
+ * in an external file. The heads of the runs are organized in a loser
+ * tree, so that determining the next row costs O(log k) comparisons.
+ *
+ * Each run has a second buffer that an I/O thread fills with the next
+ * chunk of the run while the merge consumes the current one.
+ */
+struct merge
+{
+	data_t *d;
+
+	/** The file containing the runs */
+	FILE *file;
+	int fd;
+
+	/** Number of runs */
+	int k;
+
+	/** Read buffers, one per run */
+	block_t *in_blocks;
+
+	/** Read-ahead buffers, one per run */
+	struct prefetch *prefetches;
+
+	/** Number of rows of each run */
+	uint32_t *run_rows;
+
+	/**
+	 * Internal nodes 1..k-1 of the loser tree, the leaf for run i is
+	 * the implicit node k+i. tree[0] holds the overall winner.
+	 */
+	int *tree;
+
+	/** Indices of runs whose read-ahead buffer needs to be filled */
+	struct queue requests;
+	pthread_t io_thread;
+	int io_thread_started;
+
+	/** Protects the state of the read-ahead buffers */
+	pthread_mutex_t mutex;
+	pthread_cond_t done;
+
+	/** Number of buffer switches and how often the merge had to wait for them */
+	uint64_t refills;
+	uint64_t waits;
+};
+
+static inline int merge_run_is_exhausted(struct merge *m, int i)
+{
+	return m->in_blocks[i].current_row >= m->run_rows[i];
+}
+
+static inline uint8_t *merge_run_head(struct merge *m, int i)
+{
+	block_t *b = &m->in_blocks[i];
+	return &b->block[b->current_relative_row * m->d->num_bytes_per_row];
+}
+
+/**
+ * Determines whether the head of run a is smaller than the one of run b.
+ * Exhausted runs are larger than everything else.
+ */
+static inline int merge_less(struct merge *m, int a, int b)
+{
+	if (merge_run_is_exhausted(m,a)) return 0;
+	if (merge_run_is_exhausted(m,b)) return 1;
+	return data_sort_compare_cb(merge_run_head(m,a),merge_run_head(m,b),m->d) < 0;
+}
+
+static void *merge_io_thread(void *arg)
+{
+	struct merge *m = (struct merge*)arg;
+	void *item;
+
+	while ((item = queue_get(&m->requests)))
+	{
+		struct prefetch *pf = &m->prefetches[(intptr_t)item - 1];
+		int failed;
+
+		failed = data_pread_rows(m->d,m->fd,pf->buf,pf->row,pf->rows);
+
+		pthread_mutex_lock(&m->mutex);
+		pf->state = failed ? PREFETCH_FAILED : PREFETCH_DONE;
+		pthread_cond_broadcast(&m->done);
+		pthread_mutex_unlock(&m->mutex);
+	}
+	return NULL;
+}
+
+/**
+ * Asks the I/O thread to read the chunk that follows the current buffer
+ * of the given run, if there is any.
+ *
+ * @param m
+ * @param i
+ * @return 0 on success, else an error.
+ */
+static int merge_request_prefetch(struct merge *m, int i)
+{
+	block_t *b = &m->in_blocks[i];
+	struct prefetch *pf = &m->prefetches[i];
+	uint32_t next_row = b->row_offset + b->num_rows;
+	uint32_t run_end = b->row_offset - b->current_row + b->current_relative_row + m->run_rows[i];
+
+	if (next_row >= run_end)
+		return 0;
+
+	pf->row = next_row;
+	pf->rows = MIN(b->num_rows,run_end - next_row);
+
+	pthread_mutex_lock(&m->mutex);
+	pf->state = PREFETCH_REQUESTED;
+	pthread_mutex_unlock(&m->mutex);
+
+	return queue_put(&m->requests,(void*)(intptr_t)(i + 1));
+}
+
+/**
+ * Frees all resources associated with the merge.
+ *
+ * @param m
+ */
+static void merge_free(struct merge *m)
+{
+	int i;
+
+	if (m->io_thread_started)
+	{
+		queue_close(&m->requests);
+		pthread_join(m->io_thread,NULL);
+		pthread_cond_destroy(&m->done);
+		pthread_mutex_destroy(&m->mutex);
+		queue_free(&m->requests);
+
+		m->d->merge_refills += m->refills;
+		m->d->merge_waits += m->waits;
+	}
+
+	if (m->in_blocks)
+	{
+		for (i=0;i<m->k;i++)
+			free(m->in_blocks[i].block);
+	}
+	if (m->prefetches)
+	{
+		for (i=0;i<m->k;i++)
+			free(m->prefetches[i].buf);
+	}
+	free(m->in_blocks);
+	free(m->prefetches);
+	free(m->run_rows);
+	free(m->tree);
+}
+
+/**
+ * Prepares the merge of k runs. All runs but the last one consist of
+ * rows_per_run rows.
+ *
+ * @param m
+ * @param d
+ * @param f the file that contains the runs
+ * @param first_row the first row of the first run
+ * @param k number of runs
+ * @param rows_per_run
+ * @param rows_in_last_run
+ * @param buffer_bytes size of each of the two read buffers of a run
+ * @return 0 on success, else an error.
+ */
+static int merge_init(struct merge *m, data_t *d, FILE *f, uint32_t first_row, int k, uint32_t rows_per_run, uint32_t rows_in_last_run, uint32_t buffer_bytes)
+{
+	int i;
+	int n;
+	int err = -1;
+	int *winners = NULL;
+
+	memset(m,0,sizeof(*m));
+	m->d = d;
+	m->file = f;
+	m->k = k;
+
+	/* The I/O thread accesses the file directly */
+	if (fflush(f))
+		goto out;
+	m->fd = fileno(f);
+
+	if (!(m->in_blocks = (block_t*)calloc(k,sizeof(m->in_blocks[0]))))
+		goto out;
+	if (!(m->prefetches = (struct prefetch*)calloc(k,sizeof(m->prefetches[0]))))
+		goto out;
+	if (!(m->run_rows = (uint32_t*)malloc(sizeof(m->run_rows[0])*k)))
+		goto out;
+	if (!(m->tree = (int*)malloc(sizeof(m->tree[0])*k)))
+		goto out;
+	if (!(winners = (int*)malloc(sizeof(winners[0])*2*k)))
+		goto out;
+
+	for (i=0;i<k;i++)
+	{
+		uint32_t bytes;
+
+		m->run_rows[i] = i == k - 1 ? rows_in_last_run : rows_per_run;
+		bytes = MIN((uint64_t)m->run_rows[i]*d->num_bytes_per_row,buffer_bytes);
+
+		if ((err = data_initialize_block(&m->in_blocks[i],d,bytes)))
+		{
+			fprintf(stderr,"Couldn't alloc block for input\n");
+			goto out;
+		}
+		err = -1;
+		if (m->run_rows[i] > m->in_blocks[i].num_rows && !(m->prefetches[i].buf = (uint8_t*)malloc(bytes)))
+		{
+			fprintf(stderr,"Couldn't alloc block for input\n");
+			goto out;
+		}
+		m->in_blocks[i].row_offset = first_row + i*rows_per_run;
+		m->in_blocks[i].current_relative_row = 0;
+		if ((err = data_pread_rows(d,m->fd,m->in_blocks[i].block,m->in_blocks[i].row_offset,MIN(m->in_blocks[i].num_rows,m->run_rows[i]))))
+		{
+			fprintf(stderr,"Couldn't read in block\n");
+			goto out;
+		}
+	}
+
+	if ((err = queue_init(&m->requests,k)))
+		goto out;
+	pthread_mutex_init(&m->mutex,NULL);
+	pthread_cond_init(&m->done,NULL);
+	if ((err = pthread_create(&m->io_thread,NULL,merge_io_thread,m)))
+	{
+		pthread_cond_destroy(&m->done);
+		pthread_mutex_destroy(&m->mutex);
+		queue_free(&m->requests);
+		goto out;
+	}
+	m->io_thread_started = 1;
+
+	for (i=0;i<k;i++)
+	{
+		if ((err = merge_request_prefetch(m,i)))
+			goto out;
+	}
+
+	/* Play the initial tournament */
+	for (i=0;i<k;i++)
+		winners[k+i] = i;
+	for (n=k-1;n>0;n--)
+	{
+		int l = winners[2*n];
+		int r = winners[2*n+1];
+
+		if (merge_less(m,r,l))
+		{
+			winners[n] = r;
+			m->tree[n] = l;
+		} else
+		{
+			winners[n] = l;
+			m->tree[n] = r;
+		}
+	}
+	m->tree[0] = k > 1 ? winners[1] : 0;
+
+	err = 0;
+out:
+	free(winners);
+	if (err) merge_free(m);
+	return err;
+}
+
+/**
+ * Returns the smallest row among all runs.
+ *
+ * @param m
+ * @return the row or NULL, if all runs are exhausted.
+ */
+static inline uint8_t *merge_head(struct merge *m)
+{
+	int w = m->tree[0];
+
+	if (merge_run_is_exhausted(m,w))
+		return NULL;
+	return merge_run_head(m,w);
+}
+
+/**
+ * Makes the read-ahead buffer of the given run its current buffer and
+ * requests the following chunk.
+ *
+ * @param m
+ * @param i
+ * @return 0 on success, else an error.
+ */
+static int merge_switch_buffers(struct merge *m, int i)
+{
+	block_t *b = &m->in_blocks[i];
+	struct prefetch *pf = &m->prefetches[i];
+	enum prefetch_state state;
+	uint8_t *t;
+
+	pthread_mutex_lock(&m->mutex);
+	if (pf->state == PREFETCH_REQUESTED)
+	{
+		m->waits++;
+		while (pf->state == PREFETCH_REQUESTED)
+			pthread_cond_wait(&m->done,&m->mutex);
+	}
+	state = pf->state;
+	pf->state = PREFETCH_IDLE;
+	pthread_mutex_unlock(&m->mutex);
+
+	if (state != PREFETCH_DONE)
+	{
+		fprintf(stderr,"Couldn't read in block for %d\n",i);
+		return -1;
+	}
+
+	m->refills++;
+
+	t = b->block;
+	b->block = pf->buf;
+	pf->buf = t;
+	b->row_offset = pf->row;
+	b->current_relative_row = 0;
+
+	return merge_request_prefetch(m,i);
+}
+
+/**
+ * Removes the smallest row and determines the new one.
+ *
+ * @param m
+ * @return 0 on success, else an error.
+ */
+static int merge_advance(struct merge *m)
+{
+	int err;
+	int n;
+	int w = m->tree[0];
+	block_t *b = &m->in_blocks[w];
+
+	b->current_relative_row++;
+	b->current_row++;
+
+	if (!merge_run_is_exhausted(m,w) && b->current_relative_row == b->num_rows)
+	{
+		if ((err = merge_switch_buffers(m,w)))
+			return err;
+	}
+
+	/* Replay the matches on the path from the leaf to the root */
+	for (n=(w+m->k)/2;n>0;n/=2)
+	{
+		if (merge_less(m,m->tree[n],w))
+		{
+			int t = m->tree[n];
+			m->tree[n] = w;
+			w = t;
+		}
+	}
+	m->tree[0] = w;
+	return 0;
+}
+
+/** A block that travels through the run generation pipeline */
+struct sort_job
+{
+	uint8_t *buf;
+	uint32_t first_row;
+	uint32_t rows;
+};
+
+struct sort_pipeline
+{
+	data_t *d;
+	int fd;
+
+	/** Buffers that are free to be read into */
+	struct queue free;
+
+	/** Blocks that have been read and need to be sorted */
+	struct queue to_sort;
+
+	/** Blocks that have been sorted and need to be written */
+	struct queue to_write;
+
+	/** The following is protected by the mutex */
+	pthread_mutex_t mutex;
+	uint64_t positives;
+	uint64_t negatives;
+	int err;
+};
+
+static void sort_pipeline_fail(struct sort_pipeline *sp)
+{
+	pthread_mutex_lock(&sp->mutex);
+	sp->err = -1;
+	pthread_mutex_unlock(&sp->mutex);
+
+	queue_close(&sp->free);
+	queue_close(&sp->to_sort);
+	queue_close(&sp->to_write);
+}
+
+static void *sort_pipeline_reader(void *arg)
+{
+	struct sort_pipeline *sp = (struct sort_pipeline*)arg;
+	data_t *d = sp->d;
+	uint32_t row;
+
+	for (row=0;row<d->num_rows;row+=d->ib.num_rows)
+	{
+		struct sort_job *job;
+
+		if (!(job = (struct sort_job*)queue_get(&sp->free)))
+			break;
+
+		job->first_row = row;
+		job->rows = MIN(d->ib.num_rows,d->num_rows - row);
+		if (data_block_pio(d,sp->fd,job->buf,row,job->rows,0))
+		{
+			fprintf(stderr,"Reading row %d failed!\n",row);
+			sort_pipeline_fail(sp);
+			break;
+		}
+		if (queue_put(&sp->to_sort,job))
+			break;
+	}
+	queue_close(&sp->to_sort);
+	return NULL;
+}
+
+static void *sort_pipeline_sorter(void *arg)
+{
+	struct sort_pipeline *sp = (struct sort_pipeline*)arg;
+	data_t *d = sp->d;
+	struct sort_job *job;
+
+	while ((job = (struct sort_job*)queue_get(&sp->to_sort)))
+	{
+		uint64_t positives = 0;
+		uint64_t negatives = 0;
+
+		if (data_sort_block(d,job->buf,job->rows))
+		{
+			sort_pipeline_fail(sp);
+			break;
+		}
+		data_block_count(d,job->buf,job->rows,d->label_col,&positives,&negatives);
+		if (d->group_col >= 0 && data_block_count_groups(d,job->buf,job->rows,d->label_col,&d->groups,&sp->mutex))
+		{
+			sort_pipeline_fail(sp);
+			break;
+		}
+
+		pthread_mutex_lock(&sp->mutex);
+		sp->positives += positives;
+		sp->negatives += negatives;
+		pthread_mutex_unlock(&sp->mutex);
+
+		if (queue_put(&sp->to_write,job))
+			break;
+	}
+	return NULL;
+}
+
+static void *sort_pipeline_writer(void *arg)
+{
+	struct sort_pipeline *sp = (struct sort_pipeline*)arg;
+	data_t *d = sp->d;
+	struct sort_job *job;
+	struct progress p;
+	uint32_t done = 0;
+
+	progress_init(&p,"Sorting - first pass",d->num_rows,d->show_progress);
+
+	while ((job = (struct sort_job*)queue_get(&sp->to_write)))
+	{
+		if (data_block_pio(d,sp->fd,job->buf,job->first_row,job->rows,1))
+		{
+			fprintf(stderr,"Write failed!\n");
+			sort_pipeline_fail(sp);
+			break;
+		}
+
+		done += job->rows;
+		progress_done(&p,done);
+		progress_print(&p,0);
+
+		if (done == d->num_rows)
+			break;
+		if (queue_put(&sp->free,job))
+			break;
+	}
+	return NULL;
+}
+
+/**
+ * Sorts the blocks of the external file. A reader thread, d->num_threads
+ * sorter threads and a writer thread are connected by bounded queues, so
+ * reading, sorting and writing of different blocks overlap.
+ *
+ * @param d
+ * @return 0 on success, else an error.
+ */
+static int data_sort_runs_pipelined(data_t *d)
+{
+	struct sort_pipeline sp;
+	struct sort_job *jobs = NULL;
+	pthread_t reader, writer;
+	pthread_t *sorters = NULL;
+	int num_sorters = 0;
+	int num_buffers = d->num_threads + 2;
+	int reader_started = 0;
+	int writer_started = 0;
+	int err = -1;
+	int i;
+
+	memset(&sp,0,sizeof(sp));
+	sp.d = d;
+
+	/* The file must contain everything before it is accessed directly */
+	if ((err = data_write_input_block(d)))
+		return err;
+	err = -1;
+	if (fflush(d->tmp))
+		return err;
+	sp.fd = fileno(d->tmp);
+
+	if (!(jobs = (struct sort_job*)calloc(num_buffers,sizeof(jobs[0]))))
+		return err;
+	if (!(sorters = (pthread_t*)malloc(sizeof(sorters[0])*d->num_threads)))
+		goto out_jobs;
+
+	if (queue_init(&sp.free,num_buffers))
+		goto out_jobs;
+	if (queue_init(&sp.to_sort,num_buffers))
+		goto out_free;
+	if (queue_init(&sp.to_write,num_buffers))
+		goto out_to_sort;
+	pthread_mutex_init(&sp.mutex,NULL);
+
+	for (i=0;i<num_buffers;i++)
+	{
+		if (!(jobs[i].buf = (uint8_t*)malloc((size_t)d->ib.num_rows * d->num_bytes_per_row)))
+			break;
+		queue_put(&sp.free,&jobs[i]);
+	}
+
+	if (i < 3)
+	{
+		fprintf(stderr,"Couldn't alloc buffers for sorting\n");
+		goto out;
+	}
+
+	if (pthread_create(&reader,NULL,sort_pipeline_reader,&sp))
+		goto out;
+	reader_started = 1;
+
+	for (i=0;i<d->num_threads;i++)
+	{
+		if (pthread_create(&sorters[i],NULL,sort_pipeline_sorter,&sp))
+			break;
+		num_sorters++;
+	}
+	if (!num_sorters)
+		goto out;
+
+	if (pthread_create(&writer,NULL,sort_pipeline_writer,&sp))
+		goto out;
+	writer_started = 1;
+
+	err = 0;
+out:
+	if (err)
+		sort_pipeline_fail(&sp);
+	if (reader_started)
+		pthread_join(reader,NULL);
+	for (i=0;i<num_sorters;i++)
+		pthread_join(sorters[i],NULL);
+	/* Let the writer finish once all sorters are done */
+	queue_close(&sp.to_write);
+	if (writer_started)
+		pthread_join(writer,NULL);
+
+	if (!err)
+		err = sp.err;
+
+	if (!err)
+	{
+		d->positives = sp.positives;
+		d->negatives = sp.negatives;
+
+		/* The input block must reflect the sorted file */
+		err = data_read_block_for_row(d,&d->ib,d->ib.row_offset);
+	}
+
+	for (i=0;i<num_buffers;i++)
+		free(jobs[i].buf);
+	pthread_mutex_destroy(&sp.mutex);
+	queue_free(&sp.to_write);
+out_to_sort:
+	queue_free(&sp.to_sort);
+out_free:
+	queue_free(&sp.free);
+out_jobs:
+	free(sorters);
+	free(jobs);
+	return err;
+}
+
+/**
+ * Determines whether all blocks but the input block have already been
+ * sorted according to the current sort columns when they were spilled.
+ *
+ * @param d
+ * @return whether the blocks are sorted.
+ */
+static int data_runs_are_presorted(data_t *d)
+{
+	if (!d->num_presort_columns || !d->presorted_rows)
+		return 0;
+	if (d->presorted_rows != d->ib.row_offset || d->num_rows != d->ib.row_offset + d->ib.current_relative_row)
+		return 0;
+	if (d->presort_label_col != d->label_col || d->num_presort_columns != d->num_to_sort_columns)
+		return 0;
+	return !memcmp(d->presort_columns,d->to_sort_columns,sizeof(d->to_sort_columns[0]) * d->num_to_sort_columns);
+}
+
+/**
+ * Sorts the blocks of the data in place, which results in sorted
+ * runs of ib.num_rows rows. Also determines the total weights.
+ *
+ * @param d
+ * @return 0 on success, else an error.
+ */
+static int data_sort_runs(data_t *d)
+{
+	int err = -1;
+
+	data_groups_free(&d->groups);
+
+	/* Only data_sort() leaves all rows in order */
+	d->num_sorted_columns = 0;
+
+	if (d->tmp && d->num_rows > d->ib.num_rows)
+	{
+		if (data_runs_are_presorted(d))
+		{
+			/* Only the last block remains to be sorted */
+			uint32_t n = d->ib.current_relative_row;
+
+			if ((err = data_sort_block(d,d->ib.block,n)))
+				goto out;
+			d->positives = d->presorted_positives;
+			d->negatives = d->presorted_negatives;
+			data_block_count(d,d->ib.block,n,d->label_col,&d->positives,&d->negatives);
+			d->groups = d->presorted_groups;
+			memset(&d->presorted_groups,0,sizeof(d->presorted_groups));
+			if (d->group_col >= 0 && (err = data_block_count_groups(d,d->ib.block,n,d->label_col,&d->groups,NULL)))
+				goto out;
+			d->presorted_rows = 0;
+			return 0;
+		}
+		d->presorted_rows = 0;
+		return data_sort_runs_pipelined(d);
+	}
+
+	d->positives = 0;
+	d->negatives = 0;
+	if (!d->num_rows)
+		return 0;
+
+	/* Everything fits into the input block */
+	if ((err = data_read_input_block_for_row(d,0)))
+		goto out;
+	if ((err = data_sort_block(d,d->ib.block,d->num_rows)))
+		goto out;
+	data_block_count(d,d->ib.block,d->num_rows,d->label_col,&d->positives,&d->negatives);
+	if (d->group_col >= 0 && (err = data_block_count_groups(d,d->ib.block,d->num_rows,d->label_col,&d->groups,NULL)))
+		goto out;
+	err = 0;
+out:
+	return err;
+}
+
+/**
+ * Determines the number of runs that can be merged at once.
+ *
+ * @param d
+ * @return the fan-in, at least 2.
+ */
+static int data_merge_fan_in(data_t *d)
+{
+	size_t fan_in;
+
+	if (d->max_fan_in)
+		return d->max_fan_in;
+
+	/* Each run has a current and a read-ahead buffer */
+	fan_in = d->merge_bytes / 2 / MAX(d->merge_buffer_min_bytes,d->num_bytes_per_row);
+	return MAX(2,MIN(fan_in,INT_MAX));
+}
+
+/**
+ * Determines the size of each of the two read buffers of a run if k runs
+ * are merged at once.
+ *
+ * @param d
+ * @param k
+ * @return the size in bytes.
+ */
+static uint32_t data_merge_buffer_bytes(data_t *d, int k)
+{
+	size_t bytes = d->merge_bytes / 2 / k;
+
+	bytes = MAX(bytes,d->merge_buffer_min_bytes);
+	bytes = MAX(bytes,d->num_bytes_per_row);
+	return MIN(bytes,UINT32_MAX / 2);
+}
+
+/**
+ * Writes rows sequentially to a file in the layout of the data frame.
+ * In the columnar layout, whole blocks are buffered, so the rows must
+ * be written starting at a block boundary. This is also the case for
+ * compressed files, whose chunks must not cross block boundaries.
+ */
+struct block_writer
+{
+	data_t *d;
+	FILE *f;
+	uint8_t *buf;
+
+	/** Number of rows that fit into buf and number of rows in it */
+	uint32_t capacity;
+	uint32_t rows;
+
+	/** Row of the file at which buf is written, used for compressed files */
+	uint32_t row;
+};
+
+/**
+ * Prepares the writer.
+ *
+ * @param w
+ * @param d
+ * @param f the file to which is written at its current position, which
+ *  must be its start if it is compressed.
+ * @param buffer_bytes the size of the buffer that is used in the row layout
+ *  of uncompressed files.
+ * @return 0 on success, else an error.
+ */
+static int block_writer_init(struct block_writer *w, data_t *d, FILE *f, uint32_t buffer_bytes)
+{
+	memset(w,0,sizeof(*w));
+	w->d = d;
+	w->f = f;
+	if (d->layout == LAYOUT_COLUMNS || d->spill_compression)
+		w->capacity = d->ib.num_rows;
+	else
+		w->capacity = MAX(1,buffer_bytes / d->num_bytes_per_row);
+	if (!(w->buf = (uint8_t*)malloc((size_t)w->capacity * d->num_bytes_per_row)))
+		return -1;
+	return 0;
+}
+
+/**
+ * Writes the buffered rows.
+ *
+ * @param w
+ * @return 0 on success, else an error.
+ */
+static int block_writer_flush(struct block_writer *w)
+{
+	size_t bytes;
+
+	if (!w->rows)
+		return 0;
+
+	if (w->d->spill_compression)
+	{
+		if (data_spill_pwrite(w->d,fileno(w->f),w->buf,0,w->row,w->rows))
+			return -1;
+		w->row += w->rows;
+		w->rows = 0;
+		return 0;
+	}
+
+	bytes = data_block_file_bytes(w->d,w->rows);
+	if (fwrite(w->buf,1,bytes,w->f) != bytes)
+	{
+		fprintf(stderr,"Write failed!\n");
+		return -1;
+	}
+	w->rows = 0;
+	return 0;
+}
+
+/**
+ * Appends a single packed row.
+ *
+ * @param w
+ * @param row
+ * @return 0 on success, else an error.
+ */
+static inline int block_writer_put(struct block_writer *w, const uint8_t *row)
+{
+	if (w->d->layout == LAYOUT_ROWS)
+		memcpy(&w->buf[w->rows * w->d->num_bytes_per_row],row,w->d->num_bytes_per_row);
+	else
+		data_block_put_rows(w->d,w->buf,w->rows,row,1);
+
+	if (++w->rows == w->capacity)
+		return block_writer_flush(w);
+	return 0;
+}
+
+static void block_writer_free(struct block_writer *w)
+{
+	free(w->buf);
+}
+
+/**
+ * Merges groups of fan_in consecutive runs of the source file into single
+ * runs of the destination file. The output of a group takes the same rows
+ * as its input runs.
+ *
+ * @param d
+ * @param src
+ * @param dest
+ * @param k the number of runs in src
+ * @param fan_in
+ * @param rows_per_run
+ * @return 0 on success, else an error.
+ */
+static int data_merge_pass(data_t *d, FILE *src, FILE *dest, int k, int fan_in, uint32_t rows_per_run)
+{
+	int err = -1;
+	int g;
+	struct block_writer w;
+	uint32_t done = 0;
+	uint32_t buffer_bytes = data_merge_buffer_bytes(d,fan_in);
+	struct progress p;
+
+	if (fseeko(dest,0,SEEK_SET))
+		return err;
+	data_spill_forget(d,fileno(dest));
+
+	if (block_writer_init(&w,d,dest,buffer_bytes))
+		goto out;
+
+	progress_init(&p,"Sorting - intermediate pass",d->num_rows,d->show_progress);
+
+	for (g=0;g<k;g+=fan_in)
+	{
+		struct merge merge;
+		uint8_t *row;
+		int gk = MIN(fan_in,k - g);
+		uint32_t first_row = g * rows_per_run;
+		uint32_t rows_in_last_run = MIN(rows_per_run,d->num_rows - (first_row + (gk - 1) * rows_per_run));
+
+		if ((err = merge_init(&merge,d,src,first_row,gk,rows_per_run,rows_in_last_run,buffer_bytes)))
+			goto out;
+
+		while ((row = merge_head(&merge)))
+		{
+			if ((err = block_writer_put(&w,row)))
+				break;
+			if (!w.rows)
+			{
+				done += w.capacity;
+				progress_done(&p,done);
+				progress_print(&p,0);
+			}
+			if ((err = merge_advance(&merge)))
+				break;
+		}
+		merge_free(&merge);
+		if (err)
+			goto out;
+	}
+
+	err = -1;
+	if (block_writer_flush(&w))
+		goto out;
+	if (fflush(dest))
+		goto out;
+	err = 0;
+out:
+	block_writer_free(&w);
+	return err;
+}
+
+/**
+ * Merges the sorted runs as produced by data_sort_runs() and passes
+ * each row in order to the callback. If there are more runs than can
+ * be merged at once, groups of runs are merged into longer runs first.
+ *
+ * @param d
+ * @param callback
+ * @param user_data
+ * @return 0 on success, else an error.
+ */
+static int data_merge_runs(data_t *d, int (*callback)(data_t *d, uint8_t *row, void *user_data), void *user_data)
+{
+	int err = -1;
+	int k;
+	int fan_in;
+	uint32_t m;
+	uint8_t *row;
+	struct merge merge;
+	struct progress p;
+	FILE *src;
+	FILE *other = NULL;
+	char *other_name = NULL;
+	int tmp_modified = 0;
+
+	/* Write possible rest of the cache */
+	if ((err = data_write_input_block(d)))
+	{
+		fprintf(stderr,"Couldn't write block\n");
+		goto out;
+	}
+	err = -1;
+
+	k = (d->num_rows + d->ib.num_rows - 1 ) / d->ib.num_rows;
+	fan_in = data_merge_fan_in(d);
+	src = d->tmp;
 
-	/** Size of the block in bytes */
-	uint32_t block_bytes;
+	uint32_t rows_per_run = d->ib.num_rows;
 
-	/** The offset of the blocks in rows */
-	uint32_t row_offset;
+	/* Reduce the number of runs until a single merge suffices */
+	while (k > fan_in)
+	{
+		FILE *dest;
 
-	/** The number of rows covered by the block */
-	uint32_t num_rows;
+		D("Merging k=%d runs of %d rows in groups of %d\n",k,rows_per_run,fan_in);
 
-	/** The current row relative to row_offset */
-	uint32_t current_relative_row;
+		if (!other)
+		{
+			if (!(other_name = malloc(strlen(d->filename) + 10)))
+				goto out;
+			strcpy(other_name,d->filename);
+			strcat(other_name,"-merge");
 
-	uint32_t current_row;
-} block_t;
+			if (!(other = fopen(other_name,"w+")))
+			{
+				fprintf(stderr,"Couldn't open \"%s\"\n",other_name);
+				goto out;
+			}
+		}
 
-struct data
-{
-	const char *filename;
-	FILE *tmp;
+		dest = src == d->tmp ? other : d->tmp;
+		tmp_modified |= dest == d->tmp;
+		if ((err = data_merge_pass(d,src,dest,k,fan_in,rows_per_run)))
+			goto out;
+		err = -1;
+		src = dest;
 
-	enum column_datatype_t *column_datatype;
-	uint32_t *column_offsets;
-	uint32_t num_columns;
-	uint32_t num_rows;
-	uint32_t num_bytes_per_row;
+		k = (k + fan_in - 1) / fan_in;
+		rows_per_run = (uint32_t)MIN((uint64_t)rows_per_run * fan_in,d->num_rows);
+	}
 
-	/** Size in bytes for the input block */
-	uint32_t ib_bytes;
+	uint32_t rows_in_last_run = d->num_rows - (k - 1) * rows_per_run;
 
-	/** Input block */
-	block_t ib;
+	D("Taking k=%d runs containing %d rows, last contains %d rows\n",k,rows_per_run,rows_in_last_run);
 
-	int *to_sort_columns;
-	int num_to_sort_columns;
+	if ((err = merge_init(&merge,d,src,0,k,rows_per_run,rows_in_last_run,data_merge_buffer_bytes(d,k))))
+		goto out;
 
-	int label_col;
-	int64_t label_sum;
+	progress_init(&p,"Sorting - second pass",d->num_rows,d->show_progress);
 
-	/* Histograms of various measures */
-	int hist_initialized;
-	struct hist roc;
-	struct hist precall;
-};
+	for (m=0;(row = merge_head(&merge));m++)
+	{
+		progress_done(&p,m);
+
+		if ((err = callback(d, row, user_data)))
+			break;
+		if ((err = merge_advance(&merge)))
+			break;
+
+		progress_print(&p,0);
+	}
+
+	merge_free(&merge);
+
+	/* The contents of the external file may have been changed by a pass */
+	if (!err && tmp_modified)
+		err = data_read_block_for_row(d, &d->ib, d->ib.row_offset);
+out:
+	if (other)
+	{
+		data_spill_forget(d,fileno(other));
+		fclose(other);
+		remove(other_name);
+	}
+	free(other_name);
+	return err;
+}
 
 /**
- * Constructs an empty data frame.
+ * Sorts the entire data.
  *
- * @param out where the reference is stored.
- * @return 0 on success, else an error.
+ * @param d
+ * @param cols
+ * @param to_sort_cols
+ * @return
  */
-int data_create(data_t **out)
+static int data_sort_callback(data_t *d, int cols, int *to_sort_cols, int (*callback)(data_t *d, uint8_t *row, void *user_data), void *user_data)
 {
 	int err = -1;
-	data_t *n;
 
-	if (!(n = (data_t*)malloc(sizeof(*n))))
+	if ((err = data_sort_runs(d)))
 		goto out;
-	memset(n,0,sizeof(*n));
 
-	n->ib_bytes = 1024 * 1024 * 10;
-	n->filename = "out";
-	*out = n;
+	/* Now merge sort the runs */
+	if (d->num_rows > d->ib.num_rows)
+	{
+		if ((err = data_merge_runs(d,callback,user_data)))
+			goto out;
+	}
 	err = 0;
 out:
 	return err;
 }
 
 /**
- * Frees all memory associated with the given
- * data frame.
+ * Records that all rows are sorted according to the given columns.
  *
  * @param d
+ * @param cols
+ * @param to_sort_cols
+ * @return 0 on success, else an error.
  */
-void data_free(data_t *d)
+static int data_set_sorted_columns(data_t *d, int cols, const int *to_sort_cols)
 {
-	if (d)
-	{
-		if (d->hist_initialized)
-		{
-			hist_free(&d->precall);
-			hist_free(&d->roc);
-		}
+	int *sorted_columns;
 
-		if (d->tmp)
-			fclose(d->tmp);
-		free(d->column_datatype);
-		free(d->column_offsets);
-		free(d->ib.block);
-		free(d);
-	}
+	if (!(sorted_columns = (int*)realloc(d->sorted_columns,sizeof(sorted_columns[0]) * MAX(cols,1))))
+		return -1;
+	memcpy(sorted_columns,to_sort_cols,sizeof(sorted_columns[0]) * cols);
+	d->sorted_columns = sorted_columns;
+	d->num_sorted_columns = cols;
+	return 0;
 }
 
 /**
- * Set the name of the external file to be used when storing and
- * sorting.
+ * Determines whether all rows are known to be sorted according to the
+ * given columns, which is also the case if they are sorted by further
+ * columns.
  *
  * @param d
- * @param filename
+ * @param cols
+ * @param to_sort_cols
+ * @return whether the rows are sorted.
  */
-void data_set_external_filename(data_t *d, const char *filename)
+static int data_is_sorted_by(data_t *d, int cols, const int *to_sort_cols)
 {
-	d->filename = filename;
+	return cols && d->num_sorted_columns >= cols &&
+			!memcmp(d->sorted_columns,to_sort_cols,sizeof(to_sort_cols[0]) * cols);
 }
 
 /**
- * Sets the number of columns of the given data frame.
+ * Determines the weights of the positive and the negative rows and of
+ * the groups without reordering any row.
  *
  * @param d
- * @param cols
  * @return 0 on success, else an error.
  */
-int data_set_number_of_columns(data_t *d, uint32_t cols)
+static int data_count_rows(data_t *d)
 {
-	int i;
 	int err = -1;
+	uint32_t r;
+	uint32_t n;
 
-	d->num_columns = cols;
+	data_groups_free(&d->groups);
+	d->positives = 0;
+	d->negatives = 0;
 
-	if (!(d->column_datatype = malloc(sizeof(d->column_datatype[0])*cols)))
+	for (r=0;r<d->num_rows;r+=n)
+	{
+		if ((err = data_read_input_block_for_row(d,r)))
+			goto out;
+		n = MIN(d->ib.num_rows,d->num_rows - r);
+		data_block_count(d,d->ib.block,n,d->label_col,&d->positives,&d->negatives);
+		if (d->group_col >= 0 && (err = data_block_count_groups(d,d->ib.block,n,d->label_col,&d->groups,NULL)))
+			goto out;
+	}
+	err = 0;
+out:
+	return err;
+}
+
+static int data_sort_cb(data_t *d, uint8_t *buf, void *user_data)
+{
+	struct block_writer *w = (struct block_writer*)user_data;
+	return block_writer_put(w,buf);
+}
+
+static int data_sort(data_t *d, int num_to_sort_columns, int *to_sort_columns)
+{
+	int err = -1;
+	char *sorted_name = NULL;
+	FILE *sorted_outf = NULL;
+	int sorted_fd = -1;
+	struct block_writer w;
+
+	memset(&w,0,sizeof(w));
+
+	if ((err = data_expand_aggregate(d)))
+		return err;
+	err = -1;
+
+	if (!(sorted_name = malloc(strlen(d->filename) + 10)))
 		goto out;
 
-	if (!(d->column_offsets = malloc(sizeof(d->column_offsets[0])*cols)))
+	strcpy(sorted_name,d->filename);
+	strcat(sorted_name,"-sorted");
+
+	if (!(sorted_outf = fopen(sorted_name,"wb")))
 		goto out;
 
-	for (i=0;i<cols;i++)
+	d->to_sort_columns = to_sort_columns;
+	d->num_to_sort_columns = num_to_sort_columns;
+
+	if (d->tmp && (err = block_writer_init(&w,d,sorted_outf,d->merge_buffer_min_bytes)))
+		goto out;
+
+	if ((err = data_sort_callback(d, num_to_sort_columns, to_sort_columns, data_sort_cb, &w)))
+		goto out;
+
+	if (d->tmp)
 	{
-		d->column_datatype[i] = UNKNOWN;
-		d->column_offsets[i] = 0;
+		if ((err = block_writer_flush(&w)))
+			goto out;
+		err = -1;
+
+		data_spill_forget(d,fileno(d->tmp));
+		fclose(d->tmp);
+		d->tmp = NULL;
+
+		sorted_fd = fileno(sorted_outf);
+		fclose(sorted_outf);
+		sorted_outf = NULL;
+
+		remove(d->filename);
+		if (rename(sorted_name,d->filename) == -1)
+		{
+			fprintf(stderr,"Couldn't rename\n");
+			goto out;
+		}
+
+		if (!(d->tmp = fopen(d->filename,"r+")))
+		{
+			fprintf(stderr,"Couldn't open file for appending\n");
+			goto out;
+		}
+		data_spill_move(d,sorted_fd,fileno(d->tmp));
+		sorted_fd = -1;
+		data_read_block_for_row(d, &d->ib, 0);
 	}
-	err = 0;
 
+	if ((err = data_set_sorted_columns(d,num_to_sort_columns,to_sort_columns)))
+		goto out;
+
+	err = 0;
 out:
+	block_writer_free(&w);
+	if (sorted_outf)
+	{
+		sorted_fd = fileno(sorted_outf);
+		fclose(sorted_outf);
+	}
+	if (sorted_fd >= 0)
+		data_spill_forget(d,sorted_fd);
+	if (sorted_name) free(sorted_name);
+	return err;
+}
+
+int data_sort_v(data_t *d, int cols, ...)
+{
+	int i;
+	int err = -1;
+	int to_sort_cols[cols];
+
+	va_list vl;
+	va_start(vl,cols);
+
+	for (i=0;i<cols;i++)
+		to_sort_cols[i] = va_arg(vl,int);
+
+	err = data_sort(d,cols,to_sort_cols);
+
+	va_end(vl);
 	return err;
 }
 
+/**************************************************************/
+
+/** Identifies binary frame files, see data_save_binary() */
+#define DATA_BINARY_MAGIC "CLPFRAME"
+
+/** Version of the binary frame format */
+#define DATA_BINARY_VERSION 1
+
+/** Written as is, so files of another byte order can be recognized */
+#define DATA_BINARY_BYTE_ORDER 0x01020304
+
+/** The rows start at a multiple of this, so they can be mapped page-aligned */
+#define DATA_BINARY_ALIGNMENT 4096
+
+/** Size of the buffer through which rows are copied from the external file */
+#define DATA_BINARY_COPY_BYTES (1024 * 1024)
+
 /**
- * Sets the type of the column.
- *
- * @param d
- * @param col
- * @param dt
- * @return
+ * Header of a binary frame file, see data_save_binary(). It is followed
+ * by a struct data_binary_column for each column, by the columns by which
+ * the rows are sorted as int32_t values, negative ones in descending
+ * order, and by the key. The rows start at data_offset and form a single
+ * block of the given layout, i.e., either num_rows consecutive rows or
+ * the num_rows values of each column one after the other. All values are
+ * stored in the byte order of the machine that wrote the file.
  */
-int data_set_column_datatype(data_t *d, int col, enum column_datatype_t dt)
+struct data_binary_header
 {
-	d->column_datatype[col] = dt;
-	return 0;
-}
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t layout;
+	uint32_t num_columns;
+	uint32_t num_input_columns;
+	uint32_t num_rows;
+	uint32_t num_sorted_columns;
+	uint32_t key_bytes;
+	uint64_t data_offset;
+	uint64_t data_bytes;
+};
+
+/** Description of a column of a binary frame file */
+struct data_binary_column
+{
+	/** The enum column_datatype_t of the column */
+	int32_t datatype;
+	uint32_t reserved;
+
+	/** Smallest and largest value of the column, min > max if there is none */
+	double min;
+	double max;
+};
 
 /**
- * Calculates the memory occupied by one row and determines the
- * column offsets.
+ * Extends the range of a column by the given values.
  *
- * @param d
- * @return the number of bytes occupied by one row.
+ * @param c
+ * @param datatype
+ * @param values
+ * @param stride the distance in bytes between two values
+ * @param n the number of values
  */
-static size_t data_sizeof_row_and_set_column_offsets(data_t *d)
+static void data_binary_column_range(struct data_binary_column *c, enum column_datatype_t datatype, const uint8_t *values, size_t stride, uint32_t n)
 {
-	int col;
-	size_t size = 0;
+	uint32_t i;
 
-	for (col=0;col<d->num_columns;col++)
+	for (i=0;i<n;i++)
 	{
-		d->column_offsets[col] = size;
-		switch (d->column_datatype[col])
-		{
-			case	INT32: size += sizeof(int32_t); break;
-			case	DOUBLE: size += sizeof(double); break;
-			default: break;
-		}
+		double v = data_value_double(datatype,&values[i * stride]);
+
+		/* NaNs are ignored */
+		if (v < c->min) c->min = v;
+		if (v > c->max) c->max = v;
 	}
-	return size;
 }
 
 /**
- * Initializes a given block.
+ * Writes the rows of a frame that are stored in the external file in the
+ * layout of a binary frame file, i.e., as a single block.
  *
- * @param b
  * @param d
- * @param block_bytes
+ * @param f the binary frame file
+ * @param columns where the ranges of the columns are accumulated
  * @return 0 on success, else an error.
  */
-static int data_initialize_block(block_t *b, data_t *d, uint32_t block_bytes)
+static int data_binary_write_external(data_t *d, FILE *f, struct data_binary_column *columns)
 {
 	int err = -1;
-	if (!(b->block = (uint8_t*)malloc(block_bytes)))
+	uint32_t bpr = d->num_bytes_per_row;
+	uint32_t cap = d->ib.num_rows;
+	uint8_t *buf = NULL;
+	uint8_t *rows = NULL;
+	uint32_t r, m;
+	int fd;
+	int col;
+
+	/* The input block holds the most recent version of its rows */
+	if ((err = data_write_input_block(d)))
+		goto out;
+	err = -1;
+	if (fflush(d->tmp))
 		goto out;
+	fd = fileno(d->tmp);
 
-	b->num_rows = block_bytes / d->num_bytes_per_row;
-	b->row_offset = 0;
-	b->current_row = 0;
+	if (!(buf = (uint8_t*)malloc(MAX(DATA_BINARY_COPY_BYTES,bpr))))
+		goto out;
+	if (d->spill_compression && d->layout == LAYOUT_COLUMNS && !(rows = (uint8_t*)malloc(MAX(DATA_BINARY_COPY_BYTES,bpr))))
+		goto out;
 
-	D("Initialized block %p with %d rows of storage\n",b,b->num_rows);
+	if (d->layout == LAYOUT_ROWS)
+	{
+		for (r=0;r<d->num_rows;r+=m)
+		{
+			m = MIN(d->num_rows - r,MAX(DATA_BINARY_COPY_BYTES / bpr,1));
+			if ((err = data_pread_rows(d,fd,buf,r,m)))
+				goto out;
+			err = -1;
+			for (col=0;col<d->num_columns;col++)
+				data_binary_column_range(&columns[col],d->column_datatype[col],&buf[d->column_offsets[col]],bpr,m);
+			if (fwrite(buf,bpr,m,f) != m)
+				goto out;
+		}
+	} else
+	{
+		/* The values of each column are gathered from all blocks */
+		for (col=0;col<d->num_columns;col++)
+		{
+			uint32_t size = data_column_size(d,col);
+
+			for (r=0;r<d->num_rows;r+=m)
+			{
+				uint32_t rel = r % cap;
+				off_t offset = (off_t)(r - rel) * bpr + (off_t)cap * d->column_offsets[col] + (off_t)rel * size;
+
+				m = MIN(MIN(d->num_rows - r,cap - rel),DATA_BINARY_COPY_BYTES / size);
+				if (d->spill_compression)
+				{
+					/* The column is gathered from decoded rows */
+					m = MIN(m,MAX(DATA_BINARY_COPY_BYTES / bpr,1));
+					if ((err = data_pread_rows(d,fd,rows,r,m)))
+						goto out;
+					data_copy_values(buf,size,&rows[d->column_offsets[col]],bpr,size,m);
+				} else if ((err = file_pio(fd,buf,(size_t)m * size,offset,0)))
+					goto out;
+				err = -1;
+				data_binary_column_range(&columns[col],d->column_datatype[col],buf,size,m);
+				if (fwrite(buf,size,m,f) != m)
+					goto out;
+			}
+		}
+	}
 	err = 0;
 out:
+	free(rows);
+	free(buf);
 	return err;
 }
 
 /**
- * Write the contents of the input block to disk.
+ * Writes all rows of the frame in their current order to a binary frame
+ * file, from which data_load_binary() can restore the frame without any
+ * parsing. If the rows are known to be sorted, e.g., because they have
+ * been sorted by data_stat_callback() with keep_sorted set, this is
+ * recorded, so they aren't sorted again. Aggregated rows are expanded
+ * first. The file is written under a temporary name and renamed when
+ * complete, so concurrent readers never see a partial file.
  *
  * @param d
+ * @param filename
+ * @param key optional string that identifies the source of the rows,
+ *  e.g., the input file and the loaded columns, or NULL.
  * @return 0 on success, else an error.
  */
-static int data_write_input_block(data_t *d)
+int data_save_binary(data_t *d, const char *filename, const char *key)
 {
-	int err;
-	block_t *b = &d->ib;
+	int err = -1;
+	char *tmp_name = NULL;
+	FILE *f = NULL;
+	struct data_binary_header header;
+	struct data_binary_column *columns = NULL;
+	size_t tmp_name_size;
+	uint64_t meta_bytes;
+	int32_t v;
+	int i;
 
+	if ((err = data_expand_aggregate(d)))
+		return err;
 	err = -1;
 
-	if (!d->tmp)
+	memset(&header,0,sizeof(header));
+	memcpy(header.magic,DATA_BINARY_MAGIC,sizeof(header.magic));
+	header.version = DATA_BINARY_VERSION;
+	header.byte_order = DATA_BINARY_BYTE_ORDER;
+	header.layout = d->layout;
+	header.num_columns = d->num_columns;
+	header.num_input_columns = d->num_input_columns;
+	header.num_rows = d->num_rows;
+	header.num_sorted_columns = d->num_sorted_columns;
+	header.key_bytes = key ? strlen(key) : 0;
+	header.data_bytes = (uint64_t)d->num_rows * d->num_bytes_per_row;
+	meta_bytes = sizeof(header) + (uint64_t)header.num_columns * sizeof(columns[0]) +
+			(uint64_t)header.num_sorted_columns * sizeof(v) + header.key_bytes;
+	header.data_offset = (meta_bytes + DATA_BINARY_ALIGNMENT - 1) / DATA_BINARY_ALIGNMENT * DATA_BINARY_ALIGNMENT;
+
+	if (!(columns = (struct data_binary_column*)calloc(MAX(d->num_columns,1),sizeof(columns[0]))))
+		goto out;
+	for (i=0;i<d->num_columns;i++)
 	{
-		if (!(d->tmp = fopen(d->filename,"w+")))
-			goto out;
+		columns[i].datatype = d->column_datatype[i];
+		columns[i].min = INFINITY;
+		columns[i].max = -INFINITY;
 	}
 
-	if (fseek(d->tmp,d->num_bytes_per_row * b->row_offset,SEEK_SET))
-	{
-		fprintf(stderr,"Seek failed\n");
+	tmp_name_size = strlen(filename) + 32;
+	if (!(tmp_name = (char*)malloc(tmp_name_size)))
 		goto out;
-	}
-	D("Writing to %x (offset %d) length %x\n",(unsigned int)ftell(d->tmp),b->row_offset,d->num_bytes_per_row * b->row_offset);
-	if ((fwrite(b->block,d->num_bytes_per_row,b->num_rows,d->tmp) != b->num_rows ))
+	snprintf(tmp_name,tmp_name_size,"%s.%ld.tmp",filename,(long)getpid());
+
+	if (!(f = fopen(tmp_name,"wb")))
 	{
-		fprintf(stderr,"Write failed!\n");
+		fprintf(stderr,"Couldn't open \"%s\" for writing\n",tmp_name);
 		goto out;
 	}
-	err = 0;
-out:
-	return err;
-}
 
+	/* The rows go first, the header follows once the ranges are known */
+	if (fseeko(f,header.data_offset,SEEK_SET))
+		goto write_failed;
+	if (d->tmp)
+	{
+		if (data_binary_write_external(d,f,columns))
+			goto write_failed;
+	} else if (d->num_rows)
+	{
+		for (i=0;i<d->num_columns;i++)
+		{
+			uint32_t size = data_column_size(d,i);
 
-/**
- * Prepare the data for next row and determine buffers
- * where it can be stored.
- *
- * @param out the pointer to a location in which the values of the next
- *  row can be stored.
- * @param d
- * @return 0 on success, else an error.
- */
-int data_insert_row_prolog(uint8_t **out, data_t* d)
-{
-	int err = -1;
+			if (d->layout == LAYOUT_ROWS)
+			{
+				data_binary_column_range(&columns[i],d->column_datatype[i],&d->ib.block[d->column_offsets[i]],d->num_bytes_per_row,d->num_rows);
+				continue;
+			}
+			data_binary_column_range(&columns[i],d->column_datatype[i],data_block_entry(d,d->ib.block,0,i),size,d->num_rows);
+			if (fwrite(data_block_entry(d,d->ib.block,0,i),size,d->num_rows,f) != d->num_rows)
+				goto write_failed;
+		}
+		if (d->layout == LAYOUT_ROWS && fwrite(d->ib.block,d->num_bytes_per_row,d->num_rows,f) != d->num_rows)
+			goto write_failed;
+	}
 
-	if (!d->ib.block)
+	if (fseeko(f,0,SEEK_SET) || fwrite(&header,sizeof(header),1,f) != 1 ||
+			fwrite(columns,sizeof(columns[0]),header.num_columns,f) != header.num_columns)
+		goto write_failed;
+	for (i=0;i<d->num_sorted_columns;i++)
 	{
-		d->num_bytes_per_row = data_sizeof_row_and_set_column_offsets(d);
-		if ((err = data_initialize_block(&d->ib, d, d->ib_bytes)))
-			goto out;
+		v = d->sorted_columns[i];
+		if (fwrite(&v,sizeof(v),1,f) != 1)
+			goto write_failed;
 	}
+	if (header.key_bytes && fwrite(key,1,header.key_bytes,f) != header.key_bytes)
+		goto write_failed;
 
-	if (d->ib.current_relative_row >= d->ib.num_rows)
+	err = fclose(f);
+	f = NULL;
+	if (err)
+		goto write_failed;
+	err = -1;
+
+	if (rename(tmp_name,filename))
 	{
-		data_write_input_block(d);
-		d->ib.row_offset += d->ib.num_rows;
-		d->ib.current_relative_row = 0;
+		fprintf(stderr,"Couldn't rename \"%s\" to \"%s\"\n",tmp_name,filename);
+		goto out;
 	}
-	*out = d->ib.block + d->ib.current_relative_row * d->num_bytes_per_row;
+	free(tmp_name);
+	tmp_name = NULL;
 	err = 0;
+	goto out;
+
+write_failed:
+	err = -1;
+	fprintf(stderr,"Writing \"%s\" failed\n",tmp_name);
 out:
+	if (f) fclose(f);
+	if (tmp_name)
+	{
+		remove(tmp_name);
+		free(tmp_name);
+	}
+	free(columns);
 	return err;
 }
 
 /**
- * Insert a single row.
+ * Determines whether the given file is a binary frame file.
+ *
+ * @param filename
+ * @return whether the file starts like a binary frame file.
+ */
+int data_is_binary_file(const char *filename)
+{
+	char magic[sizeof(DATA_BINARY_MAGIC) - 1];
+	int fd;
+	int is_binary;
+
+	if ((fd = open(filename,O_RDONLY)) < 0)
+		return 0;
+	is_binary = !file_pio(fd,(uint8_t*)magic,sizeof(magic),0,0) && !memcmp(magic,DATA_BINARY_MAGIC,sizeof(magic));
+	close(fd);
+	return is_binary;
+}
+
+/**
+ * Opens a binary frame file written by data_save_binary(). The rows are
+ * not read but mapped into memory privately, so the frame can be sorted
+ * without modifying the file, but no rows can be inserted. The frame
+ * must be empty but may have been configured, e.g., by
+ * data_set_weight_columns(). A subsequent data_stat_callback() with the
+ * columns by which the rows were saved sorted doesn't sort them again.
  *
  * @param d
- * @param row
- * @return 0 on success, else an error.
+ * @param filename
+ * @param key must be equal to the key that was passed to data_save_binary(),
+ *  or NULL to accept any key.
+ * @return 0 on success, 1 if the file doesn't exist or was saved with
+ *  another key, else an error.
  */
-int data_insert_row(data_t *d, uint8_t *row)
+int data_load_binary(data_t *d, const char *filename, const char *key)
 {
 	int err = -1;
-	uint8_t *buf;
+	int fd = -1;
+	uint8_t *meta = NULL;
+	uint8_t *map = MAP_FAILED;
+	struct data_binary_header header;
+	struct data_binary_column *columns;
+	int32_t *sorted;
+	uint64_t meta_bytes;
+	struct stat st;
+	int initialized = 0;
+	int i;
 
-	if ((err = data_insert_row_prolog(&buf,d)))
+	if (d->column_datatype || d->num_rows)
+	{
+		fprintf(stderr,"Only an empty frame can be loaded from a binary file\n");
 		goto out;
+	}
 
-	memcpy(buf,row,d->num_bytes_per_row);
+	if ((fd = open(filename,O_RDONLY)) < 0)
+	{
+		err = errno == ENOENT ? 1 : -1;
+		goto out;
+	}
 
-	d->num_rows++;
-	d->ib.current_relative_row++;
+	if (fstat(fd,&st) || st.st_size < sizeof(header) || file_pio(fd,(uint8_t*)&header,sizeof(header),0,0) ||
+			memcmp(header.magic,DATA_BINARY_MAGIC,sizeof(header.magic)))
+	{
+		fprintf(stderr,"\"%s\" is not a binary frame file\n",filename);
+		goto out;
+	}
 
-	err = 0;
-out:
-	return err;
-}
+	if (header.version != DATA_BINARY_VERSION || header.byte_order != DATA_BINARY_BYTE_ORDER ||
+			(header.layout != LAYOUT_ROWS && header.layout != LAYOUT_COLUMNS))
+	{
+		fprintf(stderr,"\"%s\" has an unsupported version or byte order\n",filename);
+		goto out;
+	}
 
-/**
- * Insert a single row using a list of variable arguments.
- *
- * @param d the data frame in which to insert the row.
- * @return 0 on success, else an error.
- */
-int data_insert_row_v(data_t *d, ...)
-{
-	int err = -1;
-	int col;
-	uint8_t *buf;
+	meta_bytes = sizeof(header) + (uint64_t)header.num_columns * sizeof(columns[0]) +
+			(uint64_t)header.num_sorted_columns * sizeof(sorted[0]) + header.key_bytes;
+	if (meta_bytes > header.data_offset || header.data_offset % DATA_BINARY_ALIGNMENT ||
+			header.data_offset + header.data_bytes > (uint64_t)st.st_size)
+	{
+		fprintf(stderr,"\"%s\" is truncated\n",filename);
+		goto out;
+	}
 
-	va_list vl;
+	if (!(meta = (uint8_t*)malloc(meta_bytes)))
+		goto out;
+	if (file_pio(fd,meta,meta_bytes,0,0))
+		goto out;
+	columns = (struct data_binary_column*)&meta[sizeof(header)];
+	sorted = (int32_t*)&columns[header.num_columns];
 
-	if ((err = data_insert_row_prolog(&buf,d)))
+	if (key && (header.key_bytes != strlen(key) || memcmp(&meta[meta_bytes - header.key_bytes],key,header.key_bytes)))
+	{
+		err = 1;
 		goto out;
+	}
 
-	va_start(vl,d);
+	initialized = 1;
+	if ((err = data_set_number_of_columns(d,header.num_columns)))
+		goto out;
+	err = -1;
 
-	for (col=0;col<d->num_columns;col++)
+	for (i=0;i<header.num_columns;i++)
 	{
-		switch (d->column_datatype[col])
+		if (!data_datatype_size(columns[i].datatype))
 		{
-			case	INT32:
-					{
-						int32_t v = va_arg(vl,int32_t);
-						*((int32_t*)buf) = v;
-						buf += sizeof(v);
-					}
-					break;
+			fprintf(stderr,"\"%s\" has an unknown datatype\n",filename);
+			goto out;
+		}
+		data_set_column_datatype(d,i,columns[i].datatype);
+	}
+	for (i=0;i<header.num_sorted_columns;i++)
+	{
+		if (abs(sorted[i]) >= header.num_columns)
+		{
+			fprintf(stderr,"\"%s\" has an invalid sort column\n",filename);
+			goto out;
+		}
+	}
 
-			case	DOUBLE:
-					{
-						double v = va_arg(vl,double);
-						*((double*)buf) = v;
-						buf += sizeof(v);
-					}
-					break;
-			default: goto out;
+	d->layout = header.layout;
+	d->num_bytes_per_row = data_sizeof_row_and_set_column_offsets(d);
+	if (header.data_bytes != (uint64_t)header.num_rows * d->num_bytes_per_row)
+	{
+		fprintf(stderr,"\"%s\" has an invalid number of rows\n",filename);
+		goto out;
+	}
+
+	/* An empty frame may still be filled */
+	if (header.num_rows)
+	{
+		d->map_bytes = header.data_offset + header.data_bytes;
+		if ((map = (uint8_t*)mmap(NULL,d->map_bytes,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0)) == MAP_FAILED)
+		{
+			fprintf(stderr,"Couldn't map \"%s\"\n",filename);
+			goto out;
 		}
+		d->map = map;
+		d->ib.block = &map[header.data_offset];
+		d->ib.num_rows = header.num_rows;
+		d->ib.current_relative_row = header.num_rows;
+		d->num_rows = header.num_rows;
 	}
-	d->num_rows++;
-	d->ib.current_relative_row++;
+	d->num_input_columns = header.num_input_columns;
+	d->agg.expanded = 1;
 
+	if ((err = data_set_sorted_columns(d,header.num_sorted_columns,sorted)))
+		goto out;
 	err = 0;
 out:
-	va_end(vl);
+	if (err && initialized)
+	{
+		/* Leaves the frame empty again */
+		if (d->map)
+			munmap(d->map,d->map_bytes);
+		free(d->column_datatype);
+		free(d->column_offsets);
+		d->map = NULL;
+		d->column_datatype = NULL;
+		d->column_offsets = NULL;
+		memset(&d->ib,0,sizeof(d->ib));
+		d->num_columns = 0;
+		d->num_rows = 0;
+		d->num_sorted_columns = 0;
+		d->layout = LAYOUT_ROWS;
+		d->agg.expanded = 0;
+	}
+	if (fd >= 0) close(fd);
+	free(meta);
 	return err;
 }
 
 /**
- * Loads from the given file a data frame in to an already
- * created (vanilla) data frame.
+ * Loads the given columns from the given binary frame file into several
+ * already created (vanilla) data frames, like data_load_from_ascii_split()
+ * does for TSV files. As nothing has to be parsed, the rows are merely
+ * copied. If the rows of the file are sorted by columns that the frames
+ * contain, the frames are known to be sorted accordingly.
  *
- * @param d the result as returned by data_create().
+ * @param frames the frames as returned by data_create().
+ * @param num_frames the number of frames
  * @param filename the file from which to read
+ * @param num_cols the number of columns of each frame
+ * @param cols the (0-based) columns of the file
  * @return 0 on success, else an error.
  */
-int data_load_from_ascii(data_t *d, const char *filename)
+int data_load_from_binary_split(data_t **frames, int num_frames, const char *filename, int num_cols, const int *cols)
 {
-	int i;
+	data_t *d = NULL;
+	uint8_t *rows = NULL;
+	uint32_t r, n;
 	int err = -1;
-	struct fio fio;
-	int pro_header = 0;
-	int con_header = 0;
-	int ncols = 1;
-	enum column_datatype_t *column_types = NULL;
-	uint8_t *row = NULL;
+	int i, j, k;
 
-	size_t len ;
-	const char *line;
-	int linenr = 1; /* 1-based */
-	int first_data_line = 0;
+	if (num_frames <= 0 || num_cols <= 0)
+		return -1;
 
-	if ((err = fio_init_by_file(&fio,filename)))
+	if ((err = data_create(&d)))
+		goto out;
+	if ((err = data_load_binary(d,filename,NULL)))
 	{
-		fprintf(stderr,"Couldn't open \"%s\"\n",filename);
+		if (err == 1)
+			fprintf(stderr,"Couldn't open \"%s\"\n",filename);
+		err = -1;
 		goto out;
 	}
+	err = -1;
 
-	line = fio.first_lines[0];
-	len = strlen(line);
-
-	/* Guess, if this is a header, also determine number of columns */
-	for (i=0;i<len;i++)
+	for (i=0;i<num_frames * num_cols;i++)
 	{
-		if (line[i] == '\t')
-			ncols++;
-		else
+		if (cols[i] < 0 || cols[i] >= d->num_columns)
 		{
-			if (line[i] == '-' || line[i] == 'e' || line[i] == 'E' || line[i] == '.' || isdigit((int)line[i]))
-			{
-				pro_header++;
-				con_header++;
-			} else
-			{
-				pro_header++;
-			}
+			fprintf(stderr,"Column %d is out of bounds\n",cols[i]);
+			goto out;
 		}
 	}
 
-	if (pro_header > con_header)
+	if (!(d->split_columns = (int*)malloc(sizeof(d->split_columns[0]) * num_frames * num_cols)))
+		goto out;
+	memcpy(d->split_columns,cols,sizeof(d->split_columns[0]) * num_frames * num_cols);
+	d->split_frames = frames;
+	d->num_split_frames = num_frames;
+	d->num_split_columns = num_cols;
+	if ((err = data_split_init(d)))
+		goto out;
+	err = -1;
+
+	if (d->layout == LAYOUT_COLUMNS && !(rows = (uint8_t*)malloc((size_t)DATA_LOAD_BATCH_ROWS * d->num_bytes_per_row)))
+		goto out;
+
+	for (r=0;r<d->num_rows;r+=n)
 	{
-		first_data_line = 1;
-		if ((err = fio_read_next_line(&line,&fio)))
+		n = MIN(d->num_rows - r,DATA_LOAD_BATCH_ROWS);
+		if (d->layout == LAYOUT_COLUMNS)
+			data_block_get_rows(d,d->ib.block,r,rows,n);
+		if ((err = data_load_insert_rows(d,rows ? rows : &d->ib.block[(size_t)r * d->num_bytes_per_row],n)))
 			goto out;
 	}
-	else
-		first_data_line = 0;
-
-	/* Determine columns */
-	int ln;
-
-	if (!(column_types = (enum column_datatype_t*)calloc(ncols,sizeof(column_types[0]))))
-		goto out;
 
-	for (ln = first_data_line; ln < FIO_FIRST_LINES && ((line = fio.first_lines[ln])); ln++)
+	/* The order of the rows is kept, so each frame is sorted by the
+	 * leading sort columns of the file that it contains */
+	for (i=0;i<num_frames && d->num_sorted_columns;i++)
 	{
-		int is_double = 0;
-		int col = 0;
-		len = strlen(line);
+		const int *frame_cols = &cols[i * num_cols];
+		int sorted[d->num_sorted_columns];
 
-		for (i=0;i<len;i++)
+		if (data_is_aggregated(frames[i]))
+			continue;
+		for (k=0;k<d->num_sorted_columns;k++)
 		{
-			if (line[i] == '\t' || line[i] == '\n')
-			{
-				enum column_datatype_t newt = INT32;
-				if (is_double) newt = DOUBLE;
+			int col = abs(d->sorted_columns[k]);
 
-				if (column_types[col] == UNKNOWN || newt == DOUBLE)
-					column_types[col] = newt;
+			for (j=0;j<num_cols && frame_cols[j] != col;j++);
+			if (j == num_cols || (!j && d->sorted_columns[k] < 0))
+				break;
+			sorted[k] = d->sorted_columns[k] < 0 ? -j : j;
+		}
+		if (k && (err = data_set_sorted_columns(frames[i],k,sorted)))
+			goto out;
+	}
+	err = 0;
+out:
+	free(rows);
+	data_free(d);
+	return err;
+}
 
-				col++;
-				is_double = 0;
-			} else
-			{
-				if (line[i] == '-' || line[i] == 'e' || line[i] == 'E' || line[i] == '.')
-					is_double = 1;
-			}
+/** State of the determination of the statistics */
+/** Number of rows that are accounted for the bootstrap replicates at once */
+#define DATA_BOOTSTRAP_BATCH_ROWS 65536
+
+/** Flags of a row of a bootstrap batch */
+#define DATA_BOOTSTRAP_POSITIVE 1
+#define DATA_BOOTSTRAP_TIE 2
+
+/** Largest weight of a row within a replicate */
+#define DATA_BOOTSTRAP_MAX_WEIGHT 15
+
+/** Largest weight of a weighted row that is resampled exactly, see data_bootstrap_poisson() */
+#define DATA_BOOTSTRAP_MAX_EXACT 16
+
+/** Weighted counts of a bootstrap replicate, see data_stat_threshold() */
+struct data_bootstrap_replicate
+{
+	uint64_t tps;
+	uint64_t fps;
+	uint64_t threshold_tps;
+	uint64_t threshold_fps;
+
+	/** Twice the area under the ROC curve, not normalized */
+	double auc_roc;
+};
+
+/** Replicates that a thread accounts for the current batch */
+struct data_bootstrap_job
+{
+	struct data_bootstrap *bs;
+	uint32_t first_pair;
+	uint32_t last_pair;
+};
+
+/**
+ * Poisson bootstrap of the rows that are accounted in sorted order. Each row
+ * gets a Poisson(1) distributed weight within each replicate, which is
+ * derived from the identifier of the row and the replicate, so no state of a
+ * random number generator needs to be shared. Replicates are handled in pairs
+ * that share a random number.
+ *
+ * Rows that tie can come out of the sort in any order and rows that are equal
+ * may have been aggregated, so the identifier of a row doesn't depend on its
+ * position, see data_bootstrap_row_id().
+ */
+struct data_bootstrap
+{
+	uint32_t replicates;
+	uint32_t pairs;
+	uint64_t seed;
+	struct data_bootstrap_replicate *reps;
+
+	/** Row weight w is chosen if a random number is below thresholds[w] but not thresholds[w-1] */
+	uint32_t thresholds[DATA_BOOTSTRAP_MAX_WEIGHT];
+
+	/** The current batch, for weighted rows also the positive and negative weight of each row */
+	uint8_t *flags;
+	uint64_t *ids;
+	uint64_t *weights;
+	uint32_t num_rows;
+
+	/** Threads that account the replicates concurrently */
+	pthread_t *threads;
+	int num_threads;
+	struct data_bootstrap_job *jobs;
+	int num_jobs;
+	struct queue todo;
+	struct queue done;
+};
+
+/**
+ * Scrambles the bits of the given number.
+ */
+static inline uint64_t data_bootstrap_mix(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+	return z ^ (z >> 31);
+}
+
+/**
+ * Returns a 64 bit random number for the given row and stream, e.g., the
+ * pair of replicates.
+ */
+static inline uint64_t data_bootstrap_random(uint64_t seed, uint64_t row, uint64_t stream)
+{
+	return data_bootstrap_mix(seed + row * UINT64_C(0x9e3779b97f4a7c15) + stream * UINT64_C(0xd1b54a32d192ed03));
+}
+
+/**
+ * Returns the identifier of a row from which its weights in the replicates
+ * are derived.
+ *
+ * @param tie the index of the group of tied rows to which the row belongs.
+ * @param pos the positive weight of the row.
+ * @param neg the negative weight of the row.
+ * @param copy the number of rows with equal weights before the row in the group.
+ * @return the identifier.
+ */
+static inline uint64_t data_bootstrap_row_id(uint64_t tie, uint64_t pos, uint64_t neg, uint64_t copy)
+{
+	return data_bootstrap_random(data_bootstrap_random(tie,pos,neg),copy,0);
+}
+
+/**
+ * Maps a uniformly distributed 32 bit number to a Poisson(1) distributed one.
+ */
+static inline uint32_t data_bootstrap_weight(const struct data_bootstrap *bs, uint32_t u)
+{
+	uint32_t w = 0;
+	int i;
+
+	/* The thresholds are ascending, so this counts the ones that u reaches,
+	 * without branches that couldn't be predicted anyway */
+	for (i=0;i<DATA_BOOTSTRAP_MAX_WEIGHT;i++)
+		w += u >= bs->thresholds[i];
+	return w;
+}
+
+/**
+ * Returns a Poisson(lambda) distributed weight for a row with the given
+ * weight. Up to DATA_BOOTSTRAP_MAX_EXACT, this is the sum of lambda Poisson(1)
+ * distributed numbers, larger weights are approximated by a normal
+ * distribution, which is obtained as sum of 12 uniform numbers.
+ *
+ * @param bs
+ * @param lambda
+ * @param row
+ * @param stream distinguishes the replicates and the positive and negative weight.
+ * @return the weight.
+ */
+static uint64_t data_bootstrap_poisson(const struct data_bootstrap *bs, uint64_t lambda, uint64_t row, uint64_t stream)
+{
+	uint64_t w = 0;
+	uint64_t i;
+	double z = -6;
+	double x;
+
+	if (lambda <= DATA_BOOTSTRAP_MAX_EXACT)
+	{
+		for (i=0;i<lambda;i+=2)
+		{
+			uint64_t u = data_bootstrap_random(bs->seed + i * UINT64_C(0x2545f4914f6cdd1d),row,stream);
+
+			w += data_bootstrap_weight(bs,(uint32_t)u);
+			if (i + 1 < lambda)
+				w += data_bootstrap_weight(bs,(uint32_t)(u >> 32));
 		}
+		return w;
 	}
 
-	if ((err = data_set_number_of_columns(d,ncols)))
-		goto out;
+	for (i=0;i<6;i++)
+	{
+		uint64_t u = data_bootstrap_random(bs->seed + i * UINT64_C(0x2545f4914f6cdd1d),row,stream);
 
-	for (i=0;i<ncols;i++)
-		data_set_column_datatype(d,i,column_types[i]);
+		z += (uint32_t)u / 4294967296.0 + (uint32_t)(u >> 32) / 4294967296.0;
+	}
+	x = lambda + sqrt((double)lambda) * z + 0.5;
+	return x > 0 ? (uint64_t)x : 0;
+}
 
-	if (!(row = (uint8_t*)malloc(data_sizeof_row_and_set_column_offsets(d))))
-		goto out;
+/**
+ * Accounts a row for a replicate.
+ */
+static inline void data_bootstrap_put(struct data_bootstrap_replicate *r, uint8_t flags, uint64_t w)
+{
+	uint64_t positive = -(uint64_t)(flags & DATA_BOOTSTRAP_POSITIVE);
 
-	linenr = first_data_line;
+	if (!(flags & DATA_BOOTSTRAP_TIE))
+	{
+		/* Trapezoid between the current and the previous threshold */
+		r->auc_roc += (double)(r->fps - r->threshold_fps) * (double)(r->tps + r->threshold_tps);
+		r->threshold_tps = r->tps;
+		r->threshold_fps = r->fps;
+	}
+
+	r->tps += w & positive;
+	r->fps += w & ~positive;
+}
 
-	D("Identified %d columns\n",ncols);
+/**
+ * Accounts the current batch for the given pairs of replicates.
+ *
+ * @param bs
+ * @param first_pair
+ * @param last_pair the pair after the last one.
+ */
+static void data_bootstrap_process(struct data_bootstrap *bs, uint32_t first_pair, uint32_t last_pair)
+{
+	uint32_t p;
+	uint32_t r;
 
-	while (!(err = fio_read_next_line(&line,&fio)))
+	if (bs->weights)
 	{
-		int pos = 0;
-		int row_pos = 0;
-
-		linenr++;
+		uint32_t i;
 
-		for (i=0;i<ncols;i++)
+		for (i=2*first_pair;i<2*last_pair;i++)
 		{
-			enum column_datatype_t ct = column_types[i];
+			struct data_bootstrap_replicate rep = bs->reps[i];
 
-			switch (ct)
+			for (r=0;r<bs->num_rows;r++)
 			{
-				case	INT32:
-						{
-							long v;
-							char *end;
-							v = strtol(&line[pos],&end,10);
-							*((int32_t*)&row[row_pos]) = v;
-							row_pos += sizeof(int32_t);
-							pos = end - line;
-							break;
-						}
-
-				case	DOUBLE:
-						{
-							double v;
-							char *end;
-							v = strtod(&line[pos],&end);
-							*((double*)&row[row_pos]) = v;
-							row_pos += sizeof(double);
-							pos = end - line;
-							break;
-						}
-				default:
-						fprintf(stderr,"Unknown column type at line %d in column %d\n",linenr,i);
-						goto out;
+				uint64_t row = bs->ids[r];
+				uint64_t tps = data_bootstrap_poisson(bs,bs->weights[2*r],row,2*(uint64_t)i);
+				uint64_t fps = data_bootstrap_poisson(bs,bs->weights[2*r+1],row,2*(uint64_t)i+1);
 
+				/* Closes the previous threshold if needed and adds the positive weight */
+				data_bootstrap_put(&rep,bs->flags[r] | DATA_BOOTSTRAP_POSITIVE,tps);
+				rep.fps += fps;
 			}
-
-			while (line[pos] && line[pos] != '\t')
-				pos++;
+			bs->reps[i] = rep;
 		}
-		if ((err = data_insert_row(d,row)))
-			goto out;
+		return;
 	}
 
-	err = 0;
-out:
-	free(column_types);
-	free(row);
-	fio_deinit(&fio);
-	return err;
+	for (p=first_pair;p<last_pair;p++)
+	{
+		struct data_bootstrap_replicate a = bs->reps[2*p];
+		struct data_bootstrap_replicate b = bs->reps[2*p+1];
+		uint64_t stream = data_bootstrap_random(bs->seed,0,p);
+
+		for (r=0;r<bs->num_rows;r++)
+		{
+			/* The identifiers are random already, so mixing them once suffices */
+			uint64_t u = data_bootstrap_mix(stream + bs->ids[r]);
+
+			data_bootstrap_put(&a,bs->flags[r],data_bootstrap_weight(bs,(uint32_t)u));
+			data_bootstrap_put(&b,bs->flags[r],data_bootstrap_weight(bs,(uint32_t)(u >> 32)));
+		}
+		bs->reps[2*p] = a;
+		bs->reps[2*p+1] = b;
+	}
 }
 
-/**
- * Returns the number of columns of the data frame.
- *
- * @param d the data frame in question
- * @return the number of columns
- */
-uint32_t data_get_number_of_columns(data_t *d)
+static void *data_bootstrap_thread(void *arg)
 {
-	return d->num_columns;
+	struct data_bootstrap *bs = (struct data_bootstrap*)arg;
+	struct data_bootstrap_job *job;
+
+	while ((job = (struct data_bootstrap_job*)queue_get(&bs->todo)))
+	{
+		data_bootstrap_process(bs,job->first_pair,job->last_pair);
+		if (queue_put(&bs->done,job))
+			break;
+	}
+	return NULL;
 }
 
 /**
- * Returns the number of rows of the data frame.
+ * Frees the bootstrap and stops its threads.
  *
- * @param d the data frame in question
- * @return the number of rows
+ * @param bs
  */
-uint32_t data_get_number_of_rows(data_t *d)
+static void data_bootstrap_free(struct data_bootstrap *bs)
 {
-	return d->num_rows;
-}
+	int i;
 
+	if (!bs)
+		return;
+
+	if (bs->threads)
+	{
+		queue_close(&bs->todo);
+		queue_close(&bs->done);
+		for (i=0;i<bs->num_threads;i++)
+			pthread_join(bs->threads[i],NULL);
+		queue_free(&bs->todo);
+		queue_free(&bs->done);
+		free(bs->threads);
+	}
+	free(bs->jobs);
+	free(bs->weights);
+	free(bs->ids);
+	free(bs->flags);
+	free(bs->reps);
+	free(bs);
+}
 
 /**
- * Read the block starting at row in the block.
+ * Creates the bootstrap for the given frame.
  *
- * @param d the data frame associated with the block
- * @param b the block where to store the result of the read operation.
- * @param row the index of the row.
+ * @param out where the bootstrap is stored.
+ * @param d
  * @return 0 on success, else an error.
  */
-static int data_read_block_for_row(data_t *d, block_t *b, int row)
+static int data_bootstrap_create(struct data_bootstrap **out, data_t *d)
 {
-	int err = -1;
+	struct data_bootstrap *bs;
+	double p = 0.36787944117144233; /* exp(-1) */
+	double cdf = 0;
+	int num_jobs;
+	int i;
 
-	fseek(d->tmp, row * d->num_bytes_per_row, SEEK_SET);
-	D("Reading from %x (offset %d)\n", (unsigned int)ftell(d->tmp), row);
-	if (fread(b->block, d->num_bytes_per_row, b->num_rows, d->tmp) == 0)
+	if (!(bs = (struct data_bootstrap*)calloc(1,sizeof(*bs))))
+		return -1;
+
+	bs->replicates = d->bootstrap_replicates;
+	bs->pairs = (bs->replicates + 1) / 2;
+	bs->seed = d->bootstrap_seed;
+
+	for (i=0;i<DATA_BOOTSTRAP_MAX_WEIGHT;i++)
 	{
-		fprintf(stderr,"Reading row %d failed!\n",row);
-		goto out;
+		cdf += p;
+		p /= i + 1;
+		bs->thresholds[i] = cdf >= 1 ? UINT32_MAX : (uint32_t)(cdf * 4294967296.0);
+	}
+
+	num_jobs = MAX(1,MIN(d->num_threads,bs->pairs));
+	bs->num_jobs = num_jobs;
+	if (!(bs->reps = (struct data_bootstrap_replicate*)calloc(2 * bs->pairs,sizeof(bs->reps[0]))))
+		goto bailout;
+	if (!(bs->flags = (uint8_t*)malloc(DATA_BOOTSTRAP_BATCH_ROWS)))
+		goto bailout;
+	if (!(bs->ids = (uint64_t*)malloc(sizeof(bs->ids[0]) * DATA_BOOTSTRAP_BATCH_ROWS)))
+		goto bailout;
+	if (data_weights_col(d) >= 0 && !(bs->weights = (uint64_t*)malloc(sizeof(bs->weights[0]) * 2 * DATA_BOOTSTRAP_BATCH_ROWS)))
+		goto bailout;
+	if (!(bs->jobs = (struct data_bootstrap_job*)malloc(sizeof(bs->jobs[0]) * num_jobs)))
+		goto bailout;
+
+	for (i=0;i<num_jobs;i++)
+	{
+		bs->jobs[i].bs = bs;
+		bs->jobs[i].first_pair = (uint64_t)bs->pairs * i / num_jobs;
+		bs->jobs[i].last_pair = (uint64_t)bs->pairs * (i + 1) / num_jobs;
 	}
-	b->row_offset = row;
-	err = 0;
-out:
-	return err;
 
+	/* The calling thread processes the first job itself */
+	if (num_jobs > 1)
+	{
+		if (queue_init(&bs->todo,num_jobs))
+			goto bailout;
+		if (queue_init(&bs->done,num_jobs))
+		{
+			queue_free(&bs->todo);
+			goto bailout;
+		}
+		if (!(bs->threads = (pthread_t*)malloc(sizeof(bs->threads[0]) * (num_jobs - 1))))
+		{
+			queue_free(&bs->todo);
+			queue_free(&bs->done);
+			goto bailout;
+		}
+		for (i=1;i<num_jobs;i++)
+		{
+			if (pthread_create(&bs->threads[bs->num_threads],NULL,data_bootstrap_thread,bs))
+				break;
+			bs->num_threads++;
+		}
+	}
+
+	*out = bs;
+	return 0;
+
+bailout:
+	data_bootstrap_free(bs);
+	return -1;
 }
 
 /**
- * Read the contents of the given row to the input block.
+ * Accounts the current batch for all replicates.
  *
- * @param d the associated data frame.
- * @param row
+ * @param bs
  * @return 0 on success, else an error.
  */
-static int data_read_input_block_for_row(data_t *d, int row)
+static int data_bootstrap_flush(struct data_bootstrap *bs)
 {
-	int err = -1;
-	uint32_t new_row_offset_of_block;
+	int err = 0;
+	int i;
 
-	new_row_offset_of_block = (row / d->ib.num_rows) * d->ib.num_rows;
-	if (new_row_offset_of_block != d->ib.row_offset)
+	if (!bs->num_rows)
+		return 0;
+
+	for (i=0;i<bs->num_threads;i++)
 	{
-		data_write_input_block(d);
-		if ((err = data_read_block_for_row(d, &d->ib, new_row_offset_of_block)))
-			goto out;
+		if (queue_put(&bs->todo,&bs->jobs[i + 1]))
+			err = -1;
 	}
-	err = 0;
-out:
+	data_bootstrap_process(bs,bs->jobs[0].first_pair,bs->jobs[0].last_pair);
+
+	/* Jobs for which no thread could be created are done here */
+	for (i=bs->num_threads + 1;i<bs->num_jobs;i++)
+		data_bootstrap_process(bs,bs->jobs[i].first_pair,bs->jobs[i].last_pair);
+	for (i=0;i<bs->num_threads;i++)
+	{
+		if (!queue_get(&bs->done))
+			err = -1;
+	}
+
+	bs->num_rows = 0;
 	return err;
 }
 
+/**************************************************************/
+
+struct data_stat_context
+{
+	int (*callback)(uint64_t ps, uint64_t ns, uint64_t tps, uint64_t fps, void *userdata);
+	void *user_data;
+	enum data_stat_points_t points;
+
+	uint64_t positives;
+	uint64_t negatives;
+
+	/** Weight of the true and false positives seen so far */
+	uint64_t tps;
+	uint64_t fps;
+
+	/** Sort columns of the current and the previous row, to detect ties */
+	uint8_t *row;
+	uint8_t *last_row;
+	int has_last_row;
+
+	/** True and false positives at the previous threshold */
+	uint64_t threshold_tps;
+	uint64_t threshold_fps;
+	double threshold_precision;
+
+	/** For POINTS_CORNERS, the last point that was passed to the callback and the one that may follow */
+	uint64_t corner_tps;
+	uint64_t corner_fps;
+	uint64_t pending_tps;
+	uint64_t pending_fps;
+	int has_pending;
+
+	/** The number of rows of the current group of tied rows and the index of the group */
+	uint64_t tie_count;
+	uint64_t tie_index;
+
+	/** The bootstrap, if any, see data_set_bootstrap() */
+	struct data_bootstrap *bootstrap;
+
+	/** Set if accounting a row failed */
+	int err;
+
+	/** Accumulated measures, see data_stat_threshold() */
+	double auc_roc;
+	double average_precision;
+	double auc_pr;
+	double ks;
+	double max_f1;
+};
+
 /**
- * Determine the pointer to the given column/row. May read the associated
- * block if the element is currently not in the input block.
+ * Passes the point that has been reached at a threshold to the callback.
+ * For POINTS_CORNERS, the point is held back until it is known whether it
+ * lies on the line between its neighbors.
  *
- * @param out where to store the pointer.
- * @param d the associatated data frame.
- * @param i the row
- * @param j the column
- * @return 0 on success, else an error.
+ * @param ctx
+ * @param tps
+ * @param fps
  */
-static int data_get_buf_ptr(uint8_t **out, data_t *d, int i, int j)
+static void data_stat_point(struct data_stat_context *ctx, uint64_t tps, uint64_t fps)
 {
-	int err = -1;
-	uint8_t *buf;
-
-	if (i < d->ib.row_offset || i >= d->ib.row_offset + d->ib.num_rows)
+	if (ctx->points == POINTS_CORNERS)
 	{
-		if ((err = data_read_input_block_for_row(d,i)))
+		if (ctx->has_pending)
 		{
-			fprintf(stderr,"Couldn't read block %d\n",errno);
-			goto out;
+			uint64_t dtps1 = ctx->pending_tps - ctx->corner_tps;
+			uint64_t dfps1 = ctx->pending_fps - ctx->corner_fps;
+			uint64_t dtps2 = tps - ctx->pending_tps;
+			uint64_t dfps2 = fps - ctx->pending_fps;
+			uint64_t lo1, lo2;
+
+			/* The products of weights need 128 bits */
+			if (parse_mul128(dtps1,dfps2,&lo1) != parse_mul128(dtps2,dfps1,&lo2) || lo1 != lo2)
+			{
+				ctx->callback(ctx->positives,ctx->negatives,ctx->pending_tps,ctx->pending_fps,ctx->user_data);
+				ctx->corner_tps = ctx->pending_tps;
+				ctx->corner_fps = ctx->pending_fps;
+			}
 		}
+		ctx->pending_tps = tps;
+		ctx->pending_fps = fps;
+		ctx->has_pending = 1;
+		return;
 	}
-
-	buf = d->ib.block + (i - d->ib.row_offset) * d->num_bytes_per_row + d->column_offsets[j];
-	*out = buf;
-	err = 0;
-out:
-	return err;
+	ctx->callback(ctx->positives,ctx->negatives,tps,fps,ctx->user_data);
 }
 
-int data_get_entry_as_double(double *out, data_t *d, int i, int j)
+/**
+ * Passes the points of the rows of the current group of tied rows to the
+ * callback and the rows to the bootstrap. The points are spread evenly on
+ * the line from the previous threshold to the end of the group, as no order
+ * of the tied rows is better than another, so they are the same for each
+ * order in which the rows were sorted.
+ *
+ * Unweighted rows are passed to the bootstrap one by one, negatives first.
+ * Weighted rows are passed as a single row with the weights of the group, as
+ * the replicates only see the sums of the weights of tied rows, and a sum
+ * of Poisson distributed weights is Poisson distributed with the sum of the
+ * means. This doesn't depend on how the rows were sorted or aggregated.
+ *
+ * @param ctx
+ */
+static void data_stat_tie_flush(struct data_stat_context *ctx)
 {
-	uint8_t *buf;
-	data_get_buf_ptr(&buf,d,i,j);
-	*out = *(double*)buf;
-	return 0;
-}
+	struct data_bootstrap *bs = ctx->bootstrap;
+	uint64_t dtps = ctx->tps - ctx->threshold_tps;
+	uint64_t dfps = ctx->fps - ctx->threshold_fps;
+	uint8_t tie = 0;
+	uint64_t c;
+
+	/* The k-th of n rows reaches k/n of the weights of the group */
+	for (c=1;ctx->points == POINTS_ROWS && c<=ctx->tie_count;c++)
+	{
+		unsigned __int128 tps = (unsigned __int128)dtps * c / ctx->tie_count;
+		unsigned __int128 fps = (unsigned __int128)dfps * c / ctx->tie_count;
 
-int data_get_entry_as_int32(int32_t *out, data_t *d, int i, int j)
-{
-	uint8_t *buf;
-	data_get_buf_ptr(&buf,d,i,j);
-	*out = *(int32_t*)buf;
-	return 0;
+		ctx->callback(ctx->positives,ctx->negatives,ctx->threshold_tps + (uint64_t)tps,ctx->threshold_fps + (uint64_t)fps,ctx->user_data);
+	}
+	ctx->tie_count = 0;
+
+	if (bs && bs->weights)
+	{
+		bs->flags[bs->num_rows] = 0;
+		bs->ids[bs->num_rows] = data_bootstrap_row_id(ctx->tie_index,dtps,dfps,0);
+		bs->weights[2 * bs->num_rows] = dtps;
+		bs->weights[2 * bs->num_rows + 1] = dfps;
+		if (++bs->num_rows == DATA_BOOTSTRAP_BATCH_ROWS && data_bootstrap_flush(bs))
+			ctx->err = -1;
+	} else if (bs)
+	{
+		/* Each unweighted row counts either as positive or as negative */
+		for (c=0;c<dfps;c++)
+		{
+			bs->flags[bs->num_rows] = tie;
+			bs->ids[bs->num_rows] = data_bootstrap_row_id(ctx->tie_index,0,1,c);
+			if (++bs->num_rows == DATA_BOOTSTRAP_BATCH_ROWS && data_bootstrap_flush(bs))
+				ctx->err = -1;
+			tie = DATA_BOOTSTRAP_TIE;
+		}
+		for (c=0;c<dtps;c++)
+		{
+			bs->flags[bs->num_rows] = DATA_BOOTSTRAP_POSITIVE | tie;
+			bs->ids[bs->num_rows] = data_bootstrap_row_id(ctx->tie_index,1,0,c);
+			if (++bs->num_rows == DATA_BOOTSTRAP_BATCH_ROWS && data_bootstrap_flush(bs))
+				ctx->err = -1;
+			tie = DATA_BOOTSTRAP_TIE;
+		}
+	}
+	ctx->tie_index++;
 }
 
-static int data_sort_compare_cb(const void *a, const void *b, void *data)
+/**
+ * Accounts the point of the curves that is reached after all rows seen so
+ * far, if they end a group of rows with equal predictions. Measures are
+ * only accumulated at such thresholds, so ties are neither favored nor
+ * penalized.
+ *
+ * @param ctx
+ */
+static inline void data_stat_threshold(struct data_stat_context *ctx)
 {
-	int c;
-	data_t *d = (data_t*)data;
-	const uint8_t *ra = (const uint8_t*)a;
-	const uint8_t *rb = (const uint8_t*)b;
+	double tps = ctx->tps;
+	double fps = ctx->fps;
+	double dtps = ctx->tps - ctx->threshold_tps;
+	double dfps = ctx->fps - ctx->threshold_fps;
+	double precision;
 
-	for (c=0;c<d->num_to_sort_columns;c++)
-	{
-		int rc;
+	if (ctx->tie_count)
+		data_stat_tie_flush(ctx);
+	if (ctx->tps == ctx->threshold_tps && ctx->fps == ctx->threshold_fps)
+		return;
 
-		int col = d->to_sort_columns[c];
-		int offset = d->column_offsets[abs(col)];
+	precision = tps / (tps + fps);
 
-		double da = *(double*)(&ra[offset]);
-		double db = *(double*)(&rb[offset]);
+	/* Trapezoids between the current and the previous point */
+	ctx->auc_roc += dfps * (tps + ctx->threshold_tps);
+	ctx->auc_pr += dtps * (precision + ctx->threshold_precision);
+	ctx->average_precision += dtps * precision;
 
-		if (da > db) rc = 1;
-		else if (da < db) rc = -1;
-		else continue;
+	ctx->ks = MAX(ctx->ks,fabs(tps / ctx->positives - fps / ctx->negatives));
+	ctx->max_f1 = MAX(ctx->max_f1,2 * tps / (tps + fps + ctx->positives));
 
-		if (col < 0)
-			rc *= -1;
+	ctx->threshold_tps = ctx->tps;
+	ctx->threshold_fps = ctx->fps;
+	ctx->threshold_precision = precision;
 
-		return rc;
-	}
-	return 0;
+	if (ctx->points != POINTS_ROWS)
+		data_stat_point(ctx,ctx->tps,ctx->fps);
 }
 
 /**
- * Compare the heads of the given block.
+ * Accounts the next rows, which have equal predictions.
  *
- * @param d
- * @param a
- * @param b
- * @return -1 if a is smaller, else -1.
+ * @param ctx
+ * @param pos the weight with which the rows count as positive.
+ * @param neg the weight with which the rows count as negative.
+ * @param rows the number of rows.
+ * @param tie whether the prediction of the rows equals the one of the previous row.
  */
-static int data_sort_compare_heads_of_blocks(data_t *d, block_t *a, block_t *b)
+static inline void data_stat_put(struct data_stat_context *ctx, uint64_t pos, uint64_t neg, uint64_t rows, int tie)
 {
-	int aoff = a->current_relative_row * d->num_bytes_per_row;
-	int boff = b->current_relative_row * d->num_bytes_per_row;
-
-	if (data_sort_compare_cb(&a->block[aoff], &b->block[boff], d) < 0)
-		return -1;
-	return 1;
+	if (!tie)
+		data_stat_threshold(ctx);
+	ctx->tps += pos;
+	ctx->fps += neg;
+	ctx->tie_count += rows;
 }
 
 /**
- * Advance the head of the given block.
+ * Accounts the next row, whose weights are determined from the row.
  *
  * @param d
- * @param b
- * @return
+ * @param ctx
+ * @param row the row or the values of its sort, label and weight columns.
+ * @param tie
  */
-static int data_advance_head(data_t *d, block_t *b)
+static inline void data_stat_put_row(data_t *d, struct data_stat_context *ctx, const uint8_t *row, int tie)
 {
-	int err = -1;
+	uint64_t pos, neg;
+	int wcol = data_weights_col(d);
 
-	b->current_relative_row++;
-	b->current_row++;
+	data_row_weights(d,d->label_col,&row[d->column_offsets[d->label_col]],wcol >= 0 ? &row[d->column_offsets[wcol]] : NULL,&pos,&neg);
+	data_stat_put(ctx,pos,neg,1,tie);
+}
 
-	err = 0;
-	return err;
+/**
+ * Accounts the last threshold and passes a point that has been held back
+ * to the callback.
+ *
+ * @param ctx
+ */
+static void data_stat_finish(struct data_stat_context *ctx)
+{
+	data_stat_threshold(ctx);
+	if (ctx->has_pending)
+		ctx->callback(ctx->positives,ctx->negatives,ctx->pending_tps,ctx->pending_fps,ctx->user_data);
+	ctx->has_pending = 0;
 }
 
 /**
- * Sorts the entire data.
+ * Determines the summary from the accumulated measures.
+ *
+ * @param summary
+ * @param ctx
+ */
+static void data_stat_summarize(struct data_summary *summary, struct data_stat_context *ctx)
+{
+	summary->positives = ctx->positives;
+	summary->negatives = ctx->negatives;
+	summary->auc_roc = ctx->auc_roc / 2 / ((double)ctx->positives * ctx->negatives);
+	summary->average_precision = ctx->average_precision / ctx->positives;
+	summary->auc_pr = ctx->auc_pr / 2 / ctx->positives;
+	summary->ks = ctx->ks;
+	summary->max_f1 = ctx->max_f1;
+}
+
+/**
+ * Finishes the current group and stores its measures.
  *
  * @param d
- * @param cols
- * @param to_sort_cols
- * @return
+ * @param ctx
  */
-static int data_sort_callback(data_t *d, int cols, int *to_sort_cols, int (*callback)(data_t *d, uint8_t *row, void *user_data), void *user_data)
+static void data_stat_group_end(data_t *d, struct data_stat_context *ctx)
 {
-	int i;
-	int k;
+	struct data_group_summary *gs;
 
-	int err = -1;
+	data_stat_finish(ctx);
+	if (d->num_group_summaries == d->max_group_summaries)
+	{
+		uint32_t max = d->max_group_summaries ? d->max_group_summaries * 2 : 64;
 
-	struct progress p;
+		if (!(gs = (struct data_group_summary*)realloc(d->group_summaries,sizeof(gs[0]) * max)))
+		{
+			ctx->err = -1;
+			return;
+		}
+		d->group_summaries = gs;
+		d->max_group_summaries = max;
+	}
+	gs = &d->group_summaries[d->num_group_summaries++];
+	gs->value = d->stat_group;
+	data_stat_summarize(&gs->summary,ctx);
+}
 
-	int label_col_offset = d->column_offsets[d->label_col];
-	int64_t label_sum = 0;
+/**
+ * Starts the group of the given row, the accumulated measures are reset.
+ *
+ * @param d
+ * @param ctx
+ * @param row
+ */
+static void data_stat_group_begin(data_t *d, struct data_stat_context *ctx, const uint8_t *row)
+{
+	d->stat_group = data_group_value(d,&row[d->column_offsets[d->group_col]]);
+	if (data_groups_get(&d->groups,d->stat_group,&ctx->positives,&ctx->negatives))
+		ctx->err = -1;
+
+	ctx->tps = ctx->fps = 0;
+	ctx->threshold_tps = ctx->threshold_fps = 0;
+	ctx->threshold_precision = 1;
+	ctx->corner_tps = ctx->corner_fps = 0;
+	ctx->auc_roc = ctx->average_precision = ctx->auc_pr = 0;
+	ctx->ks = ctx->max_f1 = 0;
+}
 
-	progress_init(&p,"Sorting - first pass",d->num_rows);
+/**
+ * Determines whether the row that has been gathered in ctx->row ties with
+ * the previous one and makes it the previous one. A new group is started
+ * if the row belongs to another group than the previous one.
+ *
+ * @param d
+ * @param ctx
+ * @return whether the rows tie.
+ */
+static inline int data_stat_tie(data_t *d, struct data_stat_context *ctx)
+{
+	uint8_t *row = ctx->row;
+	int tie = ctx->has_last_row && !data_sort_compare_cb(row,ctx->last_row,d);
 
-	/* In place sort using the input block buffer */
-	for (i=0;i<d->num_rows;)
+	if (d->group_col >= 0 && !tie)
 	{
-		int rows_to_sort = MIN(d->ib.num_rows,d->num_rows - i);
-
-		if ((err = data_read_input_block_for_row(d,i)))
-			goto out;
-		qsort_r(d->ib.block,rows_to_sort,d->num_bytes_per_row,data_sort_compare_cb,d);
+		int offset = d->column_offsets[d->group_col];
 
-		for (k=0;k<rows_to_sort;k++)
+		if (!ctx->has_last_row || data_group_value(d,&row[offset]) != data_group_value(d,&ctx->last_row[offset]))
 		{
-			uint8_t *buf = &d->ib.block[k * d->num_bytes_per_row];
-			label_sum += *(int32_t*)(&buf[label_col_offset]);
-
+			if (ctx->has_last_row)
+				data_stat_group_end(d,ctx);
+			data_stat_group_begin(d,ctx,row);
 		}
+	}
 
-		i += rows_to_sort;
+	ctx->row = ctx->last_row;
+	ctx->last_row = row;
+	ctx->has_last_row = 1;
+	return tie;
+}
 
-		progress_done(&p,i);
-		progress_print(&p,0);
-	}
-	d->label_sum = label_sum;
+/**
+ * Callback for the final merge that accounts the given row.
+ */
+static int data_stat_merge_cb(data_t *d, uint8_t *row, void *user_data)
+{
+	struct data_stat_context *ctx = (struct data_stat_context*)user_data;
+	int tie;
 
-	/* Now merge sort, we only support one pass for now */
-	k = (d->num_rows + d->ib.num_rows - 1 ) / d->ib.num_rows;
-	if (k > 1)
-	{
-		/* Write possible rest of the cache */
-		if ((err = data_write_input_block(d)))
-		{
-			fprintf(stderr,"Couldn't write block\n");
-			goto out;
-		}
+	memcpy(ctx->row,row,d->num_bytes_per_row);
+	tie = data_stat_tie(d,ctx);
+	data_stat_put_row(d,ctx,row,tie);
+	return 0;
+}
+
+/**
+ * Accounts all rows of the frame in their current order.
+ *
+ * @param d
+ * @param ctx
+ * @return 0 on success, else an error.
+ */
+static int data_stat_scan(data_t *d, struct data_stat_context *ctx)
+{
+	uint32_t r;
+	uint32_t n;
+	int err = -1;
 
-		block_t *in_blocks;
-		int rows_per_in_block = d->ib.num_rows;
-		int rows_in_last_block = d->num_rows % rows_per_in_block;
-		if (rows_in_last_block == 0) rows_in_last_block = rows_per_in_block;
+	int c;
+	int num_sort_cols = d->num_to_sort_columns;
+	const uint8_t *values[num_sort_cols];
+	size_t strides[num_sort_cols];
+	int wcol = data_weights_col(d);
 
-		D("Taking k=%d fixed blocks containing %d rows, last contains %d rows\n",k,rows_per_in_block,rows_in_last_block);
+	for (r=0; r < d->num_rows; r += n)
+	{
+		const uint8_t *labels;
+		const uint8_t *weights = NULL;
+		size_t stride;
+		size_t wstride = 0;
+		uint32_t k;
 
-		if (!(in_blocks = malloc(sizeof(in_blocks[0])*k)))
-		{
-			fprintf(stderr,"Memory allocation failed!");
+		if ((err = data_get_column_values(&labels,&stride,&n,d,r,d->label_col)))
 			goto out;
-		}
-
-		memset(in_blocks,0,sizeof(in_blocks[0])*k);
-
-		/* Init in buffers */
-		for (i=0;i<k;i++)
+		if (wcol >= 0 && (err = data_get_column_values(&weights,&wstride,&n,d,r,wcol)))
+			goto out;
+		for (c=0;c<num_sort_cols;c++)
 		{
-			if ((err = data_initialize_block(&in_blocks[i],d,MIN(rows_per_in_block*d->num_bytes_per_row,65536))))
-			{
-				fprintf(stderr,"Couldn't alloc block for input\n");
+			if ((err = data_get_column_values(&values[c],&strides[c],&n,d,r,abs(d->to_sort_columns[c]))))
 				goto out;
-			}
-			if ((err = data_read_block_for_row(d,&in_blocks[i],i*rows_per_in_block)))
-			{
-				fprintf(stderr,"Couldn't read in block\n");
-				goto out;
-			}
 		}
 
-		progress_init(&p,"Sorting - second pass",d->num_rows);
-
-		int m;
-
-		/* Merge */
-		for (m=0;m<d->num_rows;m++)
+		for (k=0; k < n; k++)
 		{
-			int sk; /* k with smallest entry */
-
-			progress_done(&p,m);
-
-			for (sk=0;sk<k;sk++)
-				if (in_blocks[sk].current_row < rows_per_in_block)
-					break;
+			uint64_t pos, neg;
+			int tie;
 
-			for (i=sk;i<k;i++)
+			/* Only the sort columns of the row are gathered */
+			for (c=0;c<num_sort_cols;c++)
 			{
-				if (in_blocks[i].current_row >= rows_per_in_block || (i == k-1 && in_blocks[i].current_row >= rows_in_last_block))
-					continue;
-
-				if (in_blocks[i].current_relative_row == in_blocks[i].num_rows)
-				{
-					if ((err = data_read_block_for_row(d,&in_blocks[i],in_blocks[i].row_offset + in_blocks[i].num_rows)))
-					{
-						fprintf(stderr,"Couldn't read in block for %d\n",i);
-						goto out;
-					}
-					in_blocks[i].current_relative_row = 0;
-				}
-
-				if (i == sk)
-					continue;
-
-				if (data_sort_compare_heads_of_blocks(d,&in_blocks[sk],&in_blocks[i]) > 0)
-					sk = i;
+				int col = abs(d->to_sort_columns[c]);
+				memcpy(&ctx->row[d->column_offsets[col]],&values[c][k * strides[c]],data_column_size(d,col));
 			}
-
-			block_t *bsk = &in_blocks[sk];
-			uint8_t *bskb = &bsk->block[bsk->current_relative_row * d->num_bytes_per_row];
-			callback(d, bskb, user_data);
-			data_advance_head(d,bsk);
-
-			progress_print(&p,0);
+			tie = data_stat_tie(d,ctx);
+			data_row_weights(d,d->label_col,&labels[k * stride],weights ? &weights[k * wstride] : NULL,&pos,&neg);
+			data_stat_put(ctx,pos,neg,1,tie);
 		}
-
-		for (i=0;i<k;i++)
-			free(in_blocks[i].block);
-		free(in_blocks);
 	}
 	err = 0;
 out:
 	return err;
 }
 
-static int data_sort_cb(data_t *d, uint8_t *buf, void *user_data)
+/**
+ * Compares two distinct aggregated rows given by their indices. Rows that
+ * are equal with respect to the sort columns are ordered by their bytes.
+ */
+static int data_aggregate_compare_cb(const void *a, const void *b, void *data)
 {
-	int err;
-	FILE *sorted_outf;
-
-	err = -1;
+	data_t *d = (data_t*)data;
+	const uint8_t *ra = &d->agg.rows[(size_t)*(const uint32_t*)a * d->num_bytes_per_row];
+	const uint8_t *rb = &d->agg.rows[(size_t)*(const uint32_t*)b * d->num_bytes_per_row];
+	int rc;
 
-	sorted_outf = (FILE*)user_data;
-	if (!fwrite(buf,d->num_bytes_per_row,1,sorted_outf))
-	{
-		fprintf(stderr,"Failed to write some data\n!");
-		goto out;
-	}
-	err = 0;
-out:
-	return err;
+	if ((rc = data_sort_compare_cb(ra,rb,d)))
+		return rc;
+	return memcmp(ra,rb,d->num_bytes_per_row);
 }
 
-static int data_sort(data_t *d, int num_to_sort_columns, int *to_sort_columns)
+/**
+ * Accounts all aggregated rows in sorted order. Only the distinct rows
+ * are sorted.
+ *
+ * @param d
+ * @param ctx
+ * @return 0 on success, else an error.
+ */
+static int data_stat_aggregate(data_t *d, struct data_stat_context *ctx)
 {
-	int err = -1;
-	char *sorted_name = NULL;
-	FILE *sorted_outf = NULL;
-
-	if (!(sorted_name = malloc(strlen(d->filename) + 10)))
-		goto out;
-
-	strcpy(sorted_name,d->filename);
-	strcat(sorted_name,"-sorted");
-
-	if (!(sorted_outf = fopen(sorted_name,"wb")))
-		goto out;
-
-	d->to_sort_columns = to_sort_columns;
-	d->num_to_sort_columns = num_to_sort_columns;
-
-	if ((err = data_sort_callback(d, num_to_sort_columns, to_sort_columns, data_sort_cb, sorted_outf)))
-		goto out;
+	uint32_t *order;
+	uint64_t *weights;
+	uint32_t i;
+	uint32_t bpr = d->num_bytes_per_row;
 
-	if (d->tmp)
+	if (!(order = (uint32_t*)malloc(sizeof(order[0]) * (d->agg.num_rows + 1))))
+		return -1;
+	if (!(weights = (uint64_t*)malloc(sizeof(weights[0]) * 2 * (d->agg.num_rows + 1))))
 	{
-		fclose(d->tmp);
-		d->tmp = NULL;
+		free(order);
+		return -1;
+	}
 
-		fclose(sorted_outf);
-		sorted_outf = NULL;
+	data_groups_free(&d->groups);
+	d->positives = 0;
+	d->negatives = 0;
+	for (i=0;i<d->agg.num_rows;i++)
+	{
+		const uint8_t *row = &d->agg.rows[(size_t)i * bpr];
+		uint64_t *w = &weights[2 * i];
 
-		remove(d->filename);
-		if (rename(sorted_name,d->filename) == -1)
+		if (d->agg.positives)
 		{
-			fprintf(stderr,"Couldn't rename\n");
-			goto out;
+			w[0] = d->agg.positives[i];
+			w[1] = d->agg.negatives[i];
+		} else
+		{
+			data_row_weights(d,d->label_col,&row[d->column_offsets[d->label_col]],NULL,&w[0],&w[1]);
+			w[0] *= d->agg.counts[i];
+			w[1] *= d->agg.counts[i];
 		}
-
-		if (!(d->tmp = fopen(d->filename,"r+")))
+		d->positives += w[0];
+		d->negatives += w[1];
+		if (d->group_col >= 0 && data_groups_add(&d->groups,data_group_value(d,&row[d->column_offsets[d->group_col]]),w[0],w[1]))
 		{
-			fprintf(stderr,"Couldn't open file for appending\n");
-			goto out;
+			free(weights);
+			free(order);
+			return -1;
 		}
-		data_read_block_for_row(d, &d->ib, 0);
+		order[i] = i;
 	}
+	qsort_r(order,d->agg.num_rows,sizeof(order[0]),data_aggregate_compare_cb,d);
 
-	err = 0;
-out:
-	if (sorted_outf) fclose(sorted_outf);
-	if (sorted_name) free(sorted_name);
-	return err;
+	ctx->positives = d->positives;
+	ctx->negatives = d->negatives;
+
+	for (i=0;i<d->agg.num_rows;i++)
+	{
+		uint32_t r = order[i];
+		int tie;
+
+		memcpy(ctx->row,&d->agg.rows[(size_t)r * bpr],bpr);
+		tie = data_stat_tie(d,ctx);
+		data_stat_put(ctx,weights[2 * r],weights[2 * r + 1],d->agg.counts[r],tie);
+	}
+	free(weights);
+	free(order);
+	return 0;
 }
 
-int data_sort_v(data_t *d, int cols, ...)
+/**
+ * Finishes the bootstrap of the given context and stores the areas under
+ * the ROC curve of the replicates in the frame.
+ *
+ * @param d
+ * @param ctx
+ * @return 0 on success, else an error.
+ */
+static int data_stat_bootstrap_finish(data_t *d, struct data_stat_context *ctx)
 {
-	int i;
-	int err = -1;
-	int to_sort_cols[cols];
+	struct data_bootstrap *bs = ctx->bootstrap;
+	uint32_t i;
 
-	va_list vl;
-	va_start(vl,cols);
+	if (ctx->err || data_bootstrap_flush(bs))
+		return -1;
 
-	for (i=0;i<cols;i++)
-		to_sort_cols[i] = va_arg(vl,int);
+	if (!(d->bootstrap_auc_roc = (double*)malloc(sizeof(d->bootstrap_auc_roc[0]) * bs->replicates)))
+		return -1;
 
-	err = data_sort(d,cols,to_sort_cols);
+	for (i=0;i<bs->replicates;i++)
+	{
+		struct data_bootstrap_replicate *r = &bs->reps[i];
 
-	va_end(vl);
-	return err;
+		/* Closes the last threshold */
+		data_bootstrap_put(r,0,0);
+		d->bootstrap_auc_roc[i] = r->auc_roc / 2 / ((double)r->tps * r->fps);
+	}
+	return 0;
 }
 
-int data_stat_callback(data_t *d, int (*callback)(uint32_t ps, uint32_t ns, uint32_t tps, uint32_t fps, void *userdata), void *user_data, int label_col, int cols, int *to_sort_cols)
+/**
+ * Determines the measures of the given frame. The rows are sorted according
+ * to the given columns, the callback is invoked in that order for each row
+ * or threshold, see data_set_stat_points().
+ * Summary measures are accumulated in the same pass, see data_get_summary().
+ * If there is a group column, the rows are sorted by it first and the
+ * callback is invoked for each group on its own, with the group's totals,
+ * see data_get_stat_group() and data_get_group_summary().
+ *
+ * @param d
+ * @param callback
+ * @param user_data
+ * @param label_col
+ * @param cols
+ * @param to_sort_cols
+ * @return 0 on success, else an error.
+ */
+int data_stat_callback(data_t *d, int (*callback)(uint64_t ps, uint64_t ns, uint64_t tps, uint64_t fps, void *userdata), void *user_data, int label_col, int cols, int *to_sort_cols)
 {
-	int r;
 	int err = -1;
-	uint32_t tps = 0;
+	struct data_stat_context ctx;
+	uint8_t *rows = NULL;
+	int sorted;
+
+	memset(&ctx,0,sizeof(ctx));
+	ctx.callback = callback;
+	ctx.user_data = user_data;
+	ctx.points = d->stat_points;
+	ctx.threshold_precision = 1;
 
 	d->label_col = label_col;
+	d->has_summary = 0;
+	d->num_group_summaries = 0;
+	free(d->bootstrap_auc_roc);
+	d->bootstrap_auc_roc = NULL;
+
+	/* The weights of aggregated rows are known for their label column only */
+	if (data_is_aggregated(d) && label_col != d->agg.label_col && (err = data_expand_aggregate(d)))
+		goto out;
+	err = -1;
+
+	if (d->group_col >= 0)
+	{
+		if (d->bootstrap_replicates)
+		{
+			fprintf(stderr,"The bootstrap can't be combined with groups\n");
+			goto out;
+		}
+
+		/* Composite sort by the group and the given columns */
+		free(d->group_sort_columns);
+		if (!(d->group_sort_columns = (int*)malloc(sizeof(to_sort_cols[0]) * (cols + 1))))
+			goto out;
+		d->group_sort_columns[0] = d->group_col;
+		memcpy(&d->group_sort_columns[1],to_sort_cols,sizeof(to_sort_cols[0]) * cols);
+		to_sort_cols = d->group_sort_columns;
+		cols++;
+	}
 
-	if ((err = data_sort(d,cols,to_sort_cols)))
+	if (!(rows = (uint8_t*)malloc(2 * MAX(d->num_bytes_per_row,1))))
 		goto out;
+	ctx.row = rows;
+	ctx.last_row = rows + d->num_bytes_per_row;
 
-	uint32_t positives = d->label_sum;
-	uint32_t negatives = d->num_rows - positives;
+	if (d->bootstrap_replicates && (err = data_bootstrap_create(&ctx.bootstrap,d)))
+		goto out;
+	err = -1;
 
-	for (r=0; r < d->num_rows; r++)
+	if ((sorted = data_is_sorted_by(d,cols,to_sort_cols)))
+	{
+		/* The rows are accounted in their stored order */
+		d->to_sort_columns = to_sort_cols;
+		d->num_to_sort_columns = cols;
+		if ((err = data_count_rows(d)))
+			goto out;
+	} else if (d->keep_sorted)
+	{
+		if ((err = data_sort(d,cols,to_sort_cols)))
+			goto out;
+		sorted = 1;
+	} else
 	{
-		int32_t l;
+		d->to_sort_columns = to_sort_cols;
+		d->num_to_sort_columns = cols;
+
+		if (data_is_aggregated(d))
+		{
+			if ((err = data_stat_aggregate(d,&ctx)))
+				goto out;
+			goto summary;
+		}
 
-		if ((err = data_get_entry_as_int32(&l,d,r,label_col)))
+		if ((err = data_sort_runs(d)))
 			goto out;
+	}
+
+	/* The weights are known after the runs have been sorted */
+	ctx.positives = d->positives;
+	ctx.negatives = d->negatives;
 
-		tps += l > 0;
-		uint32_t fps = (r+1) - tps;
+	if (!sorted && d->num_rows > d->ib.num_rows)
+		err = data_merge_runs(d,data_stat_merge_cb,&ctx);
+	else
+		err = data_stat_scan(d,&ctx);
+	if (err)
+		goto out;
 
-		callback(positives,negatives,tps,fps,user_data);
+summary:
+	if (d->group_col >= 0)
+	{
+		/* Finishes the last group */
+		if (ctx.has_last_row)
+			data_stat_group_end(d,&ctx);
+		if ((err = ctx.err))
+			goto out;
+		err = 0;
+		goto out;
 	}
-	err = 0;
+
+	data_stat_finish(&ctx);
+	data_stat_summarize(&d->summary,&ctx);
+	d->has_summary = 1;
+
+	if (ctx.bootstrap && (err = data_stat_bootstrap_finish(d,&ctx)))
+		goto out;
 out:
+	data_bootstrap_free(ctx.bootstrap);
+	free(rows);
 	if (err) fprintf(stderr,"Stats err=%d\n",err);
 	return err;
 }
@@ -1210,7 +8393,7 @@ out:
 
 /**************************************************************/
 
-static int data_stat_with_hist_callback(uint32_t ps, uint32_t ns, uint32_t tps, uint32_t fps, void *userdata)
+static int data_stat_with_hist_callback(uint64_t ps, uint64_t ns, uint64_t tps, uint64_t fps, void *userdata)
 {
 	data_t *d = (data_t*)userdata;
 	double tpr = (double)tps / ps; /* true positive rate */
@@ -1264,6 +8447,216 @@ int data_stat_hist_v(data_t *d, int breaks, int label_col, int cols, ...)
 	return err;
 }
 
+struct data_stat_hist_context
+{
+	data_t **frames;
+	int num_frames;
+	int breaks;
+	int label_col;
+	int cols;
+	int *to_sort_cols;
+
+	/** The following is protected by the mutex */
+	pthread_mutex_t mutex;
+	int next;
+	int err;
+};
+
+static int data_stat_nop_callback(uint64_t ps, uint64_t ns, uint64_t tps, uint64_t fps, void *userdata)
+{
+	return 0;
+}
+
+static void *data_stat_hist_thread(void *arg)
+{
+	struct data_stat_hist_context *ctx = (struct data_stat_hist_context*)arg;
+	int err = 0;
+
+	while (!err)
+	{
+		int i;
+
+		pthread_mutex_lock(&ctx->mutex);
+		i = ctx->next++;
+		err = ctx->err;
+		pthread_mutex_unlock(&ctx->mutex);
+
+		if (err || i >= ctx->num_frames)
+			break;
+
+		if (ctx->breaks > 0)
+			err = data_stat_hist(ctx->frames[i],ctx->breaks,ctx->label_col,ctx->cols,&ctx->to_sort_cols[i * ctx->cols]);
+		else
+			err = data_stat_callback(ctx->frames[i],data_stat_nop_callback,NULL,ctx->label_col,ctx->cols,&ctx->to_sort_cols[i * ctx->cols]);
+		if (err)
+		{
+			pthread_mutex_lock(&ctx->mutex);
+			ctx->err = err;
+			pthread_mutex_unlock(&ctx->mutex);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Determines the histograms of several frames, e.g., the ones of
+ * data_load_from_ascii_split(), as data_stat_hist() does. Up to the
+ * given number of frames are processed concurrently.
+ *
+ * @param frames
+ * @param num_frames
+ * @param threads the number of frames that are processed at once.
+ * @param breaks the number of breaks of the histograms, or 0 if only the
+ *  summary measures are needed, see data_get_summary().
+ * @param label_col
+ * @param cols the number of sort columns of each frame.
+ * @param to_sort_cols the sort columns of the frames, frame i is sorted
+ *  by the columns to_sort_cols[i * cols] to to_sort_cols[i * cols + cols - 1].
+ * @return 0 on success, else an error.
+ */
+int data_stat_hist_frames(data_t **frames, int num_frames, int threads, int breaks, int label_col, int cols, int *to_sort_cols)
+{
+	struct data_stat_hist_context ctx;
+	pthread_t *thread_ids = NULL;
+	int num_threads = 0;
+	int err = -1;
+	int i;
+
+	memset(&ctx,0,sizeof(ctx));
+	ctx.frames = frames;
+	ctx.num_frames = num_frames;
+	ctx.breaks = breaks;
+	ctx.label_col = label_col;
+	ctx.cols = cols;
+	ctx.to_sort_cols = to_sort_cols;
+
+	threads = MAX(1,MIN(threads,num_frames));
+	if (!(thread_ids = (pthread_t*)malloc(sizeof(thread_ids[0]) * threads)))
+		goto out;
+
+	pthread_mutex_init(&ctx.mutex,NULL);
+
+	for (i=1;i<threads;i++)
+	{
+		if (pthread_create(&thread_ids[num_threads],NULL,data_stat_hist_thread,&ctx))
+			break;
+		num_threads++;
+	}
+
+	data_stat_hist_thread(&ctx);
+
+	for (i=0;i<num_threads;i++)
+		pthread_join(thread_ids[i],NULL);
+
+	pthread_mutex_destroy(&ctx.mutex);
+	err = ctx.err;
+out:
+	free(thread_ids);
+	return err;
+}
+
+/**
+ * Returns the summary measures that have been determined by the last call
+ * to data_stat_callback() or data_stat_hist().
+ *
+ * @param summary where the measures are stored.
+ * @param d
+ * @return 0 on success, else an error.
+ */
+int data_get_summary(struct data_summary *summary, data_t *d)
+{
+	if (!d->has_summary)
+		return -1;
+	*summary = d->summary;
+	return 0;
+}
+
+/**
+ * Returns the value of the group column of the rows that are currently
+ * accounted, i.e., from within the callback of data_stat_callback().
+ *
+ * @param value where the value is stored.
+ * @param d
+ * @return 0 on success, else an error.
+ */
+int data_get_stat_group(double *value, data_t *d)
+{
+	if (d->group_col < 0)
+		return -1;
+	*value = d->stat_group;
+	return 0;
+}
+
+/**
+ * Returns the number of groups of the last call to data_stat_callback(),
+ * see data_set_group_column().
+ *
+ * @param d
+ * @return the number of groups.
+ */
+uint32_t data_get_number_of_groups(data_t *d)
+{
+	return d->num_group_summaries;
+}
+
+/**
+ * Returns the group value and the measures of a group of the last call to
+ * data_stat_callback(). The groups are ordered by their value.
+ *
+ * @param summary where the group is stored.
+ * @param d
+ * @param i the index of the group.
+ * @return 0 on success, else an error.
+ */
+int data_get_group_summary(struct data_group_summary *summary, data_t *d, uint32_t i)
+{
+	if (i >= d->num_group_summaries)
+		return -1;
+	*summary = d->group_summaries[i];
+	return 0;
+}
+
+static int data_compare_double(const void *a, const void *b)
+{
+	double da = *(const double*)a;
+	double db = *(const double*)b;
+
+	if (da < db) return -1;
+	if (da > db) return 1;
+	return 0;
+}
+
+/**
+ * Returns a percentile confidence interval of the area under the ROC curve
+ * that has been determined by the bootstrap of the last call to
+ * data_stat_callback() or data_stat_hist(), see data_set_bootstrap().
+ *
+ * @param lower where the lower bound is stored.
+ * @param upper where the upper bound is stored.
+ * @param d
+ * @param confidence the confidence level, e.g., 0.95.
+ * @return 0 on success, else an error.
+ */
+int data_get_bootstrap_auc_roc(double *lower, double *upper, data_t *d, double confidence)
+{
+	uint32_t n = d->bootstrap_replicates;
+	double *sorted;
+	double tail = (1 - confidence) / 2;
+
+	if (!d->bootstrap_auc_roc || !n || confidence <= 0 || confidence >= 1)
+		return -1;
+
+	if (!(sorted = (double*)malloc(sizeof(sorted[0]) * n)))
+		return -1;
+	memcpy(sorted,d->bootstrap_auc_roc,sizeof(sorted[0]) * n);
+	qsort(sorted,n,sizeof(sorted[0]),data_compare_double);
+
+	*lower = sorted[(uint32_t)(tail * (n - 1) + 0.5)];
+	*upper = sorted[(uint32_t)((1 - tail) * (n - 1) + 0.5)];
+	free(sorted);
+	return 0;
+}
+
 /**
  * Returns the precision value for the given recall.
  *
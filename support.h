@@ -1,6 +1,7 @@
 #ifndef CLPERF_SUPPORT_H
 #define CLPERF_SUPPORT_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct data data_t;
@@ -10,22 +11,138 @@ enum column_datatype_t
 {
 	UNKNOWN,
 	INT32,
-	DOUBLE
+	DOUBLE,
+	INT8,
+	UINT8,
+	INT16,
+	FLOAT32
 };
 
+/** How the rows of a data frame are stored */
+enum data_layout_t
+{
+	/** All values of a row are stored consecutively */
+	LAYOUT_ROWS,
+
+	/** Within each block, all values of a column are stored consecutively */
+	LAYOUT_COLUMNS
+};
+
+/** The points of the curves for which data_stat_callback() invokes the callback */
+enum data_stat_points_t
+{
+	/** A point for every row, the points of rows that tie are spread evenly on the line between the thresholds */
+	POINTS_ROWS,
+
+	/** A point for every distinct prediction, i.e., after all rows that tie */
+	POINTS_THRESHOLDS,
+
+	/** Like POINTS_THRESHOLDS, but points that are collinear with their neighbors in ROC space are omitted */
+	POINTS_CORNERS
+};
+
+/** Measures that summarize a classification result */
+struct data_summary
+{
+	/** Total weight of the positive and the negative rows */
+	uint64_t positives;
+	uint64_t negatives;
+
+	/** Area under the ROC curve, tied predictions are interpolated linearly */
+	double auc_roc;
+
+	/** Precision averaged over the thresholds, weighted by the increase in recall */
+	double average_precision;
+
+	/** Area under the precision/recall curve, interpolated linearly, starting at a precision of 1 */
+	double auc_pr;
+
+	/** Kolmogorov-Smirnov statistic, the largest distance between the true and false positive rates */
+	double ks;
+
+	/** Largest F1 score of any threshold */
+	double max_f1;
+};
+
+/** Measures of a group of rows, see data_set_group_column() */
+struct data_group_summary
+{
+	/** The value of the group column */
+	double value;
+
+	struct data_summary summary;
+};
+
+/** Maximal number of characters written by format_double() */
+#define FORMAT_DOUBLE_MAX 32
+
+int format_double(char *buf, double v);
+
+/** Buffered output to a file descriptor, see fout_init() */
+struct fout
+{
+	int fd;
+	char *buf;
+	size_t size;
+	size_t used;
+
+	/** Set once writing failed */
+	int err;
+};
+
+int fout_init(struct fout *f, int fd, size_t size);
+int fout_write(struct fout *f, const void *data, size_t len);
+int fout_puts(struct fout *f, const char *str);
+int fout_put_double(struct fout *f, double v);
+int fout_put_double_le(struct fout *f, double v);
+int fout_flush(struct fout *f);
+int fout_deinit(struct fout *f);
+
 int data_create(data_t **out);
 void data_free(data_t *d);
 void data_set_external_filename(data_t *d, const char *filename);
+void data_set_number_of_threads(data_t *d, int threads);
+void data_set_max_fan_in(data_t *d, int fan_in);
+void data_set_progress(data_t *d, int show);
+int data_set_layout(data_t *d, enum data_layout_t layout);
+int data_set_spill_compression(data_t *d, int compress);
+void data_set_narrow_integers(data_t *d, int narrow);
+void data_set_float32(data_t *d, int float32);
+void data_set_keep_sorted(data_t *d, int keep_sorted);
+void data_set_stat_points(data_t *d, enum data_stat_points_t points);
+void data_set_bootstrap(data_t *d, uint32_t replicates, uint64_t seed);
+int data_set_max_distinct_rows(data_t *d, int label_col, uint32_t max_rows);
+int data_set_memory_budget(data_t *d, size_t bytes);
+int data_set_weight_columns(data_t *d, int weight_col, int negatives_col);
+int data_set_group_column(data_t *d, int col);
+int data_set_presort_columns(data_t *d, int label_col, int cols, const int *to_sort_cols);
 int data_load_from_ascii(data_t *d, const char *filename);
+int data_load_from_ascii_projected(data_t *d, const char *filename, int num_cols, const int *cols);
+int data_load_from_ascii_split(data_t **frames, int num_frames, const char *filename, int num_cols, const int *cols);
+int data_load_from_binary_split(data_t **frames, int num_frames, const char *filename, int num_cols, const int *cols);
+int data_is_binary_file(const char *filename);
+int data_save_binary(data_t *d, const char *filename, const char *key);
+int data_load_binary(data_t *d, const char *filename, const char *key);
 
 uint32_t data_get_number_of_columns(data_t *d);
+uint32_t data_get_number_of_input_columns(data_t *d);
 uint32_t data_get_number_of_rows(data_t *d);
+int data_has_aggregated_rows(data_t *d);
+void data_get_merge_io_stats(data_t *d, uint64_t *refills, uint64_t *waits);
+
+int data_sort_v(data_t *d, int cols, ...);
 
-int data_stat_callback(data_t *d, int (*callback)(uint32_t ps, uint32_t ns, uint32_t tps, uint32_t fps, void *userdata), void *user_data, int label_col, int cols, int *to_sort_cols);
+int data_stat_callback(data_t *d, int (*callback)(uint64_t ps, uint64_t ns, uint64_t tps, uint64_t fps, void *userdata), void *user_data, int label_col, int cols, int *to_sort_cols);
 
 int data_stat_hist(data_t *d, int breaks, int label_col, int cols, int *to_sort_cols);
 int data_stat_hist_v(data_t *d, int breaks, int label_col, int cols, ...);
+int data_stat_hist_frames(data_t **frames, int num_frames, int threads, int breaks, int label_col, int cols, int *to_sort_cols);
 
+int data_get_summary(struct data_summary *summary, data_t *d);
+int data_get_stat_group(double *value, data_t *d);
+uint32_t data_get_number_of_groups(data_t *d);
+int data_get_group_summary(struct data_group_summary *summary, data_t *d, uint32_t i);
+int data_get_bootstrap_auc_roc(double *lower, double *upper, data_t *d, double confidence);
 int data_get_precision_by_recall(double *precision, data_t *d, double recall);
 int data_get_tpr_by_fpr(double *tpr, data_t *d, double fpr);
 
@@ -3,6 +3,7 @@
 #include <float.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/wait.h>
 
 #include "minunit.h"
 #include "support.c"
@@ -18,7 +19,7 @@ struct test_callback_data
 	uint32_t current;
 };
 
-static int test_data_roc_precall_callback(uint32_t ps, uint32_t ns, uint32_t tps, uint32_t fps, void *userdata)
+static int test_data_roc_precall_callback(uint64_t ps, uint64_t ns, uint64_t tps, uint64_t fps, void *userdata)
 {
 	struct test_callback_data *tcd = (struct test_callback_data*)userdata;
 	if (tcd->current < 12)
@@ -186,6 +187,356 @@ static char *test_data_more_than_a_block(void)
 
 /************************************************************/
 
+static char *test_data_columns(void)
+{
+	char *rc;
+	data_t *d;
+	int32_t label_sum = 0;
+	double lv = -1;
+	int i;
+
+	mu_assert(!data_create(&d));
+	mu_assert(!data_set_layout(d,LAYOUT_COLUMNS));
+	if ((rc = helper_insert_and_assert_data(d)))
+		return rc;
+	mu_assert(data_set_layout(d,LAYOUT_ROWS));
+	data_free(d);
+
+	mu_assert(!data_create(&d));
+	mu_assert(!data_set_layout(d,LAYOUT_COLUMNS));
+	d->ib_bytes = 64;
+	if ((rc = helper_insert_and_assert_data(d)))
+		return rc;
+	data_free(d);
+
+	mu_assert(!data_create(&d));
+	mu_assert(!data_set_layout(d,LAYOUT_COLUMNS));
+	d->ib_bytes = 84;
+	d->parse_chunk_bytes = 100;
+	data_set_number_of_threads(d,3);
+	mu_assert(!data_load_from_ascii(d,"tests/resources/test2.dat"));
+	mu_assert(200 == d->num_rows);
+	/* The label is narrowed to a single byte */
+	mu_assert(1 + 8 == d->num_bytes_per_row);
+	mu_assert(9 == d->ib.num_rows);
+	mu_assert(!data_sort_v(d,1,1));
+	for (i=0;i<200;i++)
+	{
+		double v;
+		int32_t l;
+		mu_assert(!data_get_entry_as_double(&v,d,i,1));
+		mu_assert(lv <= v);
+		mu_assert(!data_get_entry_as_int32(&l,d,i,0));
+		label_sum += l;
+		lv = v;
+	}
+	mu_assert(label_sum == 100);
+	data_free(d);
+	return NULL;
+}
+
+/************************************************************/
+
+static char *helper_many_runs(int fan_in, int threads, int small_buffers, enum data_layout_t layout)
+{
+	data_t *d;
+	double sum = 0;
+	double sorted_sum = 0;
+	double lv = -1;
+	int i;
+
+	mu_assert(!data_create(&d));
+	mu_assert(!data_set_layout(d,layout));
+	d->ib_bytes = 7 * 12;
+	data_set_max_fan_in(d,fan_in);
+	data_set_number_of_threads(d,threads);
+	if (small_buffers)
+	{
+		/* Two rows per buffer, so runs are read ahead in several chunks */
+		d->merge_bytes = 100;
+		d->merge_buffer_min_bytes = 24;
+	}
+
+	mu_assert(!data_set_number_of_columns(d,2));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,DOUBLE);
+
+	srand(1);
+	for (i=0;i<1000;i++)
+	{
+		double v = rand() % 100000; /* exact sums */
+		sum += v;
+		mu_assert(!data_insert_row_v(d,i&1,v));
+	}
+	mu_assert(d->ib.num_rows == 7);
+
+	mu_assert(!data_sort_v(d,1,1));
+	for (i=0;i<1000;i++)
+	{
+		double v;
+		mu_assert(!data_get_entry_as_double(&v,d,i,1));
+		mu_assert(lv <= v);
+		sorted_sum += v;
+		lv = v;
+	}
+	mu_assert(sum == sorted_sum);
+	if (small_buffers)
+		mu_assert(d->merge_refills > 0);
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_many_runs(void)
+{
+	static const int fan_ins[] = {0, 2, 3, 12, 143};
+	char *rc;
+	int i;
+
+	for (i=0;i<sizeof(fan_ins)/sizeof(fan_ins[0]);i++)
+	{
+		if ((rc = helper_many_runs(fan_ins[i],i % 3 + 1,0,LAYOUT_ROWS)))
+			return rc;
+		if ((rc = helper_many_runs(fan_ins[i],1,1,LAYOUT_ROWS)))
+			return rc;
+		if ((rc = helper_many_runs(fan_ins[i],i % 3 + 1,1,LAYOUT_COLUMNS)))
+			return rc;
+	}
+	return NULL;
+}
+
+/************************************************************/
+
+static char *helper_spill_compression(enum data_layout_t layout, int fan_in, int random_bits)
+{
+	data_t *d[2];
+	int encoded = 0;
+	int i, j, k;
+
+	for (k=0;k<2;k++)
+	{
+		mu_assert(!data_create(&d[k]));
+		mu_assert(!data_set_layout(d[k],layout));
+		data_set_external_filename(d[k],k ? "out-compressed" : "out");
+		mu_assert(!data_set_spill_compression(d[k],k));
+		d[k]->ib_bytes = 10000 * 12;
+		data_set_max_fan_in(d[k],fan_in);
+		d[k]->merge_bytes = 12 * 1000;
+		d[k]->merge_buffer_min_bytes = 12 * 100;
+		mu_assert(!data_set_number_of_columns(d[k],2));
+		data_set_column_datatype(d[k],0,INT32);
+		data_set_column_datatype(d[k],1,DOUBLE);
+
+		srand(1);
+		for (i=0;i<100000;i++)
+		{
+			int32_t label = i & 1;
+			double v = (rand() % 1000) - 500.25;
+
+			if (random_bits)
+			{
+				label = (int32_t)((uint32_t)rand() * 65536 + rand());
+				v = ldexp(rand(),rand() % 200 - 100) * (rand() & 1 ? -1 : 1);
+			}
+			mu_assert(!data_insert_row_v(d[k],label,v));
+		}
+	}
+	mu_assert(d[1]->ib.num_rows == 10000);
+
+	/* Rows are encoded unless they are random */
+	for (j=0;j<DATA_SPILL_FILES;j++)
+	{
+		struct spill_file *f = &d[1]->spill_files[j];
+
+		for (i=0;f->used && i<f->num_chunks;i++)
+			encoded |= f->chunks[i].bytes < f->chunks[i].rows * 12;
+	}
+	mu_assert(encoded == !random_bits);
+
+	for (k=0;k<2;k++)
+		mu_assert(!data_sort_v(d[k],1,1));
+
+	for (i=0;i<100000;i++)
+	{
+		double v[2][2];
+
+		for (k=0;k<2;k++)
+		{
+			mu_assert(!data_get_entry_as_double(&v[k][0],d[k],i,0));
+			mu_assert(!data_get_entry_as_double(&v[k][1],d[k],i,1));
+		}
+		mu_assert(!memcmp(v[0],v[1],sizeof(v[0])));
+		if (i)
+		{
+			double lv;
+			mu_assert(!data_get_entry_as_double(&lv,d[1],i-1,1));
+			mu_assert(lv <= v[1][1]);
+		}
+	}
+	data_free(d[0]);
+	data_free(d[1]);
+	return NULL;
+}
+
+static char *test_data_spill_compression(void)
+{
+	uint64_t values[67];
+	uint64_t unpacked[67];
+	uint8_t packed[67 * sizeof(uint64_t)];
+	char *rc;
+	int width;
+	int layout;
+	int i;
+
+	for (width=0;width<=64;width++)
+	{
+		for (i=0;i<67;i++)
+			values[i] = ((uint64_t)rand() << 33 ^ (uint64_t)rand() << 12 ^ rand()) & (width == 64 ? ~UINT64_C(0) : (UINT64_C(1) << width) - 1);
+		spill_pack(packed,values,67,width);
+		spill_unpack(unpacked,packed,67,width);
+		mu_assert(!memcmp(values,unpacked,sizeof(values)));
+		mu_assert(spill_packed_bytes(67,width) <= sizeof(packed));
+	}
+
+	for (layout=LAYOUT_ROWS;layout<=LAYOUT_COLUMNS;layout++)
+	{
+		if ((rc = helper_spill_compression(layout,0,0)))
+			return rc;
+		if ((rc = helper_spill_compression(layout,3,0)))
+			return rc;
+		if ((rc = helper_spill_compression(layout,3,1)))
+			return rc;
+	}
+	return NULL;
+}
+
+/************************************************************/
+
+static char *helper_memory_budget(enum data_layout_t layout, int n, int expect_in_memory)
+{
+	data_t *d;
+	double lv = -1;
+	int64_t sum = 0, sorted_sum = 0;
+	int32_t labels = 0;
+	int i;
+
+	mu_assert(!data_create(&d));
+	mu_assert(!data_set_layout(d,layout));
+	mu_assert(!data_set_memory_budget(d,1024 * 1024 * 8));
+	mu_assert(!data_set_number_of_columns(d,2));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,DOUBLE);
+
+	srand(3);
+	for (i=0;i<n;i++)
+	{
+		int v = rand() % 1000000;
+		sum += v;
+		mu_assert(!data_insert_row_v(d,v & 1,(double)v));
+	}
+	mu_assert(d->ib_max_rows > d->ib_bytes / d->num_bytes_per_row);
+	mu_assert(d->ib_max_rows * (2 * d->num_bytes_per_row + DATA_SORT_SCRATCH_BYTES_PER_ROW) <= 1024 * 1024 * 8);
+	mu_assert(expect_in_memory == !d->tmp);
+
+	mu_assert(!data_sort_v(d,1,1));
+	for (i=0;i<n;i++)
+	{
+		double v;
+		int32_t l;
+		mu_assert(!data_get_entry_as_double(&v,d,i,1));
+		mu_assert(!data_get_entry_as_int32(&l,d,i,0));
+		mu_assert(lv <= v);
+		mu_assert(l == ((int)v & 1));
+		sorted_sum += v;
+		labels += l;
+		lv = v;
+	}
+	mu_assert(sum == sorted_sum);
+	mu_assert(labels == d->positives);
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_memory_budget(void)
+{
+	char *rc;
+	int layout;
+
+	for (layout=LAYOUT_ROWS;layout<=LAYOUT_COLUMNS;layout++)
+	{
+		if ((rc = helper_memory_budget(layout,140000,1)))
+			return rc;
+		if ((rc = helper_memory_budget(layout,400000,0)))
+			return rc;
+	}
+	return NULL;
+}
+
+/************************************************************/
+
+static char *helper_sort_block(enum data_layout_t layout)
+{
+	static const int specs[][3] =
+	{
+		/* number of columns, columns */
+		{1, 1}, {1, -1}, {1, 2}, {1, -2}, {2, 0, -2}, {2, 0, 1}
+	};
+	const int n = 5000;
+	data_t *d;
+	int64_t sum = 0;
+	int i, s;
+
+	mu_assert(!data_create(&d));
+	mu_assert(!data_set_layout(d,layout));
+	mu_assert(!data_set_number_of_columns(d,3));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,DOUBLE);
+	data_set_column_datatype(d,2,INT32);
+
+	srand(2);
+	for (i=0;i<n;i++)
+	{
+		int32_t v = rand() - RAND_MAX / 2;
+		double dv = i % 10 ? v / 1000.0 : 0.25; /* with some ties */
+		sum += v;
+		mu_assert(!data_insert_row_v(d,rand() % 3,dv,v));
+	}
+	mu_assert(d->ib.num_rows > n);
+
+	for (s=0;s<sizeof(specs)/sizeof(specs[0]);s++)
+	{
+		int64_t sorted_sum = 0;
+		uint8_t rows[2 * d->num_bytes_per_row];
+		uint8_t *row = &rows[d->num_bytes_per_row];
+
+		d->num_to_sort_columns = specs[s][0];
+		d->to_sort_columns = (int*)&specs[s][1];
+		mu_assert(!data_sort_block(d,d->ib.block,n));
+
+		for (i=0;i<n;i++)
+		{
+			memcpy(rows,row,d->num_bytes_per_row);
+			data_block_get_rows(d,d->ib.block,i,row,1);
+			if (i)
+				mu_assert(data_sort_compare_cb(rows,row,d) <= 0);
+			sorted_sum += *(int32_t*)&row[d->column_offsets[2]];
+		}
+		mu_assert(sum == sorted_sum);
+	}
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_sort_block(void)
+{
+	char *rc;
+
+	if ((rc = helper_sort_block(LAYOUT_ROWS)))
+		return rc;
+	return helper_sort_block(LAYOUT_COLUMNS);
+}
+
+/************************************************************/
+
 static char *test_data_load_from_ascii(void)
 {
 	char *rc;
@@ -202,76 +553,1533 @@ static char *test_data_load_from_ascii(void)
 
 /************************************************************/
 
-static char *test_fio(void)
+static char *test_data_load_from_ascii_projected(void)
 {
-	struct fio fio;
-	const char *l;
+	data_t *d;
+	double dv;
+	int32_t iv;
+	static const int cols[] = {4, 1, 0, 1};
+	static const int bad_cols[] = {0, 6};
 
-	mu_assert(!fio_init_by_file(&fio,"tests/resources/test.dat"));
-	mu_assert(fio.first_lines[0]);
-	mu_assert(!strcmp("label\tpred1\tpred2\to1\to2\to3\n",fio.first_lines[0]));
-
-	mu_assert(!fio_read_next_line(&l,&fio));
-	mu_assert(!strcmp("label\tpred1\tpred2\to1\to2\to3\n",l));
-
-	mu_assert(!fio_read_next_line(&l,&fio));
-	mu_assert(!strcmp("0	0.11	0.12	3	3	0\n",l));
-	mu_assert(!fio_read_next_line(&l,&fio));
-	mu_assert(!strcmp("0	0.24	0.11	5	2	0\n",l));
-	mu_assert(!fio_read_next_line(&l,&fio));
-	mu_assert(!strcmp("0	0.14	0.43	4	6	0\n",l));
-	mu_assert(!fio_read_next_line(&l,&fio));
-	mu_assert(!strcmp("0	0.33	0.56	6	9	0\n",l));
-	mu_assert(!fio_read_next_line(&l,&fio));
-	mu_assert(!strcmp("0	0.45	0.44	7	7	0\n",l));
-	mu_assert(!fio_read_next_line(&l,&fio));
-	mu_assert(!strcmp("1	0.68	0.49	11	8	0\n",l));
-	mu_assert(!fio_read_next_line(&l,&fio));
-	mu_assert(!strcmp("1	0.58	0.59	9	10	0\n",l));
-	mu_assert(!fio_read_next_line(&l,&fio));
-	mu_assert(!strcmp("0	0.59	0.68	10	11	0\n",l));
-	mu_assert(!fio_read_next_line(&l,&fio));
-	mu_assert(!strcmp("0	0.51	0.42	8	5	0\n",l));
+	mu_assert(!data_create(&d));
+	mu_assert(!data_load_from_ascii_projected(d,"tests/resources/test.dat",4,cols));
+	mu_assert(6 == data_get_number_of_input_columns(d));
+	mu_assert(4 == data_get_number_of_columns(d));
+	mu_assert(12 == data_get_number_of_rows(d));
+	/* The integer columns are narrowed to a single byte */
+	mu_assert(d->num_bytes_per_row == 1 + 8 + 1 + 8);
 
-	fio_deinit(&fio);
+	mu_assert(!data_get_entry_as_int32(&iv,d,6,0));
+	mu_assert(iv == 10);
+	mu_assert(!data_get_entry_as_double(&dv,d,6,1));
+	mu_assert(dv == 0.58);
+	mu_assert(!data_get_entry_as_int32(&iv,d,6,2));
+	mu_assert(iv == 1);
+	mu_assert(!data_get_entry_as_double(&dv,d,6,3));
+	mu_assert(dv == 0.58);
+
+	mu_assert(!data_sort_v(d,1,-1));
+	mu_assert(!data_get_entry_as_double(&dv,d,0,1));
+	mu_assert(dv == 0.68);
+	mu_assert(!data_get_entry_as_int32(&iv,d,0,0));
+	mu_assert(iv == 8);
+	data_free(d);
 
+	mu_assert(!data_create(&d));
+	mu_assert(data_load_from_ascii_projected(d,"tests/resources/test.dat",2,bad_cols));
+	data_free(d);
 	return NULL;
 }
 
 /************************************************************/
 
-static char *test_data_2(void)
+static char *test_data_load_from_ascii_threads(void)
 {
-	double prec;
-	double lv = DBL_MIN;
 	data_t *d;
+	double serial[200];
+	int32_t serial_label_sum = 0;
+	int32_t label_sum = 0;
 	int i;
 
 	mu_assert(!data_create(&d));
 	d->ib_bytes = 84;
+	mu_assert(!data_load_from_ascii(d,"tests/resources/test2.dat"));
+	mu_assert(200 == d->num_rows);
+	mu_assert(!data_sort_v(d,1,1));
+	for (i=0;i<200;i++)
+	{
+		int32_t l;
+		mu_assert(!data_get_entry_as_double(&serial[i],d,i,1));
+		mu_assert(!data_get_entry_as_int32(&l,d,i,0));
+		serial_label_sum += l;
+	}
+	data_free(d);
 
+	mu_assert(!data_create(&d));
+	d->ib_bytes = 84;
+	d->parse_chunk_bytes = 100;
+	data_set_number_of_threads(d,3);
 	mu_assert(!data_load_from_ascii(d,"tests/resources/test2.dat"));
 	mu_assert(2 == d->num_columns);
 	mu_assert(200 == d->num_rows);
 	mu_assert(!data_sort_v(d,1,1));
-
 	for (i=0;i<200;i++)
 	{
 		double v;
+		int32_t l;
 		mu_assert(!data_get_entry_as_double(&v,d,i,1));
-		mu_assert(lv <= v);
-		lv = v;
+		mu_assert(v == serial[i]);
+		mu_assert(!data_get_entry_as_int32(&l,d,i,0));
+		label_sum += l;
 	}
+	mu_assert(label_sum == serial_label_sum);
+	mu_assert(label_sum == 100);
+	data_free(d);
+	return NULL;
+}
 
-	mu_assert(!data_stat_hist_v(d,101,0,1,1));
-	mu_assert(!data_get_precision_by_recall(&prec,d,0));
-	mu_assert(prec == 1.0);
+/************************************************************/
+
+static char *test_data_load_from_ascii_split(void)
+{
+	data_t *frames[3];
+	data_t *d;
+	int i, r;
+	static const int cols[] = {0, 1, 0, 2, 2, 4};
+	int sort_cols[] = {1, -1, 1};
+
+	for (i=0;i<3;i++)
+	{
+		mu_assert(!data_create(&frames[i]));
+		frames[i]->ib_bytes = 48;
+	}
+	data_set_external_filename(frames[1],"out.1");
+	data_set_external_filename(frames[2],"out.2");
+	mu_assert(!data_load_from_ascii_split(frames,3,"tests/resources/test.dat",2,cols));
+
+	for (i=0;i<3;i++)
+	{
+		mu_assert(6 == data_get_number_of_input_columns(frames[i]));
+		mu_assert(2 == data_get_number_of_columns(frames[i]));
+		mu_assert(12 == data_get_number_of_rows(frames[i]));
+	}
+	mu_assert(frames[2]->column_datatype[0] == DOUBLE);
+	mu_assert(frames[2]->column_datatype[1] == INT8);
+
+	/* Every frame contains the same as a frame of its columns alone */
+	for (i=0;i<3;i++)
+	{
+		mu_assert(!data_create(&d));
+		mu_assert(!data_load_from_ascii_projected(d,"tests/resources/test.dat",2,&cols[2*i]));
+		for (r=0;r<12;r++)
+		{
+			uint8_t *a, *b;
+			mu_assert(!data_get_buf_ptr(&a,d,r,0));
+			mu_assert(!data_get_buf_ptr(&b,frames[i],r,0));
+			mu_assert(!memcmp(a,b,d->num_bytes_per_row));
+		}
+		data_free(d);
+	}
+
+	/* Curves of several frames are determined concurrently */
+	mu_assert(!data_stat_hist_frames(frames,2,2,11,0,1,sort_cols));
+	for (i=0;i<2;i++)
+	{
+		mu_assert(!data_create(&d));
+		mu_assert(!data_load_from_ascii_projected(d,"tests/resources/test.dat",2,&cols[2*i]));
+		mu_assert(!data_stat_hist(d,11,0,1,&sort_cols[i]));
+		for (r=0;r<=10;r++)
+		{
+			double a, b;
+			mu_assert(!data_get_tpr_by_fpr(&a,d,r / 10.0));
+			mu_assert(!data_get_tpr_by_fpr(&b,frames[i],r / 10.0));
+			mu_assert(a == b);
+			mu_assert(!data_get_precision_by_recall(&a,d,r / 10.0));
+			mu_assert(!data_get_precision_by_recall(&b,frames[i],r / 10.0));
+			mu_assert(a == b);
+		}
+		data_free(d);
+	}
+
+	/* The external files go with the frames */
+	for (i=0;i<3;i++)
+		data_free(frames[i]);
+	mu_assert(access("out.1",F_OK) && access("out.2",F_OK));
+	return NULL;
+}
+
+/************************************************************/
+
+/**
+ * Loads the given file with and without narrowing the integer columns and
+ * checks that both frames hold the same values.
+ */
+static char *helper_narrow_columns(const char *filename, int threads, int compress, data_t **narrowed)
+{
+	data_t *d[2];
+	int i, j, k;
+
+	for (k=0;k<2;k++)
+	{
+		mu_assert(!data_create(&d[k]));
+		data_set_external_filename(d[k],k ? "out-narrowed" : "out");
+		data_set_narrow_integers(d[k],k);
+		mu_assert(!data_set_spill_compression(d[k],compress));
+		d[k]->ib_bytes = 1000;
+		d[k]->parse_chunk_bytes = 1000;
+		data_set_number_of_threads(d[k],threads);
+		mu_assert(!data_load_from_ascii(d[k],filename));
+		mu_assert(2000 == data_get_number_of_rows(d[k]));
+	}
+	mu_assert(d[0]->num_bytes_per_row == 4 * 4);
+
+	for (k=0;k<2;k++)
+		mu_assert(!data_sort_v(d[k],4,-3,1,2,0));
+
+	for (i=0;i<2000;i++)
+	{
+		for (j=0;j<4;j++)
+		{
+			double v[2];
+			int32_t iv;
+
+			for (k=0;k<2;k++)
+				mu_assert(!data_get_entry_as_double(&v[k],d[k],i,j));
+			mu_assert(v[0] == v[1]);
+			mu_assert(!data_get_entry_as_int32(&iv,d[1],i,j));
+			mu_assert(iv == v[0]);
+		}
+	}
+	data_free(d[0]);
+	*narrowed = d[1];
+	return NULL;
+}
+
+static char *test_data_narrow_columns(void)
+{
+	static const char *filename = "narrow-test.dat";
+	static const int cols[] = {0, 1, 0, 3};
+	data_t *frames[2];
+	data_t *d;
+	FILE *f;
+	char *rc;
+	double v;
+	int threads;
+	int i;
+
+	/* Only a value after the sampled lines exceeds the range of the last column */
+	mu_assert((f = fopen(filename,"w")));
+	fprintf(f,"label\tsmall\tmedium\tlate\n");
+	for (i=0;i<2000;i++)
+		fprintf(f,"%d\t%d\t%d\t%d\n",i & 1,(i * 7) % 200,(i * 13) % 1000,i == 10 ? 100000 : i % 50);
+	fclose(f);
+
+	for (threads=1;threads<=3;threads+=2)
+	{
+		if ((rc = helper_narrow_columns(filename,threads,threads > 1,&d)))
+			return rc;
+		mu_assert(d->column_datatype[0] == INT8);
+		mu_assert(d->column_datatype[1] == UINT8);
+		mu_assert(d->column_datatype[2] == INT16);
+		mu_assert(d->column_datatype[3] == INT32);
+		mu_assert(d->num_bytes_per_row == 1 + 1 + 2 + 4);
+		data_free(d);
+	}
+
+	/* The widened column is also widened in the frames that share it */
+	for (i=0;i<2;i++)
+	{
+		mu_assert(!data_create(&frames[i]));
+		frames[i]->ib_bytes = 100;
+	}
+	data_set_external_filename(frames[1],"out.1");
+	mu_assert(!data_load_from_ascii_split(frames,2,filename,2,cols));
+	mu_assert(frames[0]->column_datatype[1] == UINT8);
+	mu_assert(frames[1]->column_datatype[1] == INT32);
+	for (i=0;i<2;i++)
+	{
+		mu_assert(2000 == data_get_number_of_rows(frames[i]));
+		mu_assert(!data_sort_v(frames[i],1,-1));
+	}
+	mu_assert(!data_get_entry_as_double(&v,frames[1],0,1));
+	mu_assert(v == 100000);
+	for (i=0;i<2;i++)
+		data_free(frames[i]);
+	remove(filename);
+
+	/* Floating point columns only become single precision on request */
+	mu_assert(!data_create(&d));
+	data_set_float32(d,1);
+	mu_assert(!data_load_from_ascii(d,"tests/resources/test2.dat"));
+	mu_assert(d->column_datatype[0] == INT8);
+	mu_assert(d->column_datatype[1] == FLOAT32);
+	mu_assert(d->num_bytes_per_row == 1 + 4);
+	mu_assert(!data_sort_v(d,1,1));
+	for (i=1;i<200;i++)
+	{
+		double a, b;
+		mu_assert(!data_get_entry_as_double(&a,d,i-1,1));
+		mu_assert(!data_get_entry_as_double(&b,d,i,1));
+		mu_assert(a <= b);
+		mu_assert((float)b == b);
+	}
 	data_free(d);
 	return NULL;
 }
 
 /************************************************************/
 
+static char *helper_load_header(const char *contents, uint32_t expected_rows)
+{
+	static const char *filename = "header-test.dat";
+	data_t *d;
+	FILE *f;
+
+	mu_assert((f = fopen(filename,"w")));
+	fputs(contents,f);
+	fclose(f);
+
+	mu_assert(!data_create(&d));
+	mu_assert(!data_load_from_ascii(d,filename));
+	mu_assert(2 == data_get_number_of_columns(d));
+	mu_assert(expected_rows == data_get_number_of_rows(d));
+	data_free(d);
+	remove(filename);
+	return NULL;
+}
+
+static char *test_data_load_header(void)
+{
+	char *rc;
+
+	/* The newline that ends the first line doesn't count as a character
+	 * of a header, even if the line lacks it */
+	if ((rc = helper_load_header("label\tscore",0)))
+		return rc;
+	if ((rc = helper_load_header("1\t0.5",1)))
+		return rc;
+	if ((rc = helper_load_header("1\t0.5\n0\t0.25\n",2)))
+		return rc;
+	if ((rc = helper_load_header("label\tscore\n1\t0.5\n0\t0.25",2)))
+		return rc;
+	return NULL;
+}
+
+/************************************************************/
+
+static char *test_fio(void)
+{
+	struct fio fio;
+	const char *l;
+	size_t len;
+
+#define mu_assert_line(expected) \
+	do { mu_assert(!fio_read_next_line(&l,&len,&fio)); \
+	     mu_assert(len == strlen(expected) && !memcmp(expected,l,len)); } while (0)
+
+	mu_assert(!fio_init_by_file(&fio,"tests/resources/test.dat"));
+	mu_assert(fio.first_lines[0]);
+	mu_assert(fio.first_lines_len[0] == strlen("label\tpred1\tpred2\to1\to2\to3\n"));
+	mu_assert(!memcmp("label\tpred1\tpred2\to1\to2\to3\n",fio.first_lines[0],fio.first_lines_len[0]));
+
+	mu_assert_line("label\tpred1\tpred2\to1\to2\to3\n");
+	mu_assert_line("0	0.11	0.12	3	3	0\n");
+	mu_assert_line("0	0.24	0.11	5	2	0\n");
+	mu_assert_line("0	0.14	0.43	4	6	0\n");
+	mu_assert_line("0	0.33	0.56	6	9	0\n");
+	mu_assert_line("0	0.45	0.44	7	7	0\n");
+	mu_assert_line("1	0.68	0.49	11	8	0\n");
+	mu_assert_line("1	0.58	0.59	9	10	0\n");
+	mu_assert_line("0	0.59	0.68	10	11	0\n");
+	mu_assert_line("0	0.51	0.42	8	5	0\n");
+
+	fio_deinit(&fio);
+
+	return NULL;
+}
+
+/************************************************************/
+
+static char *test_fio_stream(void)
+{
+	struct fio fio;
+	const char *l;
+	size_t len;
+	int fds[2];
+	int i;
+
+	/* A pipe cannot be mapped, the last line lacks the newline */
+	mu_assert(!pipe(fds));
+	mu_assert(write(fds[1],"a\nb\tc\n\nd",8) == 8);
+	close(fds[1]);
+
+	mu_assert(!fio_init_by_fd(&fio,fds[0]));
+	mu_assert(!fio.map);
+	mu_assert(fio.first_lines_len[1] == 4);
+	mu_assert(!memcmp("b\tc\n",fio.first_lines[1],4));
+
+	mu_assert_line("a\n");
+	mu_assert_line("b\tc\n");
+	mu_assert_line("\n");
+	mu_assert_line("d\n");
+	mu_assert(fio_read_next_line(&l,&len,&fio));
+	fio_deinit(&fio);
+	close(fds[0]);
+
+	/* Lines beyond the first lines and longer than the initial buffer */
+	mu_assert(!pipe(fds));
+	if (!fork())
+	{
+		static char buf[FIO_STREAM_BUFFER_SIZE + 10];
+		close(fds[0]);
+		for (i=0;i<FIO_FIRST_LINES;i++)
+			if (write(fds[1],"x\n",2) != 2) _exit(1);
+		memset(buf,'y',sizeof(buf));
+		buf[sizeof(buf)-1] = '\n';
+		for (i=0;i<3;i++)
+			if (write(fds[1],buf,sizeof(buf)) != sizeof(buf)) _exit(1);
+		_exit(0);
+	}
+	close(fds[1]);
+	mu_assert(!fio_init_by_fd(&fio,fds[0]));
+	for (i=0;i<FIO_FIRST_LINES;i++)
+		mu_assert_line("x\n");
+	for (i=0;i<3;i++)
+	{
+		mu_assert(!fio_read_next_line(&l,&len,&fio));
+		mu_assert(len == FIO_STREAM_BUFFER_SIZE + 10);
+		mu_assert(l[0] == 'y' && l[len-2] == 'y' && l[len-1] == '\n');
+	}
+	mu_assert(fio_read_next_line(&l,&len,&fio));
+	mu_assert(!memcmp("x\n",fio.first_lines[FIO_FIRST_LINES-1],2));
+	fio_deinit(&fio);
+	close(fds[0]);
+	wait(NULL);
+
+#undef mu_assert_line
+	return NULL;
+}
+
+/************************************************************/
+
+static char *test_data_2(void)
+{
+	double prec;
+	double lv = DBL_MIN;
+	data_t *d;
+	int i;
+
+	mu_assert(!data_create(&d));
+	d->ib_bytes = 84;
+
+	mu_assert(!data_load_from_ascii(d,"tests/resources/test2.dat"));
+	mu_assert(2 == d->num_columns);
+	mu_assert(200 == d->num_rows);
+	mu_assert(!data_sort_v(d,1,1));
+
+	for (i=0;i<200;i++)
+	{
+		double v;
+		mu_assert(!data_get_entry_as_double(&v,d,i,1));
+		mu_assert(lv <= v);
+		lv = v;
+	}
+
+	mu_assert(!data_stat_hist_v(d,101,0,1,1));
+	mu_assert(!data_get_precision_by_recall(&prec,d,0));
+	mu_assert(prec == 1.0);
+	data_free(d);
+	return NULL;
+}
+
+/************************************************************/
+
+struct test_stat_rows
+{
+	uint32_t rows[200][4];
+	int n;
+};
+
+static int test_stat_rows_callback(uint64_t ps, uint64_t ns, uint64_t tps, uint64_t fps, void *userdata)
+{
+	struct test_stat_rows *tsr = (struct test_stat_rows*)userdata;
+	if (tsr->n < 200)
+	{
+		tsr->rows[tsr->n][0] = ps;
+		tsr->rows[tsr->n][1] = ns;
+		tsr->rows[tsr->n][2] = tps;
+		tsr->rows[tsr->n][3] = fps;
+	}
+	tsr->n++;
+	return 0;
+}
+
+static char *helper_stat_fused(int keep_sorted, enum data_layout_t layout, struct test_stat_rows *tsr)
+{
+	data_t *d;
+	int col = -1;
+	double lv = DBL_MAX;
+	int i;
+
+	memset(tsr,0,sizeof(*tsr));
+	remove("out-sorted");
+
+	mu_assert(!data_create(&d));
+	mu_assert(!data_set_layout(d,layout));
+	d->ib_bytes = 84;
+	data_set_max_fan_in(d,3);
+	data_set_keep_sorted(d,keep_sorted);
+	mu_assert(!data_load_from_ascii(d,"tests/resources/test2.dat"));
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,tsr,0,1,&col));
+	mu_assert(tsr->n == 200);
+
+	if (!keep_sorted)
+	{
+		/* No sorted copy has been written */
+		mu_assert(access("out-sorted",F_OK));
+	} else
+	{
+		for (i=0;i<200;i++)
+		{
+			double v;
+			mu_assert(!data_get_entry_as_double(&v,d,i,1));
+			mu_assert(lv >= v);
+			lv = v;
+		}
+	}
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_stat_fused(void)
+{
+	static struct test_stat_rows sorted, fused;
+	char *rc;
+	int layout;
+
+	for (layout=LAYOUT_ROWS;layout<=LAYOUT_COLUMNS;layout++)
+	{
+		if ((rc = helper_stat_fused(1,layout,&sorted)))
+			return rc;
+		if ((rc = helper_stat_fused(0,layout,&fused)))
+			return rc;
+		mu_assert(!memcmp(&sorted,&fused,sizeof(sorted)));
+		mu_assert(sorted.rows[199][0] == 100);
+		mu_assert(sorted.rows[199][2] == 100);
+		mu_assert(sorted.rows[199][3] == 100);
+	}
+	return NULL;
+}
+
+/************************************************************/
+
+static char *helper_stat_summary(uint32_t max_rows, uint32_t ib_bytes)
+{
+	static struct test_stat_rows tsr;
+	data_t *d;
+	struct data_summary sum;
+	int col = -1;
+	int i;
+
+	mu_assert(!data_create(&d));
+	d->ib_bytes = ib_bytes;
+	mu_assert(!data_set_max_distinct_rows(d,0,max_rows));
+	mu_assert(!data_set_number_of_columns(d,2));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,INT32);
+	mu_assert(data_get_summary(&sum,d));
+
+	for (i=0;i<2;i++)
+	{
+		mu_assert(!data_insert_row_v(d, 0, 1));
+		mu_assert(!data_insert_row_v(d, 1, 2));
+		mu_assert(!data_insert_row_v(d, 1, 3));
+	}
+	mu_assert(!data_insert_row_v(d, 0, 2));
+	mu_assert(!data_insert_row_v(d, 0, 3));
+	mu_assert(!data_insert_row_v(d, 1, 3));
+	mu_assert(!data_insert_row_v(d, 0, 1));
+
+	/* Groups of equal predictions end at (tp,fp) = (3,1), (5,2) and (5,5) */
+	memset(&tsr,0,sizeof(tsr));
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,&tsr,0,1,&col));
+	mu_assert(tsr.n == 10);
+	mu_assert(!data_get_summary(&sum,d));
+	mu_assert(sum.positives == 5);
+	mu_assert(sum.negatives == 5);
+	mu_assert(fabs(sum.auc_roc - (1 * 3 / 2.0 + 1 * (5 + 3) / 2.0 + 3 * (5 + 5) / 2.0) / 25) < 1e-12);
+	mu_assert(fabs(sum.average_precision - (3 / 5.0 * 3 / 4.0 + 2 / 5.0 * 5 / 7.0)) < 1e-12);
+	mu_assert(fabs(sum.auc_pr - (3 / 5.0 * (1 + 3 / 4.0) / 2 + 2 / 5.0 * (3 / 4.0 + 5 / 7.0) / 2)) < 1e-12);
+	mu_assert(fabs(sum.ks - 3 / 5.0) < 1e-12);
+	mu_assert(fabs(sum.max_f1 - 10 / 12.0) < 1e-12);
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_summary(void)
+{
+	char *rc;
+
+	if ((rc = helper_stat_summary(0,1024)))
+		return rc;
+	if ((rc = helper_stat_summary(0,24)))
+		return rc;
+	if ((rc = helper_stat_summary(65536,1024)))
+		return rc;
+	return NULL;
+}
+
+static char *helper_stat_weights(int negatives, uint32_t max_rows, uint32_t ib_bytes)
+{
+	static struct test_stat_rows tsr;
+	data_t *d;
+	struct data_summary sum;
+	int col = -1;
+
+	mu_assert(!data_create(&d));
+	d->ib_bytes = ib_bytes;
+	mu_assert(!data_set_max_distinct_rows(d,0,max_rows));
+	mu_assert(!data_set_number_of_columns(d,3));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,INT32);
+	data_set_column_datatype(d,2,negatives ? INT32 : DOUBLE);
+	mu_assert(data_set_weight_columns(d,2,2));
+	mu_assert(!data_set_weight_columns(d,negatives ? -1 : 2,negatives ? 2 : -1));
+	data_set_stat_points(d,POINTS_THRESHOLDS);
+
+	/* The rows of helper_stat_summary(), with weights */
+	if (negatives)
+	{
+		mu_assert(!data_insert_row_v(d, 0, 1, 3));
+		mu_assert(!data_insert_row_v(d, 2, 2, 1));
+		mu_assert(!data_insert_row_v(d, 3, 3, 1));
+		mu_assert(!data_insert_row_v(d, 0, 4, 0));
+	} else
+	{
+		mu_assert(!data_insert_row_v(d, 0, 1, 3.0));
+		mu_assert(!data_insert_row_v(d, 1, 2, 2.0));
+		mu_assert(!data_insert_row_v(d, 0, 2, 1.0));
+		mu_assert(!data_insert_row_v(d, 1, 3, 3.0));
+		mu_assert(!data_insert_row_v(d, 0, 3, 0.5));
+		mu_assert(!data_insert_row_v(d, 0, 3, 1.0));
+		mu_assert(!data_insert_row_v(d, 1, 4, -1.0));
+	}
+	memset(&tsr,0,sizeof(tsr));
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,&tsr,0,1,&col));
+	mu_assert(tsr.n == 3);
+	mu_assert(tsr.rows[0][0] == 5 && tsr.rows[0][1] == 5);
+	mu_assert(tsr.rows[0][2] == 3 && tsr.rows[0][3] == 1);
+	mu_assert(tsr.rows[1][2] == 5 && tsr.rows[1][3] == 2);
+	mu_assert(tsr.rows[2][2] == 5 && tsr.rows[2][3] == 5);
+	mu_assert(!data_get_summary(&sum,d));
+	mu_assert(sum.positives == 5);
+	mu_assert(sum.negatives == 5);
+	mu_assert(fabs(sum.auc_roc - (1 * 3 / 2.0 + 1 * (5 + 3) / 2.0 + 3 * (5 + 5) / 2.0) / 25) < 1e-12);
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_weights(void)
+{
+	char *rc;
+	int negatives;
+
+	for (negatives=0;negatives<2;negatives++)
+	{
+		if ((rc = helper_stat_weights(negatives,0,1024)))
+			return rc;
+		if ((rc = helper_stat_weights(negatives,0,48)))
+			return rc;
+		if ((rc = helper_stat_weights(negatives,16,1024)))
+			return rc;
+	}
+	return NULL;
+}
+
+static char *helper_load_counts(int negatives, int narrow, int big_line)
+{
+	static const char *filename = "counts-test.dat";
+	struct data_summary sum;
+	data_t *d;
+	FILE *f;
+	int col = -1;
+	int i;
+
+	/* One count doesn't fit into 32 bits */
+	mu_assert((f = fopen(filename,"w")));
+	for (i=0;i<1000;i++)
+		fprintf(f,"%d\t%d\t%s\n",i % 2,i % 10,i == big_line ? "5000000000" : "3");
+	fclose(f);
+
+	mu_assert(!data_create(&d));
+	data_set_narrow_integers(d,narrow);
+	mu_assert(!data_set_weight_columns(d,negatives ? -1 : 2,negatives ? 2 : -1));
+	mu_assert(!data_load_from_ascii(d,filename));
+	remove(filename);
+	mu_assert(1000 == data_get_number_of_rows(d));
+	mu_assert(DOUBLE == d->column_datatype[2]);
+	mu_assert(!data_stat_callback(d,data_stat_nop_callback,NULL,0,1,&col));
+	mu_assert(!data_get_summary(&sum,d));
+	if (negatives)
+	{
+		mu_assert(sum.positives == 500);
+		mu_assert(sum.negatives == UINT64_C(5000000000) + 999 * 3);
+	} else
+	{
+		mu_assert(sum.positives == UINT64_C(5000000000) + 499 * 3);
+		mu_assert(sum.negatives == 500 * 3);
+	}
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_load_counts(void)
+{
+	char *rc;
+	int negatives;
+
+	for (negatives=0;negatives<2;negatives++)
+	{
+		/* Sampled, and found only when the rows are parsed */
+		if ((rc = helper_load_counts(negatives,1,1)))
+			return rc;
+		if ((rc = helper_load_counts(negatives,0,1)))
+			return rc;
+		if ((rc = helper_load_counts(negatives,1,777)))
+			return rc;
+	}
+	return NULL;
+}
+
+static char *helper_stat_groups(uint32_t max_rows, uint32_t ib_bytes)
+{
+	static struct test_stat_rows tsr;
+	struct data_group_summary gs;
+	data_t *d;
+	int col = -1;
+	int i;
+
+	mu_assert(!data_create(&d));
+	d->ib_bytes = ib_bytes;
+	mu_assert(!data_set_max_distinct_rows(d,0,max_rows));
+	mu_assert(!data_set_number_of_columns(d,3));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,INT32);
+	data_set_column_datatype(d,2,DOUBLE);
+	mu_assert(!data_set_group_column(d,2));
+	data_set_stat_points(d,POINTS_THRESHOLDS);
+
+	/* Group 2 consists of the rows of helper_stat_summary(), group 1 of a
+	 * positive ranked below a negative */
+	for (i=0;i<2;i++)
+	{
+		mu_assert(!data_insert_row_v(d, 0, 1, 2.0));
+		mu_assert(!data_insert_row_v(d, 1, 2, 2.0));
+		mu_assert(!data_insert_row_v(d, 1, 3, 2.0));
+	}
+	mu_assert(!data_insert_row_v(d, 1, 1, 1.0));
+	mu_assert(!data_insert_row_v(d, 0, 2, 2.0));
+	mu_assert(!data_insert_row_v(d, 0, 3, 2.0));
+	mu_assert(!data_insert_row_v(d, 1, 3, 2.0));
+	mu_assert(!data_insert_row_v(d, 0, 2, 1.0));
+	mu_assert(!data_insert_row_v(d, 0, 1, 2.0));
+
+	memset(&tsr,0,sizeof(tsr));
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,&tsr,0,1,&col));
+	mu_assert(tsr.n == 5);
+	mu_assert(tsr.rows[0][0] == 1 && tsr.rows[0][1] == 1);
+	mu_assert(tsr.rows[0][2] == 0 && tsr.rows[0][3] == 1);
+	mu_assert(tsr.rows[1][2] == 1 && tsr.rows[1][3] == 1);
+	mu_assert(tsr.rows[2][0] == 5 && tsr.rows[2][1] == 5);
+	mu_assert(tsr.rows[2][2] == 3 && tsr.rows[2][3] == 1);
+	mu_assert(tsr.rows[4][2] == 5 && tsr.rows[4][3] == 5);
+
+	mu_assert(data_get_number_of_groups(d) == 2);
+	mu_assert(!data_get_group_summary(&gs,d,0));
+	mu_assert(gs.value == 1);
+	mu_assert(gs.summary.positives == 1 && gs.summary.negatives == 1);
+	mu_assert(gs.summary.auc_roc == 0);
+	mu_assert(!data_get_group_summary(&gs,d,1));
+	mu_assert(gs.value == 2);
+	mu_assert(gs.summary.positives == 5 && gs.summary.negatives == 5);
+	mu_assert(fabs(gs.summary.auc_roc - (1 * 3 / 2.0 + 1 * (5 + 3) / 2.0 + 3 * (5 + 5) / 2.0) / 25) < 1e-12);
+	mu_assert(data_get_group_summary(&gs,d,2));
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_groups(void)
+{
+	char *rc;
+
+	if ((rc = helper_stat_groups(0,1024)))
+		return rc;
+	if ((rc = helper_stat_groups(0,64)))
+		return rc;
+	if ((rc = helper_stat_groups(16,1024)))
+		return rc;
+	return NULL;
+}
+
+static char *helper_binary_file(enum data_layout_t layout, uint32_t ib_bytes)
+{
+	static struct test_stat_rows expected;
+	static struct test_stat_rows tsr;
+	data_t *d;
+	data_t *e;
+	data_t *frames[2];
+	struct data_summary sum;
+	struct data_summary restored;
+	int col = -1;
+	int other_col = 2;
+	int split_cols[] = {0, 1, 2, 0};
+	int i;
+
+	mu_assert(!data_create(&d));
+	d->ib_bytes = ib_bytes;
+	mu_assert(!data_set_layout(d,layout));
+	mu_assert(!data_set_number_of_columns(d,3));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,INT32);
+	data_set_column_datatype(d,2,DOUBLE);
+	data_set_stat_points(d,POINTS_THRESHOLDS);
+
+	for (i=0;i<100;i++)
+		mu_assert(!data_insert_row_v(d, i % 3 == 0, (i * 37) % 11, (i * 13) % 7 - 2.5));
+
+	/* Unsorted rows are saved as they are */
+	mu_assert(!data_save_binary(d,"binary-test",NULL));
+	mu_assert(data_is_binary_file("binary-test"));
+	mu_assert(!data_create(&e));
+	mu_assert(!data_load_binary(e,"binary-test",NULL));
+	mu_assert(data_get_number_of_rows(e) == 100);
+	mu_assert(data_get_number_of_columns(e) == 3);
+	mu_assert(e->layout == layout);
+	mu_assert(!e->num_sorted_columns);
+	mu_assert(data_insert_row_v(e, 0, 1, 1.0));
+	data_free(e);
+
+	data_set_keep_sorted(d,1);
+	memset(&expected,0,sizeof(expected));
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,&expected,0,1,&col));
+	mu_assert(!data_get_summary(&sum,d));
+	mu_assert(!data_save_binary(d,"binary-test","key"));
+	data_free(d);
+
+	mu_assert(!data_create(&e));
+	mu_assert(data_load_binary(e,"binary-test-missing","key") == 1);
+	mu_assert(data_load_binary(e,"binary-test","other key") == 1);
+	mu_assert(data_get_number_of_rows(e) == 0);
+	mu_assert(!data_load_binary(e,"binary-test","key"));
+	mu_assert(data_get_number_of_rows(e) == 100);
+	mu_assert(e->num_sorted_columns == 1);
+
+	/* The rows are accounted without being sorted again */
+	data_set_stat_points(e,POINTS_THRESHOLDS);
+	memset(&tsr,0,sizeof(tsr));
+	mu_assert(!data_stat_callback(e,test_stat_rows_callback,&tsr,0,1,&col));
+	mu_assert(tsr.n == expected.n);
+	mu_assert(!memcmp(tsr.rows,expected.rows,sizeof(tsr.rows[0]) * tsr.n));
+	mu_assert(!data_get_summary(&restored,e));
+	mu_assert(!memcmp(&sum,&restored,sizeof(sum)));
+
+	/* The mapped rows can be sorted by another column without touching the file */
+	mu_assert(!data_stat_callback(e,test_stat_rows_callback,&tsr,0,1,&other_col));
+	data_free(e);
+
+	/* Projections keep the order */
+	mu_assert(!data_create(&frames[0]));
+	mu_assert(!data_create(&frames[1]));
+	mu_assert(!data_load_from_binary_split(frames,2,"binary-test",2,split_cols));
+	mu_assert(data_get_number_of_rows(frames[0]) == 100);
+	mu_assert(data_get_number_of_columns(frames[1]) == 2);
+	mu_assert(frames[0]->num_sorted_columns == 1 && frames[0]->sorted_columns[0] == -1);
+	mu_assert(!frames[1]->num_sorted_columns);
+	data_set_stat_points(frames[0],POINTS_THRESHOLDS);
+	memset(&tsr,0,sizeof(tsr));
+	mu_assert(!data_stat_callback(frames[0],test_stat_rows_callback,&tsr,0,1,&col));
+	mu_assert(tsr.n == expected.n);
+	mu_assert(!memcmp(tsr.rows,expected.rows,sizeof(tsr.rows[0]) * tsr.n));
+	data_free(frames[0]);
+	data_free(frames[1]);
+
+	remove("binary-test");
+	return NULL;
+}
+
+static char *test_data_binary_file(void)
+{
+	char *rc;
+	enum data_layout_t layout;
+
+	for (layout=LAYOUT_ROWS;layout<=LAYOUT_COLUMNS;layout++)
+	{
+		if ((rc = helper_binary_file(layout,1024 * 1024)))
+			return rc;
+		if ((rc = helper_binary_file(layout,16 * 16)))
+			return rc;
+	}
+	return NULL;
+}
+
+static char *helper_stat_bootstrap(int threads, uint32_t max_rows, uint32_t ib_bytes, uint32_t replicates, double *auc_roc)
+{
+	data_t *d;
+	struct data_summary sum;
+	double lower, upper;
+	int col = -1;
+	int i;
+
+	mu_assert(!data_create(&d));
+	if (ib_bytes)
+		d->ib_bytes = ib_bytes;
+	mu_assert(!data_set_max_distinct_rows(d,0,max_rows));
+	mu_assert(!data_set_number_of_columns(d,2));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,INT32);
+	data_set_number_of_threads(d,threads);
+	data_set_bootstrap(d,replicates,42);
+
+	/* More rows than fit into one batch of the bootstrap, with ties */
+	for (i=0;i<100000;i++)
+	{
+		int pred = (i * 7919) % 1000;
+		int label = (i % 7) < 2 + pred / 250;
+		mu_assert(!data_insert_row_v(d, label, pred));
+	}
+
+	mu_assert(!!max_rows == data_is_aggregated(d));
+	mu_assert(!data_stat_callback(d,data_stat_nop_callback,NULL,0,1,&col));
+	mu_assert(!data_get_summary(&sum,d));
+	mu_assert(!data_get_bootstrap_auc_roc(&lower,&upper,d,0.95));
+	mu_assert(data_get_bootstrap_auc_roc(&lower,&upper,d,1));
+	mu_assert(lower <= upper);
+	mu_assert(lower < sum.auc_roc && sum.auc_roc < upper);
+	mu_assert(upper - lower < 0.05);
+	memcpy(auc_roc,d->bootstrap_auc_roc,sizeof(auc_roc[0]) * replicates);
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_bootstrap(void)
+{
+	static double expected[101];
+	static double auc_roc[101];
+	char *rc;
+	uint32_t max_rows;
+
+	if ((rc = helper_stat_bootstrap(1,0,0,101,expected)))
+		return rc;
+
+	/* The replicates don't depend on whether the rows were sorted in memory,
+	 * spilled or aggregated */
+	if ((rc = helper_stat_bootstrap(1,0,100 * 8,101,auc_roc)))
+		return rc;
+	mu_assert(!memcmp(expected,auc_roc,sizeof(auc_roc)));
+	for (max_rows=0;max_rows<=2048;max_rows+=2048)
+	{
+		if ((rc = helper_stat_bootstrap(1,max_rows,0,101,auc_roc)))
+			return rc;
+		mu_assert(!memcmp(expected,auc_roc,sizeof(auc_roc)));
+
+		/* Nor on how they are distributed among the threads */
+		if ((rc = helper_stat_bootstrap(3,max_rows,0,101,auc_roc)))
+			return rc;
+		mu_assert(!memcmp(expected,auc_roc,sizeof(auc_roc)));
+		if ((rc = helper_stat_bootstrap(4,max_rows,0,40,auc_roc)))
+			return rc;
+		mu_assert(!memcmp(expected,auc_roc,sizeof(auc_roc[0]) * 40));
+	}
+	return NULL;
+}
+
+static char *helper_stat_points(enum data_stat_points_t points, uint32_t max_rows, int n, const uint32_t expected[][2])
+{
+	static struct test_stat_rows tsr;
+	data_t *d;
+	int col = -1;
+	int i;
+
+	mu_assert(!data_create(&d));
+	mu_assert(!data_set_max_distinct_rows(d,0,max_rows));
+	mu_assert(!data_set_number_of_columns(d,2));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,INT32);
+	data_set_stat_points(d,points);
+
+	/* Predictions 5 and 2 tie */
+	mu_assert(!data_insert_row_v(d, 1, 6));
+	mu_assert(!data_insert_row_v(d, 1, 5));
+	mu_assert(!data_insert_row_v(d, 0, 5));
+	mu_assert(!data_insert_row_v(d, 1, 4));
+	mu_assert(!data_insert_row_v(d, 0, 3));
+	mu_assert(!data_insert_row_v(d, 0, 2));
+	mu_assert(!data_insert_row_v(d, 0, 2));
+	mu_assert(!data_insert_row_v(d, 0, 1));
+
+	memset(&tsr,0,sizeof(tsr));
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,&tsr,0,1,&col));
+	mu_assert(tsr.n == n);
+	for (i=0;i<n;i++)
+	{
+		mu_assert(tsr.rows[i][0] == 3);
+		mu_assert(tsr.rows[i][1] == 5);
+		if (!expected) continue;
+		mu_assert(tsr.rows[i][2] == expected[i][0]);
+		mu_assert(tsr.rows[i][3] == expected[i][1]);
+	}
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_stat_points(void)
+{
+	static const uint32_t thresholds[][2] = {{1,0},{2,1},{3,1},{3,2},{3,4},{3,5}};
+	static const uint32_t corners[][2] = {{1,0},{2,1},{3,1},{3,5}};
+	char *rc;
+	uint32_t max_rows;
+
+	for (max_rows=0;max_rows<=16;max_rows+=16)
+	{
+		if ((rc = helper_stat_points(POINTS_ROWS,max_rows,8,NULL)))
+			return rc;
+		if ((rc = helper_stat_points(POINTS_THRESHOLDS,max_rows,6,thresholds)))
+			return rc;
+		if ((rc = helper_stat_points(POINTS_CORNERS,max_rows,4,corners)))
+			return rc;
+	}
+	return NULL;
+}
+
+/************************************************************/
+
+static char *helper_stat_aggregated(uint32_t max_rows, int expect_aggregated, struct test_stat_rows *tsr)
+{
+	data_t *d;
+	int col = 1;
+
+	memset(tsr,0,sizeof(*tsr));
+	mu_assert(!data_create(&d));
+	d->ib_bytes = 84;
+	mu_assert(!data_set_max_distinct_rows(d,0,max_rows));
+	mu_assert(!data_load_from_ascii(d,"tests/resources/test2.dat"));
+	mu_assert(200 == data_get_number_of_rows(d));
+	mu_assert(expect_aggregated == data_is_aggregated(d));
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,tsr,0,1,&col));
+	mu_assert(tsr->n == 200);
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_aggregate(void)
+{
+	static struct test_stat_rows expected, actual;
+	data_t *d;
+	char *rc;
+	double lv = -1;
+	uint32_t tps = 0, fps = 0;
+	int col = -1;
+	int i;
+
+	if ((rc = helper_stat_aggregated(0,0,&expected)))
+		return rc;
+	if ((rc = helper_stat_aggregated(200,1,&actual)))
+		return rc;
+	mu_assert(!memcmp(&expected,&actual,sizeof(expected)));
+
+	/* Falls back to regular storage */
+	if ((rc = helper_stat_aggregated(50,0,&actual)))
+		return rc;
+	mu_assert(!memcmp(&expected,&actual,sizeof(expected)));
+
+	/* Few distinct scores */
+	mu_assert(!data_create(&d));
+	mu_assert(!data_set_max_distinct_rows(d,0,8));
+	mu_assert(!data_set_number_of_columns(d,2));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,DOUBLE);
+	for (i=0;i<3000;i++)
+		mu_assert(!data_insert_row_v(d,i % 3 == 0,(double)(i % 4)));
+	mu_assert(data_is_aggregated(d));
+	mu_assert(d->agg.num_rows == 8);
+	mu_assert(3000 == data_get_number_of_rows(d));
+
+	memset(&actual,0,sizeof(actual));
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,&actual,0,1,&col));
+	mu_assert(actual.n == 3000);
+	mu_assert(actual.rows[0][0] == 1000);
+	mu_assert(actual.rows[0][1] == 2000);
+	/* Rows with score 3, the points of the tie are spread evenly */
+	for (i=0;i<200;i++)
+	{
+		tps = 250 * (i + 1) / 750;
+		fps = 500 * (i + 1) / 750;
+		mu_assert(actual.rows[i][2] == tps);
+		mu_assert(actual.rows[i][3] == fps);
+	}
+
+	/* Accessing the rows expands them */
+	mu_assert(!data_sort_v(d,1,1));
+	mu_assert(!data_is_aggregated(d));
+	mu_assert(3000 == data_get_number_of_rows(d));
+	tps = 0;
+	for (i=0;i<3000;i++)
+	{
+		double v;
+		int32_t l;
+		mu_assert(!data_get_entry_as_double(&v,d,i,1));
+		mu_assert(lv <= v);
+		mu_assert(!data_get_entry_as_int32(&l,d,i,0));
+		tps += l;
+		lv = v;
+	}
+	mu_assert(tps == 1000);
+	data_free(d);
+	return NULL;
+}
+
+static char *helper_aggregate_weights(int negatives, uint32_t max_rows, uint32_t ib_bytes, struct test_stat_rows *tsr, double *auc_roc)
+{
+	data_t *d;
+	int col = -1;
+	int i;
+
+	memset(tsr,0,sizeof(*tsr));
+	mu_assert(!data_create(&d));
+	if (ib_bytes)
+		d->ib_bytes = ib_bytes;
+	mu_assert(!data_set_max_distinct_rows(d,0,max_rows));
+	mu_assert(!data_set_number_of_columns(d,3));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,INT32);
+	data_set_column_datatype(d,2,INT32);
+	mu_assert(!data_set_weight_columns(d,negatives ? -1 : 2,negatives ? 2 : -1));
+	data_set_stat_points(d,POINTS_ROWS);
+	data_set_bootstrap(d,10,42);
+
+	/* Four scores, but as many distinct weights as rows */
+	for (i=0;i<1000;i++)
+		mu_assert(!data_insert_row_v(d,negatives ? i % 5 : i % 3 == 0,i % 4,i));
+	mu_assert(!!max_rows == data_is_aggregated(d));
+	mu_assert(!max_rows || d->agg.num_rows == (negatives ? 4 : 8));
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,tsr,0,1,&col));
+	mu_assert(tsr->n == 1000);
+	memcpy(auc_roc,d->bootstrap_auc_roc,sizeof(auc_roc[0]) * 10);
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_aggregate_weights(void)
+{
+	static struct test_stat_rows expected, actual;
+	double expected_auc_roc[10], auc_roc[10];
+	data_t *d;
+	int64_t pos = 0, neg = 0;
+	char *rc;
+	int negatives;
+	int i;
+
+	for (negatives=0;negatives<2;negatives++)
+	{
+		if ((rc = helper_aggregate_weights(negatives,0,0,&expected,expected_auc_roc)))
+			return rc;
+
+		/* Rows that differ only in their weights are aggregated */
+		if ((rc = helper_aggregate_weights(negatives,16,0,&actual,auc_roc)))
+			return rc;
+		mu_assert(!memcmp(&expected,&actual,sizeof(expected)));
+		mu_assert(!memcmp(expected_auc_roc,auc_roc,sizeof(auc_roc)));
+
+		/* Spilled and merged */
+		if ((rc = helper_aggregate_weights(negatives,0,12 * 50,&actual,auc_roc)))
+			return rc;
+		mu_assert(!memcmp(&expected,&actual,sizeof(expected)));
+		mu_assert(!memcmp(expected_auc_roc,auc_roc,sizeof(auc_roc)));
+	}
+
+	/* Expanded rows share the weights of their distinct row */
+	mu_assert(!data_create(&d));
+	mu_assert(!data_set_max_distinct_rows(d,0,16));
+	mu_assert(!data_set_number_of_columns(d,3));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,INT32);
+	data_set_column_datatype(d,2,INT16);
+	mu_assert(!data_set_weight_columns(d,2,-1));
+	for (i=0;i<1000;i++)
+		mu_assert(!data_insert_row_v(d,i % 3 == 0,i % 4,i % 1000 ? i : 32767));
+	mu_assert(data_is_aggregated(d));
+	mu_assert(!data_sort_v(d,1,1));
+	mu_assert(!data_is_aggregated(d));
+	mu_assert(1000 == data_get_number_of_rows(d));
+	for (i=0;i<1000;i++)
+	{
+		int32_t l, w;
+
+		mu_assert(!data_get_entry_as_int32(&l,d,i,0));
+		mu_assert(!data_get_entry_as_int32(&w,d,i,2));
+		mu_assert(0 <= w && w <= 32767);
+		if (l) pos += w;
+		else neg += w;
+	}
+	mu_assert(pos == 32767 + 166833);
+	mu_assert(neg == 499500 - 166833);
+	data_free(d);
+	return NULL;
+}
+
+/************************************************************/
+
+static char *helper_stat_ties(uint32_t max_rows, uint32_t ib_bytes, int step, struct test_stat_rows *tsr)
+{
+	data_t *d;
+	int col = -1;
+	int i;
+
+	memset(tsr,0,sizeof(*tsr));
+	mu_assert(!data_create(&d));
+	if (ib_bytes)
+		d->ib_bytes = ib_bytes;
+	mu_assert(!data_set_max_distinct_rows(d,0,max_rows));
+	mu_assert(!data_set_number_of_columns(d,2));
+	data_set_column_datatype(d,0,INT32);
+	data_set_column_datatype(d,1,DOUBLE);
+	data_set_stat_points(d,POINTS_ROWS);
+
+	/* Four scores, each of which is shared by 50 rows */
+	for (i=0;i<200;i++)
+	{
+		int k = i * step % 200;
+		mu_assert(!data_insert_row_v(d,k % 3 == 0,(double)(k % 4)));
+	}
+	mu_assert(!!max_rows == data_is_aggregated(d));
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,tsr,0,1,&col));
+	mu_assert(tsr->n == 200);
+	data_free(d);
+	return NULL;
+}
+
+static char *test_data_stat_ties(void)
+{
+	static struct test_stat_rows expected, actual;
+	char *rc;
+	int i;
+
+	if ((rc = helper_stat_ties(8,0,1,&expected)))
+		return rc;
+
+	/* The points of a tie are spread evenly up to its end */
+	for (i=0;i<200;i++)
+	{
+		uint32_t tps = i >= 50 ? expected.rows[i / 50 * 50 - 1][2] : 0;
+		uint32_t fps = i >= 50 ? expected.rows[i / 50 * 50 - 1][3] : 0;
+		uint32_t dtps = expected.rows[i / 50 * 50 + 49][2] - tps;
+		uint32_t dfps = expected.rows[i / 50 * 50 + 49][3] - fps;
+
+		mu_assert(dtps && dfps);
+		mu_assert(expected.rows[i][2] == tps + dtps * (i % 50 + 1) / 50);
+		mu_assert(expected.rows[i][3] == fps + dfps * (i % 50 + 1) / 50);
+	}
+
+	/* Sorted in memory, spilled and merged, and aggregated in another order */
+	if ((rc = helper_stat_ties(0,0,37,&actual)))
+		return rc;
+	mu_assert(!memcmp(&expected,&actual,sizeof(expected)));
+	if ((rc = helper_stat_ties(0,7 * 12,37,&actual)))
+		return rc;
+	mu_assert(!memcmp(&expected,&actual,sizeof(expected)));
+	if ((rc = helper_stat_ties(8,0,199,&actual)))
+		return rc;
+	mu_assert(!memcmp(&expected,&actual,sizeof(expected)));
+	return NULL;
+}
+
+/************************************************************/
+
+/**
+ * Writes the given file to fd in a child process.
+ */
+static pid_t helper_write_file_to(int fd, const char *filename)
+{
+	pid_t pid;
+
+	if (!(pid = fork()))
+	{
+		char buf[97];
+		ssize_t r;
+		int in;
+
+		if ((in = open(filename,O_RDONLY)) < 0)
+			_exit(1);
+		while ((r = read(in,buf,sizeof(buf))) > 0)
+		{
+			if (write(fd,buf,r) != r)
+				_exit(1);
+		}
+		_exit(0);
+	}
+	return pid;
+}
+
+static char *test_data_load_from_pipe(void)
+{
+	static struct test_stat_rows expected, actual;
+	static const char *fifo_name = "support_test.fifo";
+	int cols[] = {1};
+	data_t *d;
+	int fds[2];
+	int saved_stdin;
+	int fd;
+	int i;
+
+	if (helper_stat_aggregated(0,0,&expected))
+		return "Couldn't determine expected statistics";
+
+	/* Named pipe, blocks are sorted while they arrive */
+	remove(fifo_name);
+	mu_assert(!mkfifo(fifo_name,0600));
+	if (!fork())
+	{
+		if ((fd = open(fifo_name,O_WRONLY)) < 0)
+			_exit(1);
+		waitpid(helper_write_file_to(fd,"tests/resources/test2.dat"),NULL,0);
+		_exit(0);
+	}
+
+	memset(&actual,0,sizeof(actual));
+	mu_assert(!data_create(&d));
+	d->ib_bytes = 84;
+	mu_assert(!data_set_presort_columns(d,0,1,cols));
+	mu_assert(!data_load_from_ascii(d,fifo_name));
+	wait(NULL);
+	remove(fifo_name);
+	mu_assert(200 == data_get_number_of_rows(d));
+	mu_assert(d->presorted_rows == 196);
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,&actual,0,1,cols));
+	mu_assert(!memcmp(&expected,&actual,sizeof(expected)));
+	data_free(d);
+
+	/* Standard input, presorted in the wrong order */
+	mu_assert(!pipe(fds));
+	helper_write_file_to(fds[1],"tests/resources/test2.dat");
+	close(fds[1]);
+	mu_assert((saved_stdin = dup(STDIN_FILENO)) >= 0);
+	mu_assert(dup2(fds[0],STDIN_FILENO) >= 0);
+	close(fds[0]);
+
+	memset(&actual,0,sizeof(actual));
+	mu_assert(!data_create(&d));
+	d->ib_bytes = 84;
+	cols[0] = -1;
+	mu_assert(!data_set_presort_columns(d,0,1,cols));
+	i = data_load_from_ascii(d,"-");
+	dup2(saved_stdin,STDIN_FILENO);
+	close(saved_stdin);
+	wait(NULL);
+	mu_assert(!i);
+	mu_assert(200 == data_get_number_of_rows(d));
+	cols[0] = 1;
+	mu_assert(!data_stat_callback(d,test_stat_rows_callback,&actual,0,1,cols));
+	mu_assert(!memcmp(&expected,&actual,sizeof(expected)));
+	data_free(d);
+	return NULL;
+}
+
+/************************************************************/
+
+static char *helper_assert_parse_double(const char *str)
+{
+	double expected = strtod(str,NULL);
+	double v;
+
+	mu_assert(!parse_double(&v,str,str + strlen(str)));
+	mu_assert(!memcmp(&v,&expected,sizeof(v)));
+	return NULL;
+}
+
+static char *test_parse(void)
+{
+	static const char *numbers[] =
+	{
+		"0", "-0", "1", "0.000981130211733294", "0.462624653043377",
+		"1e-5", "2.5E+3", "9007199254740993", "1234567890123456789",
+		"1.7976931348623157e308", "1.7976931348623159e308", "2.2250738585072014e-308",
+		"4.9406564584124654e-324", "2.4703282292062328e-324", "1e-400", "1e400",
+		"0.1", "0.3", "123456789012345678e-10", "7.038531e-26", "9.999999999999999e22",
+		"3.0000000000000004", "8.98846567431158e307"
+	};
+	char buf[64];
+	double v;
+	int32_t iv;
+	int i;
+	char *rc;
+
+	for (i=0;i<sizeof(numbers)/sizeof(numbers[0]);i++)
+	{
+		if ((rc = helper_assert_parse_double(numbers[i])))
+			return rc;
+	}
+
+	srand(4711);
+	for (i=0;i<200000;i++)
+	{
+		uint64_t m = ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ rand();
+		int digits = 1 + rand() % 19;
+		int exp = rand() % 700 - 350;
+		uint64_t p = 1;
+		int j;
+
+		for (j=0;j<digits;j++) p *= 10;
+		m %= p;
+		if (rand() & 1)
+			snprintf(buf,sizeof(buf),"%" PRIu64 "e%d",m,exp);
+		else
+			snprintf(buf,sizeof(buf),"0.%0*" PRIu64,digits,m);
+
+		if ((rc = helper_assert_parse_double(buf)))
+			return rc;
+	}
+
+	/* Not handled by the fast path */
+	mu_assert(parse_double(&v,"12345678901234567890",&"12345678901234567890"[20]));
+	mu_assert(parse_double(&v,"nan",&"nan"[3]));
+	mu_assert(parse_double(&v,"0x10",&"0x10"[4]));
+	mu_assert(parse_double(&v,".",&"."[1]));
+	mu_assert(parse_double(&v,"1e",&"1e"[2]));
+	mu_assert(parse_double(&v,"\"x\"",&"\"x\""[3]));
+
+	mu_assert(!parse_int32(&iv,"-2147483648",&"-2147483648"[11]));
+	mu_assert(iv == INT32_MIN);
+	mu_assert(!parse_int32(&iv,"+17",&"+17"[3]));
+	mu_assert(iv == 17);
+	mu_assert(parse_int32(&iv,"2147483648",&"2147483648"[10]));
+	mu_assert(parse_int32(&iv,"1.0",&"1.0"[3]));
+	mu_assert(parse_int32(&iv,"-",&"-"[1]));
+
+	/* Falls back to strtod() */
+	mu_assert(data_parse_double(" 1e1x\t",&" 1e1x\t"[5]) == 10.0);
+	return NULL;
+}
+
+/************************************************************/
+
+static char *helper_assert_format_double(double v, const char *expected)
+{
+	char buf[FORMAT_DOUBLE_MAX + 1];
+	int len = format_double(buf,v);
+
+	mu_assert(len > 0 && len <= FORMAT_DOUBLE_MAX);
+	buf[len] = 0;
+	mu_assert(!strcmp(buf,expected));
+	return NULL;
+}
+
+/**
+ * Checks that the formatted number is read back exactly and that no
+ * number with fewer significant digits would be.
+ */
+static char *helper_assert_format_shortest(double v)
+{
+	char buf[FORMAT_DOUBLE_MAX + 1];
+	char shorter[FORMAT_DOUBLE_MAX + 1];
+	double back;
+	int digits = 0;
+	int len;
+	int i;
+
+	len = format_double(buf,v);
+	buf[len] = 0;
+	back = strtod(buf,NULL);
+	mu_assert(!memcmp(&v,&back,sizeof(v)));
+
+	for (i=0;i<len && buf[i] != 'e';i++)
+	{
+		if (isdigit((unsigned char)buf[i]) && (digits || buf[i] != '0'))
+			digits++;
+	}
+	/* Trailing zeros of integers are not significant */
+	for (i--;i>0 && buf[i] == '0' && !strchr(buf,'.');i--)
+		digits--;
+
+	if (digits > 1)
+	{
+		snprintf(shorter,sizeof(shorter),"%.*e",digits - 2,v);
+		mu_assert(strtod(shorter,NULL) != v);
+	}
+	return NULL;
+}
+
+static char *test_format(void)
+{
+	static const char *numbers[] =
+	{
+		"0.000981130211733294", "0.462624653043377", "1.7976931348623157e308",
+		"2.2250738585072014e-308", "5e-324", "0.3", "1e-320",
+		"2.225073858507201e-308", "7.877156681317376e-171", "1e-300",
+		"3.0000000000000004", "8.98846567431158e307", "123456789012345680000",
+		"1.2345678901234568e21", "0.3333333333333333", "0.000001", "1e-7"
+	};
+	char buf[FORMAT_DOUBLE_MAX + 1];
+	struct fout f;
+	int fds[2];
+	char *rc;
+	int i;
+
+	for (i=0;i<sizeof(numbers)/sizeof(numbers[0]);i++)
+	{
+		if ((rc = helper_assert_format_double(strtod(numbers[i],NULL),numbers[i])))
+			return rc;
+	}
+	if ((rc = helper_assert_format_double(0.0,"0")))
+		return rc;
+	if ((rc = helper_assert_format_double(-0.0,"-0")))
+		return rc;
+	if ((rc = helper_assert_format_double(-2.5,"-2.5")))
+		return rc;
+	if ((rc = helper_assert_format_double(1e21,"1e21")))
+		return rc;
+	if ((rc = helper_assert_format_double(-HUGE_VAL,"-inf")))
+		return rc;
+	if ((rc = helper_assert_format_double(NAN,"nan")))
+		return rc;
+
+	/* Random bit patterns, also of subnormal numbers, are read back exactly
+	 * with as few digits as possible */
+	srand(4711);
+	for (i=0;i<200000;i++)
+	{
+		uint64_t bits = ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ rand();
+		double v;
+
+		if (i % 4 == 0)
+			bits &= (UINT64_C(1) << 52) - 1;
+		memcpy(&v,&bits,sizeof(v));
+		if (!isfinite(v))
+			continue;
+		if ((rc = helper_assert_format_shortest(v)))
+			return rc;
+	}
+
+	/* Buffered output, also of data that exceeds the buffer */
+	mu_assert(!pipe(fds));
+	mu_assert(!fout_init(&f,fds[1],64));
+	mu_assert(!fout_puts(&f,"x\t"));
+	mu_assert(!fout_put_double(&f,0.5));
+	mu_assert(!fout_write(&f,"0123456789012345678901234567890123456789012345678901234567890123456789",70));
+	mu_assert(!fout_put_double_le(&f,1.0));
+	mu_assert(!fout_deinit(&f));
+	close(fds[1]);
+	mu_assert(read(fds[0],buf,5) == 5);
+	mu_assert(!memcmp(buf,"x\t0.5",5));
+	mu_assert(read(fds[0],buf,32) == 32);
+	mu_assert(read(fds[0],buf,32) == 32);
+	mu_assert(read(fds[0],buf,14) == 14);
+	mu_assert(!memcmp(&buf[6],"\0\0\0\0\0\0\xf0\x3f",8));
+	close(fds[0]);
+	return NULL;
+}
+
+/************************************************************/
+
 static char *test_hist(void)
 {
 	struct hist h;
@@ -296,12 +2104,37 @@ static char *test_hist(void)
 
 static char *run_test_suite(void)
 {
+	mu_run_test(test_data_load_header);
 	mu_run_test(test_fio);
+	mu_run_test(test_fio_stream);
+	mu_run_test(test_parse);
+	mu_run_test(test_format);
 	mu_run_test(test_hist);
 	mu_run_test(test_data_simple);
 	mu_run_test(test_data_more_than_a_block);
+	mu_run_test(test_data_columns);
+	mu_run_test(test_data_many_runs);
+	mu_run_test(test_data_spill_compression);
+	mu_run_test(test_data_memory_budget);
+	mu_run_test(test_data_sort_block);
 	mu_run_test(test_data_load_from_ascii);
+	mu_run_test(test_data_load_from_ascii_projected);
+	mu_run_test(test_data_load_from_ascii_threads);
+	mu_run_test(test_data_load_from_ascii_split);
+	mu_run_test(test_data_narrow_columns);
 	mu_run_test(test_data_2);
+	mu_run_test(test_data_stat_fused);
+	mu_run_test(test_data_aggregate);
+	mu_run_test(test_data_aggregate_weights);
+	mu_run_test(test_data_stat_ties);
+	mu_run_test(test_data_summary);
+	mu_run_test(test_data_stat_points);
+	mu_run_test(test_data_bootstrap);
+	mu_run_test(test_data_weights);
+	mu_run_test(test_data_load_counts);
+	mu_run_test(test_data_groups);
+	mu_run_test(test_data_binary_file);
+	mu_run_test(test_data_load_from_pipe);
 	return NULL;
 }
 